@@ -19,21 +19,19 @@
  */
 
 #include <iostream>
-using std::cerr;
-using std::cout;
+using std::ostream;
 using std::endl;
-using std::ios;
-
-#include <fstream>
-using std::ofstream;
-using std::ifstream;
 
 #include <vector>
 using std::vector;
 
-#include <stdlib.h>
+#include <cmath>
 
 #include "genericpixel.h"
+#include "mideworkspace.h"
+
+bool solvelinsys(const long, double *, double *, double *);
+void bfitbasis(const long, const long, const double, double *);
 
 //-----------------------------------------------------------------------------
 //Calcula un boundary fit, ajustando los datos en el vector vec. El resultado
@@ -41,180 +39,287 @@ using std::vector;
 //Finalmente tambien se evalua el boundary fit en todos los pixeles contenidos
 //en el vector eval. De esta forma, este vector puede usarse para calcular un
 //unico valor en el centro de una banda, o todo un conjunto de valores.
-//Si boundfit > 0, el ajuste es polinomico.
-//Si boundfit < 0, el ajuste se realiza con splines.
-bool boundaryfit(const long boundfit, 
+//Si boundfit > 0, el ajuste es polinomico (de grado bfitdeg).
+//Si boundfit < 0, el ajuste se realiza con splines cubicos (con bfitdeg 
+//nodos equiespaciados).
+//El ajuste a la frontera superior de los datos se obtiene minimizando la
+//suma de los residuos al cuadrado, pesando los puntos que quedan por encima
+//del ajuste con un factor 1+bfitasym. Como los pesos dependen del propio
+//ajuste, el calculo se repite hasta que el conjunto de puntos situados por
+//encima del ajuste no cambia. Todo el calculo se realiza en memoria, sin
+//ficheros temporales, de forma que la funcion puede emplearse 
+//simultaneamente en diferentes hilos de ejecucion (cada uno con su propia
+//memoria de trabajo, workspace). Los mensajes de error se envian a err.
+bool boundaryfit(const long boundfit, const long bfitdeg, 
+                 const double bfitasym,
                  vector <GenericPixel> &vec, const bool lerr,
                  vector <GenericPixel> &fit,
-                 vector <GenericPixel> &eval)
+                 vector <GenericPixel> &eval,
+                 MideWorkspace &workspace, ostream &err)
 {
   //---------------------------------------------------------------------------
   //protecciones
   if (boundfit == 0)
   {
-    cout << "ERROR in function boundaryfit: boundfit = 0" << endl;
+    err << "ERROR in function boundaryfit: boundfit = 0" << endl;
     return(false);
   }
   long num=vec.size();
   if (num <= 0)
   {
-    cout << "ERROR in function boundaryfit: vector size = 0" << endl;
+    err << "ERROR in function boundaryfit: vector size = 0" << endl;
     return(false);
   }
   if (num != fit.size())
   {
-    cout << "ERROR in function boundaryfit: size of vectors vec and fit "
-         << "does not match" << endl;
-    cout << "size(vec): " << num << endl;
-    cout << "size(fit): " << fit.size() << endl;
+    err << "ERROR in function boundaryfit: size of vectors vec and fit "
+        << "does not match" << endl;
+    err << "size(vec): " << num << endl;
+    err << "size(fit): " << fit.size() << endl;
     return(false);
   }
-  
-  //---------------------------------------------------------------------------
-  //normalizamos la longitud de onda
-  double wnorm = 0.0;
-  for (long i=0; i<num; i++)
+  //numero de parametros libres del ajuste
+  long npar;
+  if (boundfit > 0)
   {
-    wnorm += vec[i].getwave();
+    npar=bfitdeg+1;
+  }
+  else
+  {
+    if (bfitdeg < 2)
+    {
+      err << "ERROR in function boundaryfit: number of knots = " << bfitdeg
+          << endl;
+      return(false);
+    }
+    npar=bfitdeg+2;
   }
-  wnorm /= static_cast<double>(num);
 
   //---------------------------------------------------------------------------
-  //generamos un fichero ASCII con los datos a ajustar
-  ofstream outdatafile("boundfit.dat",ios::out);
-  if(!outdatafile)
+  //normalizamos la longitud de onda al intervalo [-1,1]
+  double wmin=vec[0].getwave();
+  double wmax=vec[0].getwave();
+  for (long i=1; i<num; i++)
   {
-    cerr << "File boundfit.dat could not be opened" << endl;
-    return(false);
+    if (vec[i].getwave() < wmin) wmin=vec[i].getwave();
+    if (vec[i].getwave() > wmax) wmax=vec[i].getwave();
   }
+  double wmid=(wmax+wmin)/2.0;
+  double wscale=(wmax-wmin)/2.0;
+  if (wscale <= 0.0) wscale=1.0;
+
+  //---------------------------------------------------------------------------
+  //pesos de cada pixel (fraccion de pixel y, si se dispone de ellos, errores)
+  //y funciones base evaluadas en cada pixel
+  workspace.bfweight.resize(num);
+  workspace.bfphi.resize(num*npar);
+  double *weight = &workspace.bfweight[0];
+  double *phi = &workspace.bfphi[0];
+  long ngood=0;
   for (long i=0; i<num; i++)
   {
-    outdatafile << vec[i].getwave()/wnorm
-                << "   " << vec[i].getflux() << endl;
+    weight[i]=vec[i].getpixelfraction();
+    if ( (lerr) && (vec[i].geteflux() > 0.0) )
+    {
+      weight[i]/=vec[i].geteflux()*vec[i].geteflux();
+    }
+    if (weight[i] > 0.0) ngood++;
+    bfitbasis(boundfit,bfitdeg,(vec[i].getwave()-wmid)/wscale,&phi[i*npar]);
   }
-  outdatafile.close();
-  //calculamos ajuste
-  if (boundfit > 0)
+  if (ngood < npar)
   {
-    system("./boundfit_pol.sh > boundfit_pol.log");
+    err << "ERROR in function boundaryfit: insufficient number of pixels"
+        << " (" << ngood << ") to fit " << npar << " parameters" << endl;
+    return(false);
   }
-  else
+
+  //---------------------------------------------------------------------------
+  //ajuste iterativo
+  workspace.bfcoeff.resize(npar);
+  workspace.bfamat.resize(npar*npar);
+  workspace.bfbvec.resize(npar);
+  workspace.bfyfit.resize(num);
+  workspace.bfabove.resize(num);
+  double *coeff = &workspace.bfcoeff[0];
+  double *amat = &workspace.bfamat[0];
+  double *bvec = &workspace.bfbvec[0];
+  double *yfit = &workspace.bfyfit[0];
+  vector <bool> &above = workspace.bfabove;
+  for (long i=0; i<num; i++)
   {
-    system("./boundfit_spl.sh > boundfit_spl.log");
+    above[i]=false;
   }
-  //leemos el ajuste
-  ifstream inputfitfile("boundfit.out",ios::in);
-  if(!inputfitfile)
+  const long nitermax=100;
+  bool lconverged=false;
+  for (long niter=1; (niter <= nitermax) && (!lconverged); niter++)
   {
-    cerr << "File boundfit.out could not be opened" << endl;
-    return(false);
+    //ecuaciones normales del ajuste pesado
+    for (long k=0; k<npar*npar; k++) amat[k]=0.0;
+    for (long k=0; k<npar; k++) bvec[k]=0.0;
+    for (long i=0; i<num; i++)
+    {
+      double w=weight[i];
+      if (w <= 0.0) continue;
+      if (above[i]) w*=1.0+bfitasym;
+      const double *phi_i=&phi[i*npar];
+      const double wy=w*vec[i].getflux();
+      for (long k=0; k<npar; k++)
+      {
+        const double wphi=w*phi_i[k];
+        for (long l=k; l<npar; l++)
+        {
+          amat[k*npar+l]+=wphi*phi_i[l];
+        }
+        bvec[k]+=wy*phi_i[k];
+      }
+    }
+    for (long k=0; k<npar; k++)
+    {
+      for (long l=0; l<k; l++)
+      {
+        amat[k*npar+l]=amat[l*npar+k];
+      }
+    }
+    if(!solvelinsys(npar,amat,bvec,coeff))
+    {
+      err << "ERROR in function boundaryfit: singular system of equations"
+          << endl;
+      return(false);
+    }
+    //evaluamos el ajuste y actualizamos los puntos situados por encima
+    lconverged=true;
+    for (long i=0; i<num; i++)
+    {
+      const double *phi_i=&phi[i*npar];
+      yfit[i]=0.0;
+      for (long k=0; k<npar; k++)
+      {
+        yfit[i]+=coeff[k]*phi_i[k];
+      }
+      const bool newabove=(vec[i].getflux() > yfit[i]);
+      if (newabove != above[i])
+      {
+        above[i]=newabove;
+        lconverged=false;
+      }
+    }
   }
   for (long i=0; i<num; i++)
   {
-    double tempwave,tempflux;
-    inputfitfile >> tempwave >> tempflux;
-    fit[i].setwave(tempwave*wnorm);
-    fit[i].setflux(tempflux);
+    fit[i].setwave(vec[i].getwave());
+    fit[i].setflux(yfit[i]);
     fit[i].seteflux(0.0);
     fit[i].setpixelfraction(vec[i].getpixelfraction());
   }
-  inputfitfile.close();
   //---------------------------------------------------------------------------
   //evaluamos el ajuste en los puntos solicitados
+  workspace.bfphi_eval.resize(npar);
+  double *phi_eval = &workspace.bfphi_eval[0];
   long num_eval=eval.size();
-  if(num_eval > 0)
+  for (long i=0; i<num_eval; i++)
   {
-    if (boundfit > 0) //......................................ajuste polinomico
+    bfitbasis(boundfit,bfitdeg,(eval[i].getwave()-wmid)/wscale,phi_eval);
+    double tempflux=0.0;
+    for (long k=0; k<npar; k++)
     {
-      //leemos grado y coeficientes del ajuste polinomico
-      ifstream inputcoeff("boundfit.coeff",ios::in);
-      if(!inputcoeff)
-      {
-        cerr << "File boundfit.coeff could not be opened" << endl;
-        return(false);
-      }
-      long polydeg;
-      inputcoeff >> polydeg;
-      double * polycoeff = new double [polydeg+1];
-      long idum;
-      for (long i=0; i<=polydeg; i++)
-      {
-        inputcoeff >> idum >> polycoeff[i];
-      }
-      inputcoeff.close();
-      //evaluamos el polinomio ajustado en los pixeles solicitados
-      for (long i=0; i<num_eval; i++)
-      {
-        double tempwave=eval[i].getwave()/wnorm;
-        double tempflux=polycoeff[polydeg];
-        if(polydeg > 0)
-        {
-          for (long k=polydeg; k>=1; k--)
-          {
-            tempflux=tempflux*tempwave+polycoeff[k-1];
-          }
-        }
-        eval[i].setflux(tempflux);
-        eval[i].seteflux(0.01); //ToDo: calcular errores
-      }
-      delete [] polycoeff;
+      tempflux+=coeff[k]*phi_eval[k];
     }
-    else //.............................................ajuste mediante splines
+    eval[i].setflux(tempflux);
+    eval[i].seteflux(0.01); //ToDo: calcular errores
+  }
+  //---------------------------------------------------------------------------
+  return(true);
+}
+
+//-----------------------------------------------------------------------------
+//Evalua en x (normalizado al intervalo [-1,1]) las funciones base del 
+//boundary fit, almacenandolas en phi:
+//boundfit > 0: polinomios de Legendre de grado 0 a bfitdeg
+//boundfit < 0: base de potencias truncadas de un spline cubico con bfitdeg
+//              nodos equiespaciados en [-1,1] (1, x, x^2, x^3 y (x-t_i)^3 
+//              para x > t_i, siendo t_i cada uno de los nodos interiores)
+void bfitbasis(const long boundfit, const long bfitdeg, const double x,
+               double *phi)
+{
+  if (boundfit > 0)
+  {
+    phi[0]=1.0;
+    if (bfitdeg >= 1) phi[1]=x;
+    for (long k=1; k<bfitdeg; k++)
     {
-      //leemos numero de knots, posicion de los knots y coeficientes de los 
-      //splines
-      ifstream inputcoeff("boundfit.coeff",ios::in);
-      if(!inputcoeff)
-      {
-        cerr << "File boundfit.coeff could not be opened" << endl;
-        return(false);
-      }
-      long nknots;
-      inputcoeff >> nknots;
-      double * xknot = new double [nknots];
-      double * yknot = new double [nknots];
-      double * s1 = new double [nknots-1];
-      double * s2 = new double [nknots-1];
-      double * s3 = new double [nknots-1];
-      long idum;
-      for (long i=0; i<nknots; i++)
+      phi[k+1]=(static_cast<double>(2*k+1)*x*phi[k]-
+                static_cast<double>(k)*phi[k-1])/static_cast<double>(k+1);
+    }
+  }
+  else
+  {
+    phi[0]=1.0;
+    phi[1]=x;
+    phi[2]=x*x;
+    phi[3]=x*x*x;
+    for (long i=1; i<bfitdeg-1; i++)
+    {
+      const double xknot=-1.0+2.0*static_cast<double>(i)/
+                         static_cast<double>(bfitdeg-1);
+      const double dx=x-xknot;
+      phi[i+3]=(dx > 0.0) ? dx*dx*dx : 0.0;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//Resuelve el sistema de ecuaciones lineales a*x=b, siendo a una matriz n x n 
+//(almacenada por filas), mediante eliminacion gaussiana con pivotaje parcial.
+//La matriz a y el vector b se modifican. Retorna false si el sistema es
+//singular.
+bool solvelinsys(const long n, double *a, double *b, double *x)
+{
+  for (long k=0; k<n; k++)
+  {
+    //buscamos el pivote
+    long ipiv=k;
+    double amax=fabs(a[k*n+k]);
+    for (long i=k+1; i<n; i++)
+    {
+      if (fabs(a[i*n+k]) > amax)
       {
-        inputcoeff >> idum >> xknot[i] >> yknot[i];
+        amax=fabs(a[i*n+k]);
+        ipiv=i;
       }
-      for (long i=0; i<nknots-1; i++)
+    }
+    if (amax == 0.0) return(false);
+    if (ipiv != k)
+    {
+      for (long j=k; j<n; j++)
       {
-        inputcoeff >> idum >> s3[i] >> s2[i] >> s1[i];
+        const double temp=a[k*n+j];
+        a[k*n+j]=a[ipiv*n+j];
+        a[ipiv*n+j]=temp;
       }
-      inputcoeff.close();
-      //evaluamos el spline ajustado en los pixeles solicitados
-      for (long i=0; i<num_eval; i++)
+      const double temp=b[k];
+      b[k]=b[ipiv];
+      b[ipiv]=temp;
+    }
+    //eliminamos la columna k en las filas siguientes
+    for (long i=k+1; i<n; i++)
+    {
+      const double factor=a[i*n+k]/a[k*n+k];
+      for (long j=k; j<n; j++)
       {
-        double tempwave=eval[i].getwave()/wnorm;
-        long i0 = 0;
-        for (long i=0; i<nknots; i++)
-        {
-          if (tempwave >= xknot[i]) 
-          {
-            i0 = i;
-          }
-        }
-        if (i0 == nknots-1)
-        {
-          i0 = nknots-2;
-        }
-        double dx = tempwave-xknot[i0];
-        double tempflux=yknot[i0];
-        tempflux += dx*(s1[i0]+dx*(s2[i0]+dx*s3[i0]));
-        eval[i].setflux(tempflux);
-        eval[i].seteflux(0.01); //ToDo: calcular errores
+        a[i*n+j]-=factor*a[k*n+j];
       }
-      delete [] xknot;
-      delete [] yknot;
-      delete [] s1;
-      delete [] s2;
-      delete [] s3;
+      b[i]-=factor*b[k];
     }
   }
-  //---------------------------------------------------------------------------
+  //sustitucion hacia atras
+  for (long i=n-1; i>=0; i--)
+  {
+    double sum=b[i];
+    for (long j=i+1; j<n; j++)
+    {
+      sum-=a[i*n+j]*x[j];
+    }
+    x[i]=sum/a[i*n+i];
+  }
   return(true);
 }
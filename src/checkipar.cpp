@@ -26,6 +26,8 @@
 #include <cmath>
 #include <string.h>
 #include <stdlib.h>
+#include <fnmatch.h>
+#include <fcntl.h>
 #include "commandtok.h"
 #include "indexdef.h"
 #include "indexparam.h"
@@ -68,17 +70,11 @@ bool checkipar(vector< CommandToken > &cl, IndexParam &param,
     delete [] filePtr;
     return(false);
   }
-  if(!logfile_if)
+  //Nota: if=undef solo es valido junto con filelist (se comprueba al final)
+  if( (!logfile_if) && (strcmp(filePtr,"undef") != 0) )
   {
-    if(strcmp(filePtr,"undef") == 0)
-    {
-      cout << "FATAL ERROR: you must supply an input file name" << endl;
-    }
-    else
-    {
-      cout << "FATAL ERROR: the file <" << filePtr 
-           << "> does not exist" << endl;
-    }
+    cout << "FATAL ERROR: the file <" << filePtr
+         << "> does not exist" << endl;
     delete [] filePtr;
     return(false);
   }
@@ -104,6 +100,9 @@ bool checkipar(vector< CommandToken > &cl, IndexParam &param,
   //-------------------------
   //index identification name
   //-------------------------
+  //Nota: se admite una lista de indices separados por comas, en la que cada
+  //elemento puede contener comodines (*, ? y [...]); la palabra "all"
+  //selecciona todos los indices definidos.
   nextParameter++;
   labelPtr = cl[nextParameter].getlabel();
   valuePtr = cl[nextParameter].getvalue();
@@ -114,22 +113,55 @@ bool checkipar(vector< CommandToken > &cl, IndexParam &param,
   }
   else
   {
-    unsigned long idfound=0;
+    char *listPtr = new char[strlen(valuePtr)+1];
+    strcpy(listPtr,valuePtr);
+    bool *idselected = new bool [id.size()];
     for (unsigned long i=1; i <= id.size(); i++)
+      idselected[i-1]=false;
+    long nselected=0;
+    char *tokenPtr = strtok(listPtr,",");
+    if (tokenPtr == NULL)
     {
-      if (strcmp(valuePtr,id[i-1].getlabel()) == 0) idfound=i;
-    }
-    if(idfound)
-    {
-      param.set_index(valuePtr); //establecemos el indice
-      param.set_nindex(idfound); //numero de indice(+1) dentro del vector
+      cout << "FATAL ERROR: <" << valuePtr
+           << "> is an invalid argument for the keyword <" << labelPtr
+           << ">" << endl;
+      delete [] listPtr;
+      delete [] idselected;
+      return(false);
     }
-    else
+    while (tokenPtr != NULL)
     {
-      cout << "FATAL ERROR: index identification name <" << valuePtr 
-           << "> is invalid" << endl;
-      return(false);
+      const bool lall = (strcmp(tokenPtr,"all") == 0);
+      unsigned long idfound=0;
+      for (unsigned long i=1; i <= id.size(); i++)
+      {
+        if ( lall || (fnmatch(tokenPtr,id[i-1].getlabel(),0) == 0) )
+        {
+          idfound++;
+          if (!idselected[i-1]) //evitamos medir dos veces el mismo indice
+          {
+            idselected[i-1]=true;
+            if (nselected == 0)
+              param.set_nindex(i); //numero de indice(+1) dentro del vector
+            else
+              param.add_nindex(i);
+            nselected++;
+          }
+        }
+      }
+      if (idfound == 0)
+      {
+        cout << "FATAL ERROR: index identification name <" << tokenPtr 
+             << "> is invalid" << endl;
+        delete [] listPtr;
+        delete [] idselected;
+        return(false);
+      }
+      tokenPtr = strtok(NULL,",");
     }
+    delete [] listPtr;
+    delete [] idselected;
+    param.set_index(valuePtr); //establecemos el indice (o lista de indices)
   }
 
   //----------------
@@ -834,6 +866,468 @@ bool checkipar(vector< CommandToken > &cl, IndexParam &param,
          << ">" << endl;
     return(false);
   }
+  //la comunicacion con pyindexf solo admite un unico indice
+  if ( (param.get_pyindexf()) && (param.get_nindices() > 1) )
+  {
+    cout << "FATAL ERROR: the keyword <" << labelPtr
+         << "> requires a single index in the keyword <index>" << endl;
+    return(false);
+  }
+
+  //----------------------------------------
+  //number of threads to measure the spectra
+  //----------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  for (const char *s=valuePtr; s[0] != '\0'; s++)
+  {
+    if (isdigit(s[0]) == 0) //error: no es un digito valido
+    {
+      cout << "FATAL ERROR: <" << valuePtr
+           << "> is an invalid argument for the keyword <" << labelPtr
+           << ">" << endl;
+      return(false);
+    }
+  }
+  const long nthreads = atol(valuePtr);
+  if(nthreads < 1)
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    cout << "> Number of threads must be >= 1" << endl;
+    return(false);
+  }
+  if( (nthreads > 1) && (plotmode != 0) )
+  {
+    cout << "FATAL ERROR: the keyword <" << labelPtr
+         << "> must be 1 when plotmode != 0" << endl;
+    return(false);
+  }
+  param.set_nthreads(nthreads);
+
+  //------------------------------------------------------------------
+  //boundary fit: polynomial degree (or number of knots) and asymmetry
+  //------------------------------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  double bfitdeg,bfitasym;
+  if(!extract_2numbers(valuePtr,bfitdeg,bfitasym))
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    return(false);
+  }
+  if( (bfitdeg != floor(bfitdeg)) || (bfitdeg < 0) || (bfitdeg > 20) )
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    cout << "> Polynomial degree (or number of knots) must be an integer"
+         << " in the range [0,20]" << endl;
+    return(false);
+  }
+  if( (param.get_boundfit() < 0) && (bfitdeg < 2) )
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    cout << "> Number of knots must be >= 2 when boundfit < 0" << endl;
+    return(false);
+  }
+  if(bfitasym < 0.0)
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    cout << "> Asymmetry coefficient must be >= 0.0" << endl;
+    return(false);
+  }
+  param.set_bfitdeg(static_cast<long>(bfitdeg));
+  param.set_bfitasym(bfitasym);
+
+  //---------------------------------------------
+  //use cumulative flux tables for band integrals
+  //---------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  if ((strcmp(valuePtr,"yes") == 0)||(strcmp(valuePtr,"y") == 0))
+  {
+    param.set_cumflux(true);
+  }
+  else if ((strcmp(valuePtr,"no") == 0)||(strcmp(valuePtr,"n") == 0))
+  {
+    param.set_cumflux(false);
+  }
+  else
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    return(false);
+  }
+
+  //-------------------------------------------------------
+  //radial velocity error estimation (mc, analytic or both)
+  //-------------------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  if (strcmp(valuePtr,"mc") == 0)
+  {
+    param.set_rverrmode(0);
+  }
+  else if (strcmp(valuePtr,"analytic") == 0)
+  {
+    param.set_rverrmode(1);
+  }
+  else if (strcmp(valuePtr,"both") == 0)
+  {
+    param.set_rverrmode(2);
+  }
+  else
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    cout << "> Valid values are: mc, analytic, both" << endl;
+    return(false);
+  }
+
+  //----------------------------------------------
+  //number of spectra read at once from FITS files
+  //----------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  for (const char *s=valuePtr; s[0] != '\0'; s++)
+  {
+    if (isdigit(s[0]) == 0) //error: no es un digito valido
+    {
+      cout << "FATAL ERROR: <" << valuePtr
+           << "> is an invalid argument for the keyword <" << labelPtr
+           << ">" << endl;
+      return(false);
+    }
+  }
+  const long chunksize = atol(valuePtr);
+  if(chunksize < 1)
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    cout << "> Number of spectra per read must be >= 1" << endl;
+    return(false);
+  }
+  param.set_chunksize(chunksize);
+
+  //-------------------------------------------------------------------------
+  //logarithmic wavelength scale: rebin to a linear scale or measure natively
+  //-------------------------------------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  if (strcmp(valuePtr,"rebin") == 0)
+  {
+    param.set_lognative(false);
+  }
+  else if (strcmp(valuePtr,"native") == 0)
+  {
+    param.set_lognative(true);
+  }
+  else
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    cout << "> Valid values are: rebin, native" << endl;
+    return(false);
+  }
+  //la medida en la escala logaritmica original solo esta implementada con
+  //el metodo clasico de las bandas (flujos promedio)
+  if (param.get_lognative())
+  {
+    if ( (param.get_contperc() >= 0) || (param.get_boundfit() != 0) ||
+         (param.get_biaserr() != 0.0) || (param.get_linearerr() != 0.0) ||
+         (param.get_plotmode() != 0) || (param.get_nsimulsn() > 0) )
+    {
+      cout << "FATAL ERROR: the keyword <" << labelPtr
+           << "> must be rebin when using" << endl;
+      cout << "> contperc, boundfit, biaserr, linearerr, plotmode or nsimulsn"
+           << endl;
+      return(false);
+    }
+  }
+
+  //-------------------------------------------------------------
+  //file descriptor for binary pyindexf records (-1: text output)
+  //-------------------------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  char *endPtr;
+  const long pybinfd = strtol(valuePtr,&endPtr,10);
+  if ( (endPtr == valuePtr) || (endPtr[0] != '\0') || (pybinfd < -1) )
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    cout << "> Valid values are: -1 (text output) or a file descriptor"
+         << endl;
+    return(false);
+  }
+  if (pybinfd >= 0)
+  {
+    if (!param.get_pyindexf())
+    {
+      cout << "FATAL ERROR: the keyword <" << labelPtr
+           << "> requires pyindexf=yes" << endl;
+      return(false);
+    }
+    //el descriptor debe haber sido abierto (y heredado) por el proceso que
+    //ejecuta indexf
+    if (fcntl(static_cast<int>(pybinfd),F_GETFD) == -1)
+    {
+      cout << "FATAL ERROR: the file descriptor " << pybinfd
+           << " in the keyword <" << labelPtr << "> is not open" << endl;
+      return(false);
+    }
+  }
+  param.set_pybinfd(pybinfd);
+
+  //---------------------------------------
+  //output FITS table with the measurements
+  //---------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  if (strlen(valuePtr) > 255)
+  {
+    cout << "FATAL ERROR: file name too long in the keyword <" << labelPtr
+         << ">" << endl;
+    return(false);
+  }
+  param.set_of(valuePtr);
+
+  //-------------------------------------------------------------
+  //adaptive simulations: tolerance in the error (0=fixed number)
+  //-------------------------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  const double simtol = strtod(valuePtr,&endPtr);
+  if ( (endPtr == valuePtr) || (endPtr[0] != '\0') || (simtol < 0.0) )
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    cout << "> Tolerance must be >= 0" << endl;
+    return(false);
+  }
+  param.set_simtol(simtol);
+
+  //-------------------------------------------------------------
+  //simulations: random, antithetic pairs or quasi-random (sobol)
+  //-------------------------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  if (strcmp(valuePtr,"random") == 0)
+  {
+    param.set_simmode(0);
+  }
+  else if (strcmp(valuePtr,"antithetic") == 0)
+  {
+    param.set_simmode(1);
+  }
+  else if (strcmp(valuePtr,"sobol") == 0)
+  {
+    param.set_simmode(2);
+  }
+  else
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    cout << "> Valid values are: random, antithetic, sobol" << endl;
+    return(false);
+  }
+
+  //--------------------------------------------------
+  //radial velocity grid: vmin,vmax,dv (undef=no grid)
+  //--------------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  if (strcmp(valuePtr,"undef") != 0)
+  {
+    //extraemos los tres numeros separados por comas
+    double rvgrid[3];
+    const char *numberPtr = valuePtr;
+    bool lvalid = true;
+    for (long i = 0; i < 3; i++)
+    {
+      char *endPtr;
+      rvgrid[i] = strtod(numberPtr,&endPtr);
+      if ( (endPtr == numberPtr) ||
+           (endPtr[0] != ((i < 2) ? ',' : '\0')) )
+      {
+        lvalid = false;
+        break;
+      }
+      numberPtr = endPtr+1;
+    }
+    if ( (!lvalid) || (rvgrid[1] < rvgrid[0]) || (rvgrid[2] <= 0.0) )
+    {
+      cout << "FATAL ERROR: <" << valuePtr
+           << "> is an invalid argument for the keyword <" << labelPtr
+           << ">" << endl;
+      cout << "> Expected vmin,vmax,dv with vmin <= vmax and dv > 0" << endl;
+      return(false);
+    }
+    if ( (rvgrid[1]-rvgrid[0])/rvgrid[2] > 100000.0 )
+    {
+      cout << "FATAL ERROR: <" << valuePtr
+           << "> is an invalid argument for the keyword <" << labelPtr
+           << ">" << endl;
+      cout << "> The number of radial velocities must be <= 100000" << endl;
+      return(false);
+    }
+    //la malla sustituye a la velocidad radial (sin error) de cada espectro
+    if ( (strcmp(param.get_rvfile(),"undef") != 0) ||
+         (param.get_rve() != 0.0) )
+    {
+      cout << "FATAL ERROR: <" << valuePtr
+           << "> is an invalid argument for the keyword <" << labelPtr
+           << ">" << endl;
+      cout << "> The keyword <rvf> must be set to <undef> and the "
+           << "error in <rv> must be 0" << endl;
+      return(false);
+    }
+    if (param.get_nsimulsn() > 0)
+    {
+      cout << "FATAL ERROR: <" << valuePtr
+           << "> is an invalid argument for the keyword <" << labelPtr
+           << ">" << endl;
+      cout << "> The keyword <nsimulsn> must be set to 0" << endl;
+      return(false);
+    }
+    param.set_rvgrid(rvgrid[0],rvgrid[1],rvgrid[2]);
+  }
+
+  //---------------------------------------------
+  //manifest of input files (batch mode, no "if")
+  //---------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  if (strcmp(valuePtr,"undef") == 0)
+  {
+    if (strcmp(param.get_if(),"undef") == 0)
+    {
+      cout << "FATAL ERROR: you must supply an input file name" << endl;
+      return(false);
+    }
+  }
+  else
+  {
+    if (strcmp(param.get_if(),"undef") != 0)
+    {
+      cout << "FATAL ERROR: the keyword <" << labelPtr
+           << "> is incompatible with the keyword <if>" << endl;
+      return(false);
+    }
+    ifstream infile(valuePtr, ios::in); //abrimos en modo solo lectura
+    if (!infile) //error: el fichero no existe
+    {
+      cout << "FATAL ERROR: the file <" << valuePtr
+           << "> does not exist" << endl;
+      return(false);
+    }
+    //la etiqueta de cada espectro se toma del propio fichero de entrada
+    if ( (strcmp(param.get_ilabfile(),"undef") != 0) ||
+         (param.get_plotmode() != 0) || (param.get_pybinfd() >= 0) )
+    {
+      cout << "FATAL ERROR: <" << valuePtr
+           << "> is an invalid argument for the keyword <" << labelPtr
+           << ">" << endl;
+      cout << "> The keywords ilabfile, plotmode and pybinfd cannot be used "
+           << "with a file list" << endl;
+      return(false);
+    }
+  }
+  param.set_filelist(valuePtr);
+
+  //-------------------------------------------------------
+  //spectra read at once stored as: double, float (float32)
+  //-------------------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  if (strcmp(valuePtr,"double") == 0)
+  {
+    param.set_floatstorage(false);
+  }
+  else if (strcmp(valuePtr,"float") == 0)
+  {
+    param.set_floatstorage(true);
+  }
+  else
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    cout << "> Valid values are: double, float" << endl;
+    return(false);
+  }
+
+  //------------------------------------------------------
+  //read uncompressed FITS images through mmap (no copies)
+  //------------------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  if ((strcmp(valuePtr,"yes") == 0)||(strcmp(valuePtr,"y") == 0))
+  {
+    param.set_usemmap(true);
+  }
+  else if ((strcmp(valuePtr,"no") == 0)||(strcmp(valuePtr,"n") == 0))
+  {
+    param.set_usemmap(false);
+  }
+  else
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    return(false);
+  }
+
+  //-------------------------------------------------
+  //read only the pixel columns needed by the indices
+  //-------------------------------------------------
+  nextParameter++;
+  labelPtr = cl[nextParameter].getlabel();
+  valuePtr = cl[nextParameter].getvalue();
+  if ((strcmp(valuePtr,"yes") == 0)||(strcmp(valuePtr,"y") == 0))
+  {
+    param.set_colsubset(true);
+  }
+  else if ((strcmp(valuePtr,"no") == 0)||(strcmp(valuePtr,"n") == 0))
+  {
+    param.set_colsubset(false);
+  }
+  else
+  {
+    cout << "FATAL ERROR: <" << valuePtr
+         << "> is an invalid argument for the keyword <" << labelPtr
+         << ">" << endl;
+    return(false);
+  }
 
   //retornamos con exito
   return(true);
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+//Definicion de funciones miembro de la clase CumulativeFlux, declarada en 
+//cumulativeflux.h
+#include <cstdlib>
+#include "cumulativeflux.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//constructor: calcula las tablas de sumas acumuladas del espectro
+CumulativeFlux::CumulativeFlux(const long naxis1_, const double *sp_data,
+                               const double *sp_error,
+                               const double crval1_, const double cdelt1_,
+                               const double crpix1_)
+{
+  naxis1=naxis1_;
+  crval1=crval1_;
+  cdelt1=cdelt1_;
+  crpix1=crpix1_;
+  flux = new double [naxis1];
+  var = new double [naxis1];
+  cflux = new double [naxis1+1];
+  cvar = new double [naxis1+1];
+  cflux_l2 = new double [naxis1+1];
+  cvar_l4 = new double [naxis1+1];
+  cflux[0]=0.0;
+  cvar[0]=0.0;
+  cflux_l2[0]=0.0;
+  cvar_l4[0]=0.0;
+  for (long j=1; j <= naxis1; j++)
+  {
+    flux[j-1]=sp_data[j-1];
+    if (sp_error != NULL)
+      var[j-1]=sp_error[j-1]*sp_error[j-1];
+    else
+      var[j-1]=0.0;
+    const double wla2=wavelength(j)*wavelength(j);
+    cflux[j]=cflux[j-1]+flux[j-1];
+    cvar[j]=cvar[j-1]+var[j-1];
+    cflux_l2[j]=cflux_l2[j-1]+flux[j-1]*wla2;
+    cvar_l4[j]=cvar_l4[j-1]+var[j-1]*wla2*wla2;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//destructor
+CumulativeFlux::~CumulativeFlux()
+{
+  delete [] flux;
+  delete [] var;
+  delete [] cflux;
+  delete [] cvar;
+  delete [] cflux_l2;
+  delete [] cvar_l4;
+}
+
+//-----------------------------------------------------------------------------
+double CumulativeFlux::getsumflux(const long j1, const long j2,
+                                  const double d1, const double d2) const
+{
+  return(bandsum(cflux,flux[j1-1],flux[j2],j1,j2,1.0-d1,d2));
+}
+
+//-----------------------------------------------------------------------------
+double CumulativeFlux::getsumvar(const long j1, const long j2,
+                                 const double d1, const double d2) const
+{
+  return(bandsum(cvar,var[j1-1],var[j2],j1,j2,(1.0-d1)*(1.0-d1),d2*d2));
+}
+
+//-----------------------------------------------------------------------------
+double CumulativeFlux::getsumflux_l2(const long j1, const long j2,
+                                     const double d1, const double d2) const
+{
+  const double wla1=wavelength(j1);
+  const double wla2=wavelength(j2+1);
+  return(bandsum(cflux_l2,flux[j1-1]*wla1*wla1,flux[j2]*wla2*wla2,
+                 j1,j2,1.0-d1,d2));
+}
+
+//-----------------------------------------------------------------------------
+double CumulativeFlux::getsumvar_l4(const long j1, const long j2,
+                                    const double d1, const double d2) const
+{
+  const double wla1=wavelength(j1);
+  const double wla2=wavelength(j2+1);
+  return(bandsum(cvar_l4,var[j1-1]*wla1*wla1*wla1*wla1,
+                 var[j2]*wla2*wla2*wla2*wla2,
+                 j1,j2,(1.0-d1)*(1.0-d1),d2*d2));
+}
+
+//-----------------------------------------------------------------------------
+//suma pesada de los terminos de la tabla acumulada cum entre los pixeles j1
+//y j2+1, con pesos w1 (pixel j1, cuyo termino es term1), w2 (pixel j2+1,
+//cuyo termino es term2) y 1 (resto de pixeles); si la banda ocupa un unico
+//pixel (j1=j2+1) solo se emplea el peso w1, como en los bucles de mideindex
+double CumulativeFlux::bandsum(const double *cum, 
+                               const double term1, const double term2,
+                               const long j1, const long j2,
+                               const double w1, const double w2) const
+{
+  if (j1 == j2+1)
+    return(w1*term1);
+  return(cum[j2+1]-cum[j1-1]+(w1-1.0)*term1+(w2-1.0)*term2);
+}
+
+//-----------------------------------------------------------------------------
+//longitud de onda en el pixel j (j=1,...,NAXIS1)
+double CumulativeFlux::wavelength(const long j) const
+{
+  return(static_cast<double>(j-1)*cdelt1+crval1-(crpix1-1.0)*cdelt1);
+}
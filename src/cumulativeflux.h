@@ -0,0 +1,68 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+//Declaracion de la clase CumulativeFlux
+//Las funciones miembro se definen en cumulativeflux.cpp
+
+#ifndef CUMULATIVEFLUX_H
+#define CUMULATIVEFLUX_H
+
+//Tablas de sumas acumuladas del flujo y de su varianza en un espectro. Una
+//vez construidas (una unica vez por espectro), la integral en una banda con 
+//fracciones de pixel en los bordes (pesos 1-d1 en el pixel j1, d2 en el 
+//pixel j2+1 y 1 en el resto) se obtiene con dos consultas a la tabla y la
+//correccion de los dos pixeles de los bordes, con independencia de la
+//anchura de la banda. Las tablas con lambda^2 (flujo) y lambda^4 (varianza)
+//permiten calcular las integrales pesadas de las discontinuidades tipo D4000.
+class CumulativeFlux{
+  public:
+    CumulativeFlux(const long,                //NAXIS1
+                   const double *,            //flujo
+                   const double *,            //error (NULL=sin errores)
+                   const double, const double, const double); //CRVAL1,
+                                              //CDELT1,CRPIX1
+    ~CumulativeFlux();
+    //suma de f*flujo en la banda j1,j2 (con fracciones d1,d2 en los bordes)
+    double getsumflux(const long, const long, const double, const double) 
+      const;
+    //suma de f*f*error^2
+    double getsumvar(const long, const long, const double, const double) 
+      const;
+    //suma de f*flujo*lambda^2
+    double getsumflux_l2(const long, const long, const double, const double) 
+      const;
+    //suma de f*f*error^2*lambda^4
+    double getsumvar_l4(const long, const long, const double, const double) 
+      const;
+  private:
+    double bandsum(const double *, const double, const double,
+                   const long, const long, const double, const double) const;
+    double wavelength(const long) const;
+    long naxis1;
+    double crval1,cdelt1,crpix1;
+    double *flux;     //flujo en cada pixel
+    double *var;      //varianza en cada pixel
+    double *cflux;    //sumas acumuladas (cflux[j] = suma de flux[0..j-1])
+    double *cvar;
+    double *cflux_l2;
+    double *cvar_l4;
+};
+
+#endif
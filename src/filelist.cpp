@@ -0,0 +1,418 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <string.h>
+#include <pthread.h>
+#include "fitsio.h"
+#include "indexparam.h"
+#include "indexdef.h"
+#include "scidata.h"
+#include "resulttable.h"
+
+using namespace std;
+
+bool extract_file_2long(const char *, char *, bool &, long &, long &);
+void updatebands(IndexParam &, IndexDef &);
+void verbose(IndexParam &, vector< IndexDef > &, SciData *);
+bool measuresp(SciData *, IndexParam &, vector< IndexDef > &,
+               ResultTable *, const long);
+
+//numero maximo de ficheros abiertos por adelantado
+const long FILELIST_READAHEAD = 4;
+
+//fichero de entrada del manifiesto (keyword filelist)
+struct FileListEntry
+{
+  string file;        //fichero de datos
+  long ns1, ns2;      //espectros a medir (0,0: todos)
+  string ief;         //fichero de errores (vacio: el de la linea de comandos)
+  bool lrv;           //velocidad radial propia (en lugar de rv)
+  double rv, rve;
+  string label;       //etiqueta de todos los espectros del fichero
+};
+
+//datos compartidos entre el hilo principal y el hilo de lectura
+struct FileListData
+{
+  vector< FileListEntry > *entriesPtr;
+  vector< IndexDef > *myindexPtr;
+  vector< IndexParam > fileparam; //parametros de cada fichero
+  vector< SciData * > images;     //ficheros abiertos (NULL: pendiente)
+  bool lopen;             //el hilo de lectura abre los ficheros
+  long nmeasured;         //ficheros ya medidos
+  bool lfinished;         //el hilo principal ha terminado
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+};
+
+bool readfilelist(IndexParam &, vector< FileListEntry > &);
+SciData *openfilelist(const FileListEntry &, IndexParam &,
+                      vector< IndexDef > &);
+void *filelistreader(void *);
+void prefetchfile(const string &);
+
+//-----------------------------------------------------------------------------
+//Modo de proceso por lotes (keyword filelist): los ficheros del manifiesto
+//se miden uno tras otro en el mismo proceso, con las definiciones de los
+//indices y los parametros comunes leidos una unica vez. Un hilo de lectura
+//abre los siguientes ficheros (hasta FILELIST_READAHEAD) y lee su primer
+//bloque de espectros mientras el hilo principal mide el fichero actual;
+//SciData no termina el programa en este modo, sino que guarda los avisos y
+//los errores, que el hilo principal muestra al llegar el turno de cada
+//fichero. Los ficheros que no pueden abrirse o leerse se indican y se
+//omiten, y el resto de ficheros se mide igualmente (la funcion retorna
+//false al final). La salida es la misma que la de ejecutar el programa
+//sobre cada fichero por separado, con la etiqueta de cada fichero al final
+//de cada medida; con el keyword of, todas las medidas se guardan en una
+//unica tabla.
+bool filelist(IndexParam &param, vector< IndexDef > &id)
+{
+  vector< FileListEntry > entries;
+  if (!readfilelist(param,entries)) return(false);
+  if (entries.size() == 0)
+  {
+    cout << "FATAL ERROR: the file <" << param.get_filelist()
+         << "> does not contain any input file" << endl;
+    return(false);
+  }
+  vector< IndexDef > myindex;
+  for (long i=1; i <= param.get_nindices(); i++)
+  {
+    myindex.push_back(id[param.get_nindex(i)-1]);
+    updatebands(param,myindex.back());
+  }
+  //tabla comun para todos los ficheros
+  ResultTable *table = NULL;
+  if (strcmp(param.get_of(),"undef") != 0)
+  {
+    long lindexname = 0;
+    for (unsigned long k = 0; k < myindex.size(); k++)
+    {
+      const long l = strlen(myindex[k].getlabel());
+      if (l > lindexname) lindexname = l;
+    }
+    long llabel = 0;
+    for (unsigned long i = 0; i < entries.size(); i++)
+    {
+      const long l = entries[i].label.length();
+      if (l > llabel) llabel = l;
+    }
+    table = new ResultTable(param.get_of(),lindexname,llabel);
+  }
+  const long nfiles = entries.size();
+  //lanzamos el hilo de lectura; si cfitsio no admite varios hilos, este
+  //solo lee por adelantado el contenido de los ficheros (que el sistema
+  //operativo mantiene en memoria) y los ficheros se abren en el hilo
+  //principal, al igual que si no puede crearse el hilo
+  FileListData fdata;
+  fdata.entriesPtr = &entries;
+  fdata.myindexPtr = &myindex;
+  fdata.fileparam.assign(nfiles,param);
+  fdata.images.assign(nfiles,static_cast<SciData *>(NULL));
+  fdata.lopen = (fits_is_reentrant() != 0);
+  fdata.nmeasured = 0;
+  fdata.lfinished = false;
+  pthread_mutex_init(&fdata.mutex,NULL);
+  pthread_cond_init(&fdata.cond,NULL);
+  pthread_t reader;
+  const bool lreader = (pthread_create(&reader,NULL,filelistreader,
+                                       &fdata) == 0);
+  if (!lreader) fdata.lopen = false;
+  //medimos los ficheros en el orden del manifiesto
+  bool lok = true;
+  long nskipped = 0;
+  for (long i = 0; (i < nfiles) && (lok); i++)
+  {
+    IndexParam &fileparam = fdata.fileparam[i];
+    SciData *imagePtr;
+    if (fdata.lopen)
+    {
+      pthread_mutex_lock(&fdata.mutex);
+      while (fdata.images[i] == NULL)
+        pthread_cond_wait(&fdata.cond,&fdata.mutex);
+      imagePtr = fdata.images[i];
+      fdata.images[i] = NULL;
+      pthread_mutex_unlock(&fdata.mutex);
+    }
+    else
+    {
+      imagePtr = openfilelist(entries[i],fileparam,myindex);
+    }
+    cout << imagePtr->getmessages() << flush;
+    if (imagePtr->isvalid())
+    {
+      if (param.get_verbose()) verbose(fileparam,myindex,imagePtr);
+      lok = measuresp(imagePtr,fileparam,myindex,table,i);
+    }
+    else if (!imagePtr->getreaderror().empty())
+    {
+      //error al leer el primer bloque (en openfilelist); los errores de
+      //lectura posteriores los muestra measuresp
+      cout << imagePtr->getreaderror() << endl;
+    }
+    //los errores de lectura solo afectan a este fichero; los de la medida
+    //(mideindex) se repetirian en los demas y terminan el proceso
+    if (!imagePtr->isvalid())
+    {
+      cout << "ERROR: skipping file <" << entries[i].file << ">" << endl;
+      nskipped++;
+      lok = true;
+    }
+    delete imagePtr;
+    pthread_mutex_lock(&fdata.mutex);
+    fdata.nmeasured++;
+    pthread_cond_broadcast(&fdata.cond);
+    pthread_mutex_unlock(&fdata.mutex);
+  }
+  pthread_mutex_lock(&fdata.mutex);
+  fdata.lfinished = true;
+  pthread_cond_broadcast(&fdata.cond);
+  pthread_mutex_unlock(&fdata.mutex);
+  if (lreader) pthread_join(reader,NULL);
+  pthread_mutex_destroy(&fdata.mutex);
+  pthread_cond_destroy(&fdata.cond);
+  //ficheros abiertos por adelantado que no han llegado a medirse
+  for (long i = 0; i < nfiles; i++)
+    delete fdata.images[i];
+  delete table; //escribe las filas pendientes y cierra el fichero
+  if (nskipped > 0)
+  {
+    cout << "ERROR: " << nskipped << " file(s) of " << param.get_filelist()
+         << " could not be measured" << endl;
+  }
+  return( (lok) && (nskipped == 0) );
+}
+
+//-----------------------------------------------------------------------------
+//hilo de lectura: abre los ficheros siguientes (ver openfilelist), sin
+//adelantarse mas de FILELIST_READAHEAD ficheros al hilo principal, y los
+//deja en fdata->images; si fdata->lopen es false, solo lee su contenido
+//(datos y, en su caso, errores) para que el hilo principal los encuentre
+//ya en memoria
+void *filelistreader(void *arg)
+{
+  FileListData *fdata = static_cast<FileListData *>(arg);
+  vector< FileListEntry > &entries = *(fdata->entriesPtr);
+  //copia propia de los indices (columnwindow)
+  vector< IndexDef > myindex = *(fdata->myindexPtr);
+  const long nfiles = entries.size();
+  for (long i = 0; i < nfiles; i++)
+  {
+    pthread_mutex_lock(&fdata->mutex);
+    while ( (!fdata->lfinished) &&
+            (i-fdata->nmeasured >= FILELIST_READAHEAD) )
+      pthread_cond_wait(&fdata->cond,&fdata->mutex);
+    const bool lfinished = fdata->lfinished;
+    pthread_mutex_unlock(&fdata->mutex);
+    if (lfinished) break;
+    if (fdata->lopen)
+    {
+      SciData *imagePtr = openfilelist(entries[i],fdata->fileparam[i],
+                                       myindex);
+      pthread_mutex_lock(&fdata->mutex);
+      fdata->images[i] = imagePtr;
+      pthread_cond_broadcast(&fdata->cond);
+      pthread_mutex_unlock(&fdata->mutex);
+    }
+    else
+    {
+      prefetchfile(entries[i].file);
+      if ( (!entries[i].ief.empty()) && (entries[i].ief != "undef") )
+        prefetchfile(entries[i].ief);
+    }
+  }
+  return(NULL);
+}
+
+//-----------------------------------------------------------------------------
+//lee un fichero completo (descartando su contenido) para que el sistema
+//operativo lo mantenga en memoria
+void prefetchfile(const string &file)
+{
+  ifstream infile(file.c_str(),ios::in|ios::binary);
+  char buffer[65536];
+  while (infile.read(buffer,sizeof(buffer))) {}
+}
+
+//-----------------------------------------------------------------------------
+//abre un fichero del manifiesto sin terminar el programa si se produce un
+//error (ver SciData::isvalid y SciData::getmessages); param contiene
+//inicialmente los parametros comunes, y se completa con los del manifiesto
+//(y con ns1 y ns2 reales). Si el fichero es valido, se seleccionan las
+//columnas que se leen (como en measuresp, que ya no las modifica) y se lee
+//el bloque que contiene el primer espectro.
+SciData *openfilelist(const FileListEntry &entry, IndexParam &param,
+                      vector< IndexDef > &myindex)
+{
+  param.set_if(entry.file.c_str());
+  param.set_ns1(entry.ns1);
+  param.set_ns2(entry.ns2);
+  if (!entry.ief.empty()) param.set_ief(entry.ief.c_str());
+  if (entry.lrv) param.set_rv(entry.rv,entry.rve);
+  SciData *imagePtr = new SciData(param,false); //actualiza ns1 y ns2
+  if (!imagePtr->isvalid()) return(imagePtr);
+  imagePtr->setlabelsp(entry.label.c_str());
+  const long naxis1 = imagePtr->getnaxis1();
+  long colj1 = 1, colj2 = naxis1;
+  if (param.get_colsubset())
+    imagePtr->columnwindow(param,myindex,colj1,colj2);
+  imagePtr->setcolumns(colj1,colj2);
+  double *sp_data = new double [naxis1];
+  double *sp_error = new double [naxis1];
+  double *sp_temp = new double [naxis1];
+  imagePtr->getspectrum(param.get_ns1(),sp_data,sp_error,sp_temp);
+  delete [] sp_data;
+  delete [] sp_error;
+  delete [] sp_temp;
+  return(imagePtr);
+}
+
+//-----------------------------------------------------------------------------
+//lee el manifiesto: una linea por fichero de entrada, con el mismo formato
+//que el keyword if (fichero[,ns1,ns2]) seguido, opcionalmente, de
+//rv=rv[,rve], ief=fichero y label=etiqueta (sin espacios en blanco); las
+//lineas vacias y las que comienzan por # se ignoran. Sin label, la etiqueta
+//es el nombre del fichero.
+bool readfilelist(IndexParam &param, vector< FileListEntry > &entries)
+{
+  const char *const filelistPtr = param.get_filelist();
+  ifstream infile(filelistPtr,ios::in);
+  if (!infile)
+  {
+    cout << "FATAL ERROR: while opening the file " << filelistPtr << endl;
+    return(false);
+  }
+  string s;
+  long nline=0;
+  while (getline(infile,s))
+  {
+    nline++;
+    //tabuladores y retornos de carro equivalen a espacios en blanco
+    for (unsigned long i = 0; i < s.length(); i++)
+      if ( (s[i] == '\t') || (s[i] == '\r') ) s[i]=' ';
+    istringstream line(s);
+    string token;
+    if (!(line >> token)) continue; //linea vacia
+    if (token[0] == '#') continue;  //comentario
+    FileListEntry entry;
+    char *filePtr = new char[token.length()+1];
+    bool lexist;
+    const bool lvalid = extract_file_2long(token.c_str(),filePtr,lexist,
+                                           entry.ns1,entry.ns2);
+    entry.file = filePtr;
+    delete [] filePtr;
+    if ( (!lvalid) || (entry.ns1 < 0) || (entry.ns2 < entry.ns1) ||
+         ( (entry.ns1 == 0) && (entry.ns2 != 0) ) )
+    {
+      cout << "FATAL ERROR: <" << token << "> is an invalid input file "
+           << "in line " << nline << " of " << filelistPtr << endl;
+      return(false);
+    }
+    if (!lexist)
+    {
+      cout << "FATAL ERROR: the file <" << entry.file << "> (line "
+           << nline << " of " << filelistPtr << ") does not exist" << endl;
+      return(false);
+    }
+    entry.lrv = false;
+    entry.rv = entry.rve = 0.0;
+    entry.label = entry.file;
+    while (line >> token)
+    {
+      const size_t equal = token.find('=');
+      const string key = token.substr(0,equal);
+      const string value = (equal == string::npos) ? "" :
+                           token.substr(equal+1);
+      bool lvalue = !value.empty();
+      if ( (lvalue) && (key == "rv") )
+      {
+        char *endPtr;
+        entry.rv = strtod(value.c_str(),&endPtr);
+        if (endPtr[0] == ',')
+        {
+          const char *rvePtr = endPtr+1;
+          entry.rve = strtod(rvePtr,&endPtr);
+          if (endPtr == rvePtr) lvalue = false;
+        }
+        lvalue = lvalue && (endPtr != value.c_str()) && (endPtr[0] == '\0')
+                 && (entry.rve >= 0.0);
+        //misma compatibilidad que el keyword rv en checkipar
+        if ( (lvalue) && ( (strcmp(param.get_rvfile(),"undef") != 0) ||
+             ( (param.get_nrvgrid() > 0) && (entry.rve != 0.0) ) ) )
+        {
+          cout << "FATAL ERROR: <" << token << "> in line " << nline
+               << " of " << filelistPtr << " is incompatible with the "
+               << "keywords <rvf> and <rvgrid>" << endl;
+          return(false);
+        }
+        entry.lrv = true;
+      }
+      else if ( (lvalue) && (key == "ief") )
+      {
+        if (strcmp(param.get_snf(),"undef") != 0)
+        {
+          cout << "FATAL ERROR: <" << token << "> in line " << nline
+               << " of " << filelistPtr << " is incompatible with the "
+               << "keyword <snf>" << endl;
+          return(false);
+        }
+        if (value != "undef")
+        {
+          ifstream errorfile(value.c_str(),ios::in);
+          if (!errorfile)
+          {
+            cout << "FATAL ERROR: the file <" << value << "> (line "
+                 << nline << " of " << filelistPtr << ") does not exist"
+                 << endl;
+            return(false);
+          }
+        }
+        entry.ief = value;
+      }
+      else if ( (lvalue) && (key == "label") )
+      {
+        entry.label = value;
+      }
+      else
+      {
+        lvalue = false;
+      }
+      if (!lvalue)
+      {
+        cout << "FATAL ERROR: <" << token << "> is invalid in line "
+             << nline << " of " << filelistPtr << endl;
+        cout << "> Expected rv=rv[,rve], ief=file or label=text" << endl;
+        return(false);
+      }
+    }
+    entries.push_back(entry);
+  }
+  return(true);
+}
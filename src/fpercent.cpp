@@ -23,6 +23,9 @@
 #include <vector>
 #include <algorithm>
 #include "genericpixel.h"
+#include "randomstream.h"
+#include "runningstats.h"
+#include "mideworkspace.h"
 
 using namespace std;
  
@@ -38,9 +41,15 @@ bool sortGenericPixel (GenericPixel pix1, GenericPixel pix2)
 //las fracciones de pixel en los bordes de las bandas: pixels completos tienen
 //un peso de 1 y pixels fraccionados tienen como peso la fraccion
 //correspondiente). La incertidumbre se calcula mediante simulaciones (solo en
-//el caso en el que lerr=true).
+//el caso en el que lerr=true), tomando los numeros aleatorios de rstream; si
+//simtol > 0, las simulaciones se detienen cuando la incertidumbre converge
+//(ver runningstats.h). Los vectores auxiliares se toman de workspace, de
+//forma que no se reserva memoria en cada llamada. Los mensajes de error se
+//envian a err.
 bool fpercent(vector <GenericPixel> &vec, const long percent, const bool lerr,
-              double *fpercentPtr, double *e2fpercentPtr)
+              const double simtol, RandomStream &rstream,
+              double *fpercentPtr, double *e2fpercentPtr,
+              MideWorkspace &workspace, ostream &err)
 {
   //---------------------------------------------------------------------------
   //valores retornados en caso de error o imposibilidad de calculo
@@ -51,14 +60,14 @@ bool fpercent(vector <GenericPixel> &vec, const long percent, const bool lerr,
   //protecciones
   if ( (percent < 0) || (percent > 100) )
   {
-    cout << "ERROR in function fpercent: percent = " << percent << endl;
+    err << "ERROR in function fpercent: percent = " << percent << endl;
     return(false);
   }
 
   long num=vec.size();
   if (num <= 0)
   {
-    cout << "ERROR in function fpercent: vector size = 0" << endl;
+    err << "ERROR in function fpercent: vector size = 0" << endl;
     return(false);
   }
 
@@ -66,27 +75,27 @@ bool fpercent(vector <GenericPixel> &vec, const long percent, const bool lerr,
 
   //---------------------------------------------------------------------------
   //para estimar la incertidumbre realizamos nsimulmax simulaciones; 
-  vector <double> fpercentSimul; //aqui almacenamos resultados de simulaciones
+  //aqui almacenamos resultados de simulaciones
+  vector <double> &fpercentSimul = workspace.fpsimul;
+  fpercentSimul.clear();
+  vector <GenericPixel> &simulatedFlux = workspace.fpsimulated;
+  vector <double> &fluxsorted = workspace.fpsorted;
+  vector <double> &Sn = workspace.fpsn;
+  vector <double> &pn = workspace.fppn;
   const long nsimulmax=100;
-  const double pi2 = 4.*acos(0.0);
-  const double sqrt2 = sqrt(2.0);
-  const double fRAND_MAX = static_cast<double>(RAND_MAX);
+  long nsimul=nsimulmax; //numero de simulaciones realizadas
+  RunningStats stats(simtol);
   for (long isimul=0; isimul <= nsimulmax; isimul++)
   {
     //generamos un vector flujo aleatorizado (si isimul=0 se toman los datos
     //originales sin aleatorizar)
-    vector <GenericPixel> simulatedFlux=vec;
+    simulatedFlux=vec;
     if (isimul > 0)
     {
       for (long i=0; i<num; i++)
       {
-        long iran; //evitamos obtener ran1=1 y ran2=1
-        while ( (iran=rand()) == RAND_MAX);
-        const double ran1 = static_cast<double>(iran)/fRAND_MAX;
-        while ( (iran=rand()) == RAND_MAX);
-        const double ran2 = static_cast<double>(iran)/fRAND_MAX;
         double tempflux = vec[i].getflux();
-        tempflux+=sqrt2*vec[i].geteflux()*sqrt(-1*log(1-ran1))*cos(pi2*ran2);
+        tempflux+=vec[i].geteflux()*rstream.gaussian();
         simulatedFlux[i].setflux(tempflux);
       }
     }
@@ -101,13 +110,13 @@ bool fpercent(vector <GenericPixel> &vec, const long percent, const bool lerr,
       //definida mas arriba
       sort(simulatedFlux.begin(),simulatedFlux.end(),sortGenericPixel);
       //generamos un vector auxiliar con los valores del flujo ordenados
-      vector <double> fluxsorted;
+      fluxsorted.clear();
       for (long i=0; i<num; i++)
       {
         fluxsorted.push_back(simulatedFlux[i].getflux());
       }
       //calculamos las sumas parciales de los pesos
-      vector <double> Sn;
+      Sn.clear();
       for (long i=0; i<num; i++)
       {
         if(i == 0)
@@ -120,7 +129,7 @@ bool fpercent(vector <GenericPixel> &vec, const long percent, const bool lerr,
         }
       }
       //calculamos percentiles correspondientes a cada elemento de fluxsorted
-      vector <double> pn;
+      pn.clear();
       for (long i=0; i<num; i++)
       {
         pn.push_back(100./Sn[num-1]*
@@ -155,24 +164,33 @@ bool fpercent(vector <GenericPixel> &vec, const long percent, const bool lerr,
       *e2fpercentPtr=0;
       return(true);
     }
+    if (isimul > 0)
+    {
+      stats.add(fpercentSimul[isimul]);
+      if (stats.converged())
+      {
+        nsimul=isimul;
+        break;
+      }
+    }
     /*cout << "nsimul: " << isimul << " " 
          << fpercentSimul.size() << " "
          << fpercentSimul[isimul] << endl;*/
   }
   //calculamos media y r.m.s. de los valores simulados
   double meanSimul=0.0;
-  for (long isimul=1; isimul <= nsimulmax; isimul++)
+  for (long isimul=1; isimul <= nsimul; isimul++)
   {
     meanSimul+=fpercentSimul[isimul];
   }
-  meanSimul/=static_cast<double>(nsimulmax);
+  meanSimul/=static_cast<double>(nsimul);
   double sigmaSimul=0.0;
-  for (long isimul=1; isimul <= nsimulmax; isimul++)
+  for (long isimul=1; isimul <= nsimul; isimul++)
   {
     sigmaSimul+=(fpercentSimul[isimul]-meanSimul)*
                 (fpercentSimul[isimul]-meanSimul);
   }
-  sigmaSimul=sqrt(sigmaSimul/static_cast<double>(nsimulmax-1));
+  sigmaSimul=sqrt(sigmaSimul/static_cast<double>(nsimul-1));
   *e2fpercentPtr=sigmaSimul*sigmaSimul;
 
   /*cout << "mean, sigma: " << meanSimul << " " << sigmaSimul << endl;*/
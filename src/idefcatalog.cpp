@@ -0,0 +1,153 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "indexdef.h"
+
+using namespace std;
+
+//Catalogo binario de indices (indexf --compile-defs): cabecera seguida de
+//los objetos IndexDef tal y como estan en memoria, de modo que el fichero
+//se carga con un unico mmap. El catalogo solo es valido para el mismo
+//programa que lo genero (se comprueba el tamano de IndexDef) y para el
+//mismo fichero de texto (se comprueban su fecha y su tamano); en caso
+//contrario se leen de nuevo las definiciones en modo texto.
+const int64_t IDEFCAT_VERSION = 2;
+struct IdefCatalogHeader
+{
+  char magic[8];        //"IDXFCAT"
+  int64_t version;      //version del formato
+  int64_t recordsize;   //sizeof(IndexDef)
+  int64_t nindex;       //numero de indices
+  int64_t txtmtime;     //fecha de modificacion del fichero de texto
+  int64_t txtsize;      //tamano del fichero de texto
+};
+
+//-----------------------------------------------------------------------------
+//lee el catalogo catfilePtr, generado a partir de txtfilePtr; retorna false
+//(sin mensajes de error) si no existe o no corresponde al fichero de texto
+bool readidefcat(const char *catfilePtr, const char *txtfilePtr,
+                 vector< IndexDef > &id)
+{
+  struct stat txtstat, catstat;
+  if (stat(txtfilePtr,&txtstat) != 0) return(false);
+  const int fd = open(catfilePtr,O_RDONLY);
+  if (fd < 0) return(false);
+  if ( (fstat(fd,&catstat) != 0) ||
+       (catstat.st_size < static_cast<off_t>(sizeof(IdefCatalogHeader))) )
+  {
+    close(fd);
+    return(false);
+  }
+  const size_t catsize = catstat.st_size;
+  void *mapPtr = mmap(NULL,catsize,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if (mapPtr == MAP_FAILED) return(false);
+  const IdefCatalogHeader *headerPtr = 
+    static_cast<const IdefCatalogHeader *>(mapPtr);
+  const bool lvalid = 
+    (strcmp(headerPtr->magic,"IDXFCAT") == 0) &&
+    (headerPtr->version == IDEFCAT_VERSION) &&
+    (headerPtr->recordsize == static_cast<int64_t>(sizeof(IndexDef))) &&
+    (headerPtr->txtmtime == static_cast<int64_t>(txtstat.st_mtime)) &&
+    (headerPtr->txtsize == static_cast<int64_t>(txtstat.st_size)) &&
+    (headerPtr->nindex >= 0) &&
+    (catsize == sizeof(IdefCatalogHeader)+
+                static_cast<size_t>(headerPtr->nindex)*sizeof(IndexDef));
+  if (lvalid)
+  {
+    const IndexDef *recordPtr = reinterpret_cast<const IndexDef *>(
+      static_cast<const char *>(mapPtr)+sizeof(IdefCatalogHeader));
+    id.assign(recordPtr,recordPtr+headerPtr->nindex);
+  }
+  munmap(mapPtr,catsize);
+  return(lvalid);
+}
+
+//-----------------------------------------------------------------------------
+//comprueba las definiciones de los indices leidas de txtfilePtr y genera el
+//catalogo catfilePtr
+bool writeidefcat(const char *catfilePtr, const char *txtfilePtr,
+                  vector< IndexDef > &id)
+{
+  //comprobaciones
+  for (unsigned long i = 0; i < id.size(); i++)
+  {
+    for (unsigned long j = 0; j < i; j++)
+    {
+      if (strcmp(id[i].getlabel(),id[j].getlabel()) == 0)
+      {
+        cout << "FATAL ERROR: index " << id[i].getlabel() 
+             << " is defined twice" << endl;
+        cout << "--> check file " << txtfilePtr << endl;
+        return(false);
+      }
+    }
+    for (long nb = 0; nb < id[i].getnbands(); nb++)
+    {
+      if ( (id[i].getldo1(nb) <= 0.0) ||
+           (id[i].getldo1(nb) >= id[i].getldo2(nb)) )
+      {
+        cout << "FATAL ERROR: invalid band limits" << endl;
+        cout << "--> index= " << id[i].getlabel() << endl;
+        cout << "--> band= " << nb+1 << endl;
+        cout << "--> check file " << txtfilePtr << endl;
+        return(false);
+      }
+    }
+  }
+  //generamos el catalogo
+  struct stat txtstat;
+  if (stat(txtfilePtr,&txtstat) != 0)
+  {
+    cout << "FATAL ERROR: while reading the file " << txtfilePtr << endl;
+    return(false);
+  }
+  IdefCatalogHeader header;
+  memset(&header,0,sizeof(header));
+  strcpy(header.magic,"IDXFCAT");
+  header.version = IDEFCAT_VERSION;
+  header.recordsize = sizeof(IndexDef);
+  header.nindex = id.size();
+  header.txtmtime = txtstat.st_mtime;
+  header.txtsize = txtstat.st_size;
+  ofstream catfile(catfilePtr,ios::out|ios::binary|ios::trunc);
+  catfile.write(reinterpret_cast<const char *>(&header),sizeof(header));
+  if (id.size() > 0)
+    catfile.write(reinterpret_cast<const char *>(&id[0]),
+                  id.size()*sizeof(IndexDef));
+  catfile.close();
+  if (!catfile)
+  {
+    cout << "FATAL ERROR: while writing the file " << catfilePtr << endl;
+    unlink(catfilePtr);
+    return(false);
+  }
+  cout << "#Index catalogue..: " << catfilePtr << " (" << id.size() 
+       << " indices)" << endl;
+  return(true);
+}
@@ -20,15 +20,12 @@
 
 //Definicion de funciones miembro de la clase IndexDef, declarada en 
 //indexdef.h
-#include <iostream>
 #include <string.h>
-#include <cstdlib>
 #include "indexdef.h"
 
-using namespace std;
-
 //-----------------------------------------------------------------------------
-//constructor
+//constructor; si el tipo de indice no es valido, el objeto queda marcado
+//como no valido (ver isvalid), sin bandas
 IndexDef::IndexDef(const char *idlabel, const long &idtype)
 {
   long length = strlen(idlabel);
@@ -36,6 +33,18 @@ IndexDef::IndexDef(const char *idlabel, const long &idtype)
   strncpy(label,idlabel,length);
   label[length] = '\0';
   type = idtype;
+  //las bandas se definen posteriormente mediante setldo
+  for (long nb=0; nb < 198; nb++)
+  {
+    ldo1[nb]=ldo2[nb]=0.0;
+  }
+  for (long nb=0; nb < 99; nb++)
+  {
+    factor[nb]=0.0;
+  }
+  nldo=0;
+  ldomin=ldomax=0.0;
+  lvalid=true;
   if(type == 1) //indices moleculares
   {
     nbands=3;
@@ -92,20 +101,25 @@ IndexDef::IndexDef(const char *idlabel, const long &idtype)
   }
   else
   {
-    cout << "FATAL ERROR: index type=" << type << " is not valid" << endl;
-    cout << "--> Check file indexdef.dat, index: " << idlabel << endl;
-    exit(1);
+    nbands=0;
+    nconti=0;
+    nlines=0;
+    lvalid=false;
   }
 }
 
 //-----------------------------------------------------------------------------
+//Las funciones de esta clase forman parte de libindexf, por lo que no
+//muestran mensajes ni terminan el programa: si los argumentos no son
+//validos, las funciones set* no modifican las bandas, marcan el objeto como
+//no valido (ver isvalid) y retornan false; los metodos get* retornan 0 para
+//bandas inexistentes
 bool IndexDef::setnbands(const long &nb)
 {
-  if( nb <= 0 )
+  if( (nb <= 0) || (nb > 198) )
   {
-    cout << "FATAL ERROR: number of bands must be > 0)" << endl;
-    cout << "--> nb=" << nb << endl;
-    exit(1);
+    lvalid=false;
+    return(false);
   }
   nbands=nb;
   return(true);
@@ -114,11 +128,10 @@ bool IndexDef::setnbands(const long &nb)
 //-----------------------------------------------------------------------------
 bool IndexDef::setnconti(const long &nb)
 {
-  if( nb <= 0 )
+  if( (nb <= 0) || (nb > 198) )
   {
-    cout << "FATAL ERROR: number of continuum bands must be > 0)" << endl;
-    cout << "--> nb=" << nb << endl;
-    exit(1);
+    lvalid=false;
+    return(false);
   }
   nconti=nb;
   return(true);
@@ -127,11 +140,10 @@ bool IndexDef::setnconti(const long &nb)
 //-----------------------------------------------------------------------------
 bool IndexDef::setnlines(const long &nb)
 {
-  if( nb <= 0 )
+  if( (nb <= 0) || (nb > 99) )
   {
-    cout << "FATAL ERROR: number of line bands must be > 0)" << endl;
-    cout << "--> nb=" << nb << endl;
-    exit(1);
+    lvalid=false;
+    return(false);
   }
   nlines=nb;
   return(true);
@@ -142,41 +154,41 @@ bool IndexDef::setldo(const long &nb, const double &l1, const double &l2)
 {
   if( (nb < 0) || (nb > nbands-1) )
   {
-    cout << "FATAL ERROR: nb=" << nb+1 << " (nbands=" << nbands << ")" << endl;
-    exit(1);
+    lvalid=false;
+    return(false);
   }
   ldo1[nb]=l1;
   ldo2[nb]=l2;
+  updateedges(nb);
   return(true);
 }
 
 //-----------------------------------------------------------------------------
+//define una banda de lineas (nb > nconti-1) con su factor
 bool IndexDef::setldo(const long &nb, const double &l1, const double &l2, 
                       const double &fact)
 {
-  if( (nb < 0) || (nb > nbands-1) )
+  if( (nb < 0) || (nb > nbands-1) || (nb <= nconti-1) ||
+      (nb-nconti > 98) )
   {
-    cout << "FATAL ERROR: in indexdef.cpp while defining index " << label 
-         << endl;
-    cout << "             nb=" << nb+1 << " (nbands=" << nbands << ")" << endl;
-    exit(1);
+    lvalid=false;
+    return(false);
   }
   ldo1[nb]=l1;
   ldo2[nb]=l2;
-  if (nb > nconti-1)
-  {
-    factor[nb-nconti]=fact;
-  }
-  else
-  {
-    cout << "FATAL ERROR: in indexdef.cpp while defining index " << label 
-         << endl;
-    cout << "             nb=" << nb+1 << " (nconti=" << nconti << ")" << endl;
-    exit(1);
-  }
+  updateedges(nb);
+  factor[nb-nconti]=fact;
   return(true);
 }
 
+//-----------------------------------------------------------------------------
+//el indice es valido si su tipo lo es, todas sus bandas estan definidas y
+//no se ha producido ningun error al definirlas
+bool IndexDef::isvalid() const
+{
+  return( (lvalid) && (nbands >= 1) && (nldo == nbands) );
+}
+
 //-----------------------------------------------------------------------------
 char *IndexDef::getlabel() { return label; }
 
@@ -194,28 +206,18 @@ long IndexDef::getnlines() const { return nlines; }
 
 //-----------------------------------------------------------------------------
 double IndexDef::getldo1(const long &nb) const
-{ 
+{
   if ( (nb >= 0) && (nb <= nbands-1) )
     return ldo1[nb];
-  else
-  {
-    cout << "FATAL ERROR: invalid band number (nb =" << nb+1 << ", " 
-         << "nbands=" << nbands << ") in IndexDef::getldo1" << endl;
-    exit(1);
-  }
+  return(0.0);
 }
 
 //-----------------------------------------------------------------------------
 double IndexDef::getldo2(const long &nb) const
-{ 
+{
   if ( (nb >= 0) && (nb <= nbands-1) )
     return ldo2[nb];
-  else
-  {
-    cout << "FATAL ERROR: invalid band number (nb =" << nb+1 << ", " 
-         << "nbands=" << nbands << ") in IndexDef::getldo2" << endl;
-    exit(1);
-  }
+  return(0.0);
 }
 
 //-----------------------------------------------------------------------------
@@ -223,23 +225,35 @@ double IndexDef::getfactor(const long &nb) const
 {
   if ( (nb >= 0) && (nb <= nlines-1) )
     return factor[nb];
-  else
-  {
-    cout << "FATAL ERROR: invalid band number (nb=" << nb+1 << ", " 
-         << "nlines=" << nlines << ") in IndexDef::getfactor" << endl;
-    exit(1);
-  }
+  return(0.0);
 }
 
 //-----------------------------------------------------------------------------
 double IndexDef::getfactor_el(const long &nb) const 
 {
-  if ( (nb >= 0) && (nb <= nbands-1) )
+  if ( (nb >= 0) && (nb <= nbands-1) && (nb <= 98) )
     return factor[nb];
-  else
+  return(0.0);
+}
+
+//-----------------------------------------------------------------------------
+double IndexDef::getldomin() const { return ldomin; }
+
+//-----------------------------------------------------------------------------
+double IndexDef::getldomax() const { return ldomax; }
+
+//-----------------------------------------------------------------------------
+//actualiza los limites azul y rojo del conjunto de bandas ya definidas
+//(nb es la banda que se acaba de definir), de forma que mideindex no tenga
+//que recorrer todas las bandas en cada medida
+void IndexDef::updateedges(const long &nb)
+{
+  if (nb+1 > nldo) nldo=nb+1;
+  ldomin=ldo1[0];
+  ldomax=ldo2[0];
+  for (long i=1; i < nldo; i++)
   {
-    cout << "FATAL ERROR: invalid band number (nb=" << nb+1 << ", " 
-         << "nbands=" << nbands << ") in IndexDef::getfactor_el" << endl;
-    exit(1);
+    if (ldomin > ldo1[i]) ldomin=ldo1[i];
+    if (ldomax < ldo2[i]) ldomax=ldo2[i];
   }
 }
@@ -41,15 +41,23 @@ class IndexDef{
     double getldo2(const long &) const;
     double getfactor(const long &) const;
     double getfactor_el(const long &) const;
+    double getldomin() const;
+    double getldomax() const;
+    bool isvalid() const;
   private:
+    void updateedges(const long &);
     char label[9]; //nombre del ndice (mximo 8 caracteres)
     long type;    //tipo de ndice
+    bool lvalid;  //tipo de ndice vlido
     long nbands;  //nmero total de bandas (=nconti+nlines)
     long nconti;  //nmero de bandas de continuo
     long nlines;  //nmero de bandas de lneas
     double ldo1[198];//longitud de onda izquierda de cada banda
     double ldo2[198];//longitud de onda derecha de cada banda
     double factor[99];//factores para bandas de lneas
+    long nldo;       //nmero de bandas con lmites ya definidos
+    double ldomin;   //lmite azul de todas las bandas
+    double ldomax;   //lmite rojo de todas las bandas
 };
 
 #endif
@@ -19,6 +19,7 @@
  */
 
 #include <iostream>
+#include <string.h>
 #include <vector>
 #include "commandtok.h"
 #include "installdir.h"
@@ -26,6 +27,7 @@
 #include "indexparam.h"
 #include "indexdef.h"
 #include "scidata.h"
+#include "resulttable.h"
 
 using namespace std;
 bool pyindexf_global;
@@ -34,15 +36,18 @@ bool pyindexf_global;
 //prototipos de funciones
 bool checkpyind(const char *[], const int);
 int  pyexit(const int);
-bool loadidef(vector< IndexDef > &);
+bool loadidef(vector< IndexDef > &, const bool);
 void showindex(vector< IndexDef > &);
 bool loaddpar(vector< CommandToken > &);
 bool loadipar(const char *[], const int, vector< CommandToken > &);
 bool checkipar(vector< CommandToken > &, IndexParam &, vector< IndexDef > &);
 void welcome(bool);
 void updatebands(IndexParam &, IndexDef &);
-void verbose(IndexParam &, IndexDef &, SciData *);
-bool measuresp(SciData *, IndexParam &, IndexDef &);
+void verbose(IndexParam &, vector< IndexDef > &, SciData *);
+bool measuresp(SciData *, IndexParam &, vector< IndexDef > &,
+               ResultTable *, const long);
+int  serve(const char *, vector< IndexDef > &, vector< CommandToken > &);
+bool filelist(IndexParam &, vector< IndexDef > &);
 
 //-----------------------------------------------------------------------------
 //programa principal
@@ -54,9 +59,13 @@ int main (const int argc, const char *argv[])
 
   pyindexf_global=checkpyind(argv,argc);
   
-  if(!loadidef(id)) return(pyexit(1)); //................read index definitions
+  if((argc > 1) && (strcmp(argv[1],"--compile-defs") == 0)) //index catalogue
+    return(loadidef(id,true) ? 0 : 1);
+  if(!loadidef(id,false)) return(pyexit(1)); //..........read index definitions
   if(argc == 1) {welcome(true); showindex(id); return(0);} //....show help info
   if(!loaddpar(cl)) return(pyexit(1));  //read keywords:values from inputcl.dat
+  if(strcmp(argv[1],"--serve") == 0) //..............persistent server mode
+    return(serve((argc > 2 ? argv[2] : "indexf.sock"),id,cl));
   if(!loadipar(argv,argc,cl)) return(pyexit(1));  //read user's keywords:values
   if(!checkipar(cl, param, id)) return(pyexit(1)); //.....check keywords:values
   if(param.get_checkkeys()) //......check only keywords=values and exit program
@@ -65,10 +74,16 @@ int main (const int argc, const char *argv[])
     return(0);
   }
   welcome(param.get_verbose()); //..........welcome message with version number
+  if(strcmp(param.get_filelist(),"undef") != 0) //......batch mode (manifest)
+    return(filelist(param,id) ? 0 : pyexit(1));
   SciData image(param); //..........SciData object: spectra and associated data
-  IndexDef myindex = id[param.get_nindex()-1]; //IndexDef object: spec. feature
-  updatebands(param,myindex); //......correct wavelengths to vacuum if required
+  vector< IndexDef > myindex; //..............IndexDef objects: spec. features
+  for (long i=1; i <= param.get_nindices(); i++)
+  {
+    myindex.push_back(id[param.get_nindex(i)-1]);
+    updatebands(param,myindex.back()); //correct wavelengths to vacuum if req.
+  }
   if(param.get_verbose()) verbose(param,myindex,&image); //....output verbosity
-  if(!measuresp(&image,param,myindex)) return(pyexit(1)); //....measure spectra
+  if(!measuresp(&image,param,myindex,NULL,0)) return(pyexit(1)); //measure sp.
   return(0);
 }
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+//Definicion de las funciones de la biblioteca libindexf, declaradas en
+//indexflib.h
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <iostream>
+#include "indexflib.h"
+#include "randomstream.h"
+#include "cumulativeflux.h"
+#include "pybinary.h"
+
+using namespace std;
+
+bool mideindex(const bool &, const double *, const double *, 
+               const long &,
+               const double &, const double &, const double &,
+               const bool &,
+               const IndexDef &,
+               const long &,
+               const double &,
+               const long &,
+               const long &, const double &,
+               const bool &,
+               const bool &,
+               const double &,
+               const double &, const double &,
+               const long &, const long &,
+               const double &, const double &, 
+               const double &, const double &,
+               const bool &,
+               ostream &,
+               PyBinary *,
+               RandomStream &,
+               const CumulativeFlux *,
+               MideWorkspace &,
+               ostream &, long &,
+               bool &, bool &, bool &,
+               double &, double &, double &);
+
+//-----------------------------------------------------------------------------
+//valores por defecto de los parametros de la medida
+void indexf_defaultoptions(IndexfOptions &options)
+{
+  options.contperc=-1;
+  options.simtol=0.0;
+  options.boundfit=0;
+  options.bfitdeg=3;
+  options.bfitasym=1000.0;
+  options.flattened=false;
+  options.logindex=false;
+  options.biaserr=0.0;
+  options.linearerr=0.0;
+  options.seed=0;
+}
+
+//-----------------------------------------------------------------------------
+//mide el indice myindex en el espectro; los avisos y los mensajes de error
+//se envian a log
+long indexf_measure(const IndexfSpectrum &spectrum, const IndexDef &myindex,
+                    const IndexfOptions &options, MideWorkspace &workspace,
+                    IndexfResult &result, ostream &log)
+{
+  result.findex=0;
+  result.eindex=0;
+  result.sn=0;
+  result.out_of_limits=false;
+  result.negative_error=false;
+  result.log_negative=false;
+  //---------------------------------------------------------------------------
+  //protecciones (en el programa se realizan en checkipar y en SciData)
+  if (!myindex.isvalid())
+  {
+    log << "ERROR: invalid index definition (type or bands)" << endl;
+    return(INDEXF_INVALID_INDEX);
+  }
+  if ( (spectrum.naxis1 < 1) || (spectrum.data == NULL) ||
+       (spectrum.cdelt1 <= 0) )
+  {
+    log << "ERROR: invalid spectrum (NAXIS1, data or CDELT1)" << endl;
+    return(INDEXF_INVALID_SPECTRUM);
+  }
+  if ( (spectrum.lognative) &&
+       ( (options.contperc >= 0) || (options.boundfit != 0) ||
+         (options.biaserr != 0) || (options.linearerr != 0) ) )
+  {
+    log << "ERROR: native logarithmic scale cannot be used with contperc, "
+        << "boundfit, biaserr or linearerr" << endl;
+    return(INDEXF_INVALID_OPTIONS);
+  }
+  if ( (options.bfitdeg < 0) || (options.bfitdeg > 20) ||
+       ( (options.boundfit < 0) && (options.bfitdeg < 2) ) ||
+       (options.bfitasym < 0.0) )
+  {
+    log << "ERROR: invalid boundary fit parameters: " << options.bfitdeg
+        << "," << options.bfitasym << endl;
+    return(INDEXF_INVALID_OPTIONS);
+  }
+  //---------------------------------------------------------------------------
+  //medimos (sin dibujos ni salida para pyindexf)
+  const bool lerr = (spectrum.error != NULL);
+  RandomStream rstream(options.seed,RandomStream::percentile,
+                       spectrum.number,0,0);
+  long errcode;
+  const bool lfindex = 
+    mideindex(lerr,spectrum.data,(lerr ? spectrum.error : spectrum.data),
+              spectrum.naxis1,
+              spectrum.crval1,spectrum.cdelt1,spectrum.crpix1,
+              spectrum.lognative,myindex,
+              options.contperc,options.simtol,options.boundfit,
+              options.bfitdeg,options.bfitasym,options.flattened,
+              options.logindex,
+              spectrum.rvel,
+              options.biaserr,options.linearerr,
+              0,0,
+              0.0,0.0,
+              0.0,0.0,
+              false,log,NULL,
+              rstream,NULL,workspace,
+              log,errcode,
+              result.out_of_limits,result.negative_error,result.log_negative,
+              result.findex,result.eindex,result.sn);
+  if (errcode != INDEXF_OK) return(errcode);
+  if (!lfindex) return(INDEXF_NOT_MEASURABLE);
+  return(INDEXF_OK);
+}
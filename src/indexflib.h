@@ -0,0 +1,92 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+//Interfaz de la biblioteca libindexf: medida de un indice en un espectro
+//almacenado en memoria. Las funciones no emplean variables globales ni
+//terminan el programa: los problemas se devuelven como codigos de error y
+//los mensajes se escriben en el stream indicado por el usuario. Pueden 
+//realizarse llamadas simultaneas desde distintos hilos siempre que cada 
+//hilo utilice su propio objeto MideWorkspace.
+//Las funciones se definen en indexflib.cpp
+
+#ifndef INDEXFLIB_H
+#define INDEXFLIB_H
+
+#include <iostream>
+#include <stdint.h>
+#include "indexdef.h"
+#include "mideworkspace.h"
+
+//codigos de error
+const long INDEXF_OK = 0;                //medida realizada
+const long INDEXF_NOT_MEASURABLE = 1;    //fuera de limites, error negativo
+                                         //o logaritmo de un valor negativo
+const long INDEXF_INVALID_SPECTRUM = 2;  //espectro o calibracion no validos
+const long INDEXF_INVALID_OPTIONS = 3;   //opciones incompatibles
+const long INDEXF_NOT_IMPLEMENTED = 4;   //opcion no disponible para el indice
+const long INDEXF_FIT_FAILED = 5;        //fallo en boundfit o en contperc
+const long INDEXF_INVALID_INDEX = 6;     //indice no valido (tipo o bandas)
+
+//espectro a medir (los vectores son del usuario y no se modifican)
+struct IndexfSpectrum{
+  long naxis1;           //numero de pixeles
+  double crval1;         //calibracion en longitud de onda (en log10(lambda)
+  double cdelt1;         //si lognative=true)
+  double crpix1;
+  bool lognative;        //escala logaritmica medida sin reescalar
+  const double *data;    //flujo
+  const double *error;   //error (NULL=sin errores)
+  double rvel;           //velocidad radial (km/s)
+  long number;           //numero de espectro (secuencias aleatorias)
+};
+
+//parametros de la medida (equivalentes a las palabras clave del programa)
+struct IndexfOptions{
+  long contperc;         //percentil del continuo (-1=no)
+  double simtol;         //contperc: tolerancia de las simulaciones (0=no)
+  long boundfit;         //boundary fit del continuo (0=no)
+  long bfitdeg;          //boundary fit: grado o numero de nudos
+  double bfitasym;       //boundary fit: asimetria
+  bool flattened;        //continuo igual a 1.0
+  bool logindex;         //indices en unidades logaritmicas
+  double biaserr;        //error sistematico (% del continuo)
+  double linearerr;      //error de linealidad
+  uint64_t seed;         //semilla de los numeros aleatorios (contperc)
+};
+
+//resultado de la medida
+struct IndexfResult{
+  double findex;         //valor del indice
+  double eindex;         //error del indice
+  double sn;             //senal/ruido por angstrom
+  bool out_of_limits;
+  bool negative_error;
+  bool log_negative;
+};
+
+//valores por defecto de los parametros (los mismos que en el programa)
+void indexf_defaultoptions(IndexfOptions &);
+
+//mide un indice; devuelve uno de los codigos de error anteriores
+long indexf_measure(const IndexfSpectrum &, const IndexDef &,
+                    const IndexfOptions &, MideWorkspace &,
+                    IndexfResult &, std::ostream &);
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+//Definicion de las funciones de la interfaz en C de libindexf, declaradas
+//en indexflibc.h
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <sstream>
+#include <string>
+#include <string.h>
+#include "indexflib.h"
+#include "indexflibc.h"
+
+using namespace std;
+
+//la estructura opaca de C contiene la memoria de trabajo de C++
+struct indexf_workspace
+{
+  MideWorkspace workspace;
+};
+
+//-----------------------------------------------------------------------------
+indexf_workspace *indexf_newworkspace(void)
+{
+  return(new indexf_workspace);
+}
+
+//-----------------------------------------------------------------------------
+void indexf_deleteworkspace(indexf_workspace *workspacePtr)
+{
+  delete workspacePtr;
+}
+
+//-----------------------------------------------------------------------------
+void indexf_c_defaultoptions(indexf_options *optionsPtr)
+{
+  IndexfOptions options;
+  indexf_defaultoptions(options);
+  optionsPtr->contperc=options.contperc;
+  optionsPtr->simtol=options.simtol;
+  optionsPtr->boundfit=options.boundfit;
+  optionsPtr->bfitdeg=options.bfitdeg;
+  optionsPtr->bfitasym=options.bfitasym;
+  optionsPtr->flattened=options.flattened;
+  optionsPtr->logindex=options.logindex;
+  optionsPtr->biaserr=options.biaserr;
+  optionsPtr->linearerr=options.linearerr;
+  optionsPtr->seed=options.seed;
+}
+
+//-----------------------------------------------------------------------------
+//construye el objeto IndexDef como lo hace loadidef a partir de
+//indexdef.dat; los errores se detectan en indexf_measure (isvalid)
+long indexf_c_measure(const indexf_spectrum *spectrumPtr,
+                      const indexf_index *indexPtr,
+                      const indexf_options *optionsPtr,
+                      indexf_workspace *workspacePtr,
+                      indexf_result *resultPtr, char *msg, long lmsg)
+{
+  ostringstream log;
+  long errcode = INDEXF_INVALID_OPTIONS;
+  if ( (spectrumPtr == NULL) || (indexPtr == NULL) || (optionsPtr == NULL) ||
+       (workspacePtr == NULL) || (resultPtr == NULL) ||
+       ( (indexPtr->nbands > 0) &&
+         ( (indexPtr->ldo1 == NULL) || (indexPtr->ldo2 == NULL) ) ) )
+  {
+    log << "ERROR: NULL argument in indexf_c_measure" << endl;
+  }
+  else
+  {
+    IndexDef myindex("C",indexPtr->type);
+    const long type = indexPtr->type;
+    const bool lfactor = (type == 10) || ( (type >= 101) && (type <= 9999) );
+    if (type == 10) myindex.setnbands(indexPtr->nbands);
+    //el numero de bandas de cada tipo esta fijado; si no coincide con
+    //nbands, las bandas quedan sin definir (y el indice no es valido)
+    const bool lbands = (indexPtr->nbands == myindex.getnbands()) &&
+                        ( (!lfactor) || (indexPtr->factor != NULL) );
+    long nconti = 0, nlines = 0;
+    for (long nb = 0; (lbands) && (nb < myindex.getnbands()); nb++)
+    {
+      const double l1 = indexPtr->ldo1[nb];
+      const double l2 = indexPtr->ldo2[nb];
+      if ( (lfactor) && (nb >= myindex.getnconti()) )
+      {
+        myindex.setldo(nb,l1,l2,indexPtr->factor[nb]);
+        if (indexPtr->factor[nb] == 0.0)
+          nconti++;
+        else
+          nlines++;
+      }
+      else
+      {
+        myindex.setldo(nb,l1,l2);
+      }
+    }
+    if (type == 10)
+    {
+      myindex.setnconti(nconti);
+      myindex.setnlines(nlines);
+    }
+    IndexfSpectrum spectrum;
+    spectrum.naxis1=spectrumPtr->naxis1;
+    spectrum.crval1=spectrumPtr->crval1;
+    spectrum.cdelt1=spectrumPtr->cdelt1;
+    spectrum.crpix1=spectrumPtr->crpix1;
+    spectrum.lognative=(spectrumPtr->lognative != 0);
+    spectrum.data=spectrumPtr->data;
+    spectrum.error=spectrumPtr->error;
+    spectrum.rvel=spectrumPtr->rvel;
+    spectrum.number=spectrumPtr->number;
+    IndexfOptions options;
+    options.contperc=optionsPtr->contperc;
+    options.simtol=optionsPtr->simtol;
+    options.boundfit=optionsPtr->boundfit;
+    options.bfitdeg=optionsPtr->bfitdeg;
+    options.bfitasym=optionsPtr->bfitasym;
+    options.flattened=(optionsPtr->flattened != 0);
+    options.logindex=(optionsPtr->logindex != 0);
+    options.biaserr=optionsPtr->biaserr;
+    options.linearerr=optionsPtr->linearerr;
+    options.seed=optionsPtr->seed;
+    IndexfResult result;
+    errcode=indexf_measure(spectrum,myindex,options,workspacePtr->workspace,
+                           result,log);
+    resultPtr->findex=result.findex;
+    resultPtr->eindex=result.eindex;
+    resultPtr->sn=result.sn;
+    resultPtr->out_of_limits=result.out_of_limits;
+    resultPtr->negative_error=result.negative_error;
+    resultPtr->log_negative=result.log_negative;
+  }
+  if ( (msg != NULL) && (lmsg > 0) )
+  {
+    const string s = log.str();
+    const long l = (static_cast<long>(s.length()) < lmsg-1) ? 
+                   static_cast<long>(s.length()) : lmsg-1;
+    strncpy(msg,s.c_str(),l);
+    msg[l]='\0';
+  }
+  return(errcode);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+//Interfaz en C de la biblioteca libindexf: envoltorio de indexf_measure
+//(ver indexflib.h) que puede emplearse desde programas en C. El indice se
+//describe mediante sus bandas en lugar de con un objeto IndexDef, y los
+//mensajes se devuelven en una cadena del usuario en lugar de en un stream.
+//Como en la interfaz en C++, las funciones no terminan el programa, y
+//pueden realizarse llamadas simultaneas desde distintos hilos siempre que
+//cada hilo utilice su propio indexf_workspace.
+//Las funciones se definen en indexflibc.cpp
+
+#ifndef INDEXFLIBC_H
+#define INDEXFLIBC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//los codigos de error son los de indexflib.h (INDEXF_OK=0, ...)
+
+//memoria de trabajo (MideWorkspace) de cada hilo
+typedef struct indexf_workspace indexf_workspace;
+
+//espectro a medir (ver IndexfSpectrum)
+typedef struct {
+  long naxis1;
+  double crval1;
+  double cdelt1;
+  double crpix1;
+  int lognative;
+  const double *data;
+  const double *error;   //NULL=sin errores
+  double rvel;
+  long number;
+} indexf_spectrum;
+
+//indice a medir, con el mismo tipo y bandas que en indexdef.dat: ldo1 y
+//ldo2 son los limites de las nbands bandas; factor (solo para lineas de
+//emision, tipo 10, e indices genericos) es el factor de cada banda (0 en
+//las de continuo)
+typedef struct {
+  long type;
+  long nbands;
+  const double *ldo1;
+  const double *ldo2;
+  const double *factor;
+} indexf_index;
+
+//parametros de la medida (ver IndexfOptions)
+typedef struct {
+  long contperc;
+  double simtol;
+  long boundfit;
+  long bfitdeg;
+  double bfitasym;
+  int flattened;
+  int logindex;
+  double biaserr;
+  double linearerr;
+  uint64_t seed;
+} indexf_options;
+
+//resultado de la medida (ver IndexfResult)
+typedef struct {
+  double findex;
+  double eindex;
+  double sn;
+  int out_of_limits;
+  int negative_error;
+  int log_negative;
+} indexf_result;
+
+indexf_workspace *indexf_newworkspace(void);
+void indexf_deleteworkspace(indexf_workspace *);
+void indexf_c_defaultoptions(indexf_options *);
+
+//mide un indice; los mensajes se copian (truncados, y siempre terminados
+//en '\0') en msg, de dimension lmsg (msg puede ser NULL)
+long indexf_c_measure(const indexf_spectrum *, const indexf_index *,
+                      const indexf_options *, indexf_workspace *,
+                      indexf_result *, char *, long);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
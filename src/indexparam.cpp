@@ -69,6 +69,25 @@ IndexParam::IndexParam()
   fscale = 1.0;
   checkkeys = false;
   pyindexf = false;
+  nthreads = 1;
+  bfitdeg = 3;
+  bfitasym = 1000.0;
+  cumflux = false;
+  rverrmode = 0;
+  chunksize = 64;
+  lognative = false;
+  pybinfd = -1;
+  strcpy(ofile,"undef");
+  simtol = 0.0;
+  simmode = 0;
+  rvgrid1 = 0.0;
+  rvgrid2 = 0.0;
+  rvgridstep = 0.0;
+  nrvgrid = 0;
+  strcpy(filelist,"undef");
+  floatstorage = false;
+  usemmap = false;
+  colsubset = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -104,7 +123,23 @@ IndexParam::IndexParam(
   long nseed_,                  //seed for random numbers (0=use computer time)
   double fscale_,     //flux scale factor (measured spectrum = original/fscale)
   bool checkkeys_,              //check only keywords=values and exit program
-  bool pyindexf_)              //echo data for communication with python scripts
+  bool pyindexf_,              //echo data for communication with python scripts
+  long nthreads_,              //number of threads to measure the spectra
+  long bfitdeg_,               //boundary fit: pol. degree or number of knots
+  double bfitasym_,            //boundary fit: asymmetry coefficient
+  bool cumflux_,               //use cumulative flux tables for band integrals
+  long rverrmode_,             //rad. vel. error (0: mc, 1: analytic, 2: both)
+  long chunksize_,             //number of spectra read at once from FITS files
+  bool lognative_,             //measure log-lambda spectra without rebinning
+  long pybinfd_,               //pyindexf binary records: file descriptor
+  char *of_,                   //output FITS table with the measurements
+  double simtol_,              //adaptive simulations: tolerance (0=fixed)
+  long simmode_,               //simulations: 0=random, 1=antithetic, 2=sobol
+  double rvgrid1_,double rvgrid2_,double rvgridstep_,//radial velocity grid
+  char *filelist_,             //manifest of input files (batch mode)
+  bool floatstorage_,          //store spectra read at once in float32
+  bool usemmap_,               //read uncompressed FITS images through mmap
+  bool colsubset_)             //read only the pixel columns the indices need
 {
   set_if(ifile_);
   set_ns1(ns1_);
@@ -140,6 +175,22 @@ IndexParam::IndexParam(
   set_fscale(fscale_);
   set_checkkeys(checkkeys_);
   set_pyindexf(pyindexf_);
+  set_nthreads(nthreads_);
+  set_bfitdeg(bfitdeg_);
+  set_bfitasym(bfitasym_);
+  set_cumflux(cumflux_);
+  set_rverrmode(rverrmode_);
+  set_chunksize(chunksize_);
+  set_lognative(lognative_);
+  set_pybinfd(pybinfd_);
+  set_of(of_);
+  set_simtol(simtol_);
+  set_simmode(simmode_);
+  set_rvgrid(rvgrid1_,rvgrid2_,rvgridstep_);
+  set_filelist(filelist_);
+  set_floatstorage(floatstorage_);
+  set_usemmap(usemmap_);
+  set_colsubset(colsubset_);
 }
 
 //-----------------------------------------------------------------------------
@@ -233,6 +284,23 @@ void IndexParam::set_nsimul(const long nsimul_)
 void IndexParam::set_nindex(const long nindex_)
 {
   nindex = nindex_;
+  nindexlist.clear();
+  nindexlist.push_back(nindex_);
+}
+
+//-----------------------------------------------------------------------------
+//anade un indice mas a la lista de indices a medir (el primero de la lista
+//se establece con set_nindex)
+void IndexParam::add_nindex(const long nindex_)
+{
+  if (nindexlist.empty())
+  {
+    set_nindex(nindex_);
+  }
+  else
+  {
+    nindexlist.push_back(nindex_);
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -365,6 +433,114 @@ void IndexParam::set_pyindexf(const bool pyindexf_)
   pyindexf=pyindexf_;
 }
 
+//-----------------------------------------------------------------------------
+void IndexParam::set_nthreads(const long nthreads_)
+{
+  nthreads=nthreads_;
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_bfitdeg(const long bfitdeg_)
+{
+  bfitdeg=bfitdeg_;
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_bfitasym(const double bfitasym_)
+{
+  bfitasym=bfitasym_;
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_cumflux(const bool cumflux_)
+{
+  cumflux=cumflux_;
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_rverrmode(const long rverrmode_)
+{
+  rverrmode=rverrmode_;
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_chunksize(const long chunksize_)
+{
+  chunksize=chunksize_;
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_lognative(const bool lognative_)
+{
+  lognative=lognative_;
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_pybinfd(const long pybinfd_)
+{
+  pybinfd=pybinfd_;
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_of(const char *of_)
+{
+  strncpy(ofile,of_,strlen(of_));
+  ofile[strlen(of_)]='\0';
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_simtol(const double simtol_)
+{
+  simtol=simtol_;
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_simmode(const long simmode_)
+{
+  simmode=simmode_;
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_filelist(const char *filelist_)
+{
+  strncpy(filelist,filelist_,strlen(filelist_));
+  filelist[strlen(filelist_)]='\0';
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_floatstorage(const bool floatstorage_)
+{
+  floatstorage=floatstorage_;
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_usemmap(const bool usemmap_)
+{
+  usemmap=usemmap_;
+}
+
+//-----------------------------------------------------------------------------
+void IndexParam::set_colsubset(const bool colsubset_)
+{
+  colsubset=colsubset_;
+}
+
+//-----------------------------------------------------------------------------
+//malla de velocidades radiales rvgrid1, rvgrid1+rvgridstep, ..., hasta
+//rvgrid2 (incluida si coincide con un punto de la malla); rvgridstep=0
+//indica que no se emplea la malla
+void IndexParam::set_rvgrid(const double rvgrid1_, const double rvgrid2_,
+                            const double rvgridstep_)
+{
+  rvgrid1 = rvgrid1_;
+  rvgrid2 = rvgrid2_;
+  rvgridstep = rvgridstep_;
+  if (rvgridstep > 0)
+    nrvgrid = static_cast<long>((rvgrid2-rvgrid1)/rvgridstep+1.0E-6)+1;
+  else
+    nrvgrid = 0;
+}
+
 //-----------------------------------------------------------------------------
 char *IndexParam::get_if() {return(ifile);}
 
@@ -416,6 +592,12 @@ long IndexParam::get_nsimul() {return(nsimul);}
 //-----------------------------------------------------------------------------
 long IndexParam::get_nindex() {return(nindex);}
 
+//-----------------------------------------------------------------------------
+long IndexParam::get_nindex(const long i) {return(nindexlist[i-1]);}
+
+//-----------------------------------------------------------------------------
+long IndexParam::get_nindices() {return(nindexlist.size());}
+
 //-----------------------------------------------------------------------------
 bool IndexParam::get_logindex() {return(logindex);}
 
@@ -484,3 +666,60 @@ bool IndexParam::get_checkkeys() {return(checkkeys);}
 
 //-----------------------------------------------------------------------------
 bool IndexParam::get_pyindexf() {return(pyindexf);}
+
+//-----------------------------------------------------------------------------
+long IndexParam::get_nthreads() {return(nthreads);}
+
+//-----------------------------------------------------------------------------
+long IndexParam::get_bfitdeg() {return(bfitdeg);}
+
+//-----------------------------------------------------------------------------
+double IndexParam::get_bfitasym() {return(bfitasym);}
+
+//-----------------------------------------------------------------------------
+bool IndexParam::get_cumflux() {return(cumflux);}
+
+//-----------------------------------------------------------------------------
+long IndexParam::get_rverrmode() {return(rverrmode);}
+
+//-----------------------------------------------------------------------------
+long IndexParam::get_chunksize() {return(chunksize);}
+
+//-----------------------------------------------------------------------------
+bool IndexParam::get_lognative() {return(lognative);}
+
+//-----------------------------------------------------------------------------
+long IndexParam::get_pybinfd() {return(pybinfd);}
+
+//-----------------------------------------------------------------------------
+char *IndexParam::get_of() {return(ofile);}
+
+//-----------------------------------------------------------------------------
+double IndexParam::get_simtol() {return(simtol);}
+
+//-----------------------------------------------------------------------------
+long IndexParam::get_simmode() {return(simmode);}
+
+//-----------------------------------------------------------------------------
+double IndexParam::get_rvgrid1() {return(rvgrid1);}
+
+//-----------------------------------------------------------------------------
+double IndexParam::get_rvgrid2() {return(rvgrid2);}
+
+//-----------------------------------------------------------------------------
+double IndexParam::get_rvgridstep() {return(rvgridstep);}
+
+//-----------------------------------------------------------------------------
+long IndexParam::get_nrvgrid() {return(nrvgrid);}
+
+//-----------------------------------------------------------------------------
+char *IndexParam::get_filelist() {return(filelist);}
+
+//-----------------------------------------------------------------------------
+bool IndexParam::get_floatstorage() {return(floatstorage);}
+
+//-----------------------------------------------------------------------------
+bool IndexParam::get_usemmap() {return(usemmap);}
+
+//-----------------------------------------------------------------------------
+bool IndexParam::get_colsubset() {return(colsubset);}
@@ -24,12 +24,16 @@
 #ifndef INDEXPARAM_H
 #define INDEXPARAM_H
 
+#include <vector>
+
+using std::vector;
+
 class IndexParam{
   public:
     IndexParam(); //constructor por defecto
     IndexParam(   //constructor con parmetros
       char *,long,long, //input file, first and last spectrum (0,0=all)
-      char *,           //index name
+      char *,           //index name (or list of index names)
       char *,           //input error file
       long,             //percentile for continuum (-1=use mean fluxes)
       long,             //boundary fit for continuum (0=use mean fluxes)
@@ -58,7 +62,23 @@ class IndexParam{
       long,             //seed for random numbers (0=use computer time)
       double,           //flux scale factor (measured spectrum=original/fscale)
       bool,             //check only keywords=values and exit program
-      bool);            //echo data for communication with python scripts
+      bool,             //echo data for communication with python scripts
+      long,             //number of threads to measure the spectra
+      long,             //boundary fit: polynomial degree or number of knots
+      double,           //boundary fit: asymmetry coefficient
+      bool,             //use cumulative flux tables for band integrals
+      long,             //radial velocity error (0: mc, 1: analytic, 2: both)
+      long,             //number of spectra read at once from FITS files
+      bool,             //measure log-lambda spectra without rebinning
+      long,             //pyindexf binary records: file descriptor
+      char *,           //output FITS table with the measurements
+      double,           //adaptive simulations: tolerance (0=fixed)
+      long,             //simulations: 0=random, 1=antithetic, 2=sobol
+      double,double,double, //radial velocity grid: vmin,vmax,dv (dv=0: no)
+      char *,           //manifest of input files (batch mode)
+      bool,             //store spectra read at once in float32
+      bool,             //read uncompressed FITS images through mmap
+      bool);            //read only the pixel columns the indices need
     void set_if(const char *);
     void set_ns1(const long);
     void set_ns2(const long);
@@ -73,6 +93,7 @@ class IndexParam{
     void set_vacuum(const long);
     void set_nsimul(const long);
     void set_nindex(const long);
+    void add_nindex(const long);
     void set_of(const char *);
     void set_logindex(const bool);
     void set_verbose(const bool);
@@ -95,6 +116,21 @@ class IndexParam{
     void set_fscale(const double);
     void set_checkkeys(const bool);
     void set_pyindexf(const bool);
+    void set_nthreads(const long);
+    void set_bfitdeg(const long);
+    void set_bfitasym(const double);
+    void set_cumflux(const bool);
+    void set_rverrmode(const long);
+    void set_chunksize(const long);
+    void set_lognative(const bool);
+    void set_pybinfd(const long);
+    void set_simtol(const double);
+    void set_simmode(const long);
+    void set_rvgrid(const double, const double, const double);
+    void set_filelist(const char *);
+    void set_floatstorage(const bool);
+    void set_usemmap(const bool);
+    void set_colsubset(const bool);
     char *get_if();
     long get_ns1();
     long get_ns2();
@@ -112,6 +148,8 @@ class IndexParam{
     long get_vacuum();
     long get_nsimul();
     long get_nindex();
+    long get_nindex(const long);
+    long get_nindices();
     bool get_logindex();
     bool get_verbose();
     long get_nsimulsn();
@@ -135,9 +173,28 @@ class IndexParam{
     double get_fscale();
     bool get_checkkeys();
     bool get_pyindexf();
+    long get_nthreads();
+    long get_bfitdeg();
+    double get_bfitasym();
+    bool get_cumflux();
+    long get_rverrmode();
+    long get_chunksize();
+    bool get_lognative();
+    long get_pybinfd();
+    double get_simtol();
+    long get_simmode();
+    double get_rvgrid1();
+    double get_rvgrid2();
+    double get_rvgridstep();
+    long get_nrvgrid();
+    bool get_floatstorage();
+    bool get_usemmap();
+    bool get_colsubset();
+    char *get_filelist();
+    char *get_of();
   private:
     char ifile[256];
-    char index[9];;
+    char index[256];
     long ns1,ns2;
     char iefile[256];
     long contperc;
@@ -150,6 +207,7 @@ class IndexParam{
     long vacuum;
     long nsimul;
     long nindex;
+    vector< long > nindexlist;
     bool logindex;
     bool verbose;
     long nsimulsn;
@@ -170,6 +228,23 @@ class IndexParam{
     double fscale;
     bool checkkeys;
     bool pyindexf;
+    long nthreads;
+    long bfitdeg;
+    double bfitasym;
+    bool cumflux;
+    long rverrmode;
+    long chunksize;
+    bool lognative;
+    long pybinfd;
+    char ofile[256];
+    double simtol;
+    long simmode;
+    double rvgrid1,rvgrid2,rvgridstep;
+    long nrvgrid;
+    char filelist[256];
+    bool floatstorage;
+    bool usemmap;
+    bool colsubset;
 };
 
 #endif
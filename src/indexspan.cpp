@@ -0,0 +1,71 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#include <cmath>
+#include "indexdef.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//calcula el intervalo de pixeles [jmin,jmax] (numerados en [1,NAXIS1]) que
+//emplea mideindex para medir el indice con la velocidad radial rvel, con
+//los mismos limites de las bandas que mideindex (j1...j2+1 en cada banda);
+//retorna false si el indice cae fuera de los limites del espectro
+bool indexspan(const IndexDef &myindex, const long naxis1,
+               const double crval1, const double cdelt1, const double crpix1,
+               const bool lognative, const double rvel,
+               long &jmin, long &jmax)
+{
+  jmin=1;
+  jmax=naxis1;
+  if (rvel > 2.9979240E+5) return(false);
+  const double c = 2.9979246E+5; //velocidad de la luz (km/s)
+  const double rcvel = rvel/c;
+  const double rcvel1 = (1.0+rcvel)/sqrt(1.0-rcvel*rcvel);
+  const double wlmin = crval1-cdelt1/2.0-(crpix1-1.0)*cdelt1;
+  const long nbands = myindex.getnbands();
+  for (long nb=0; nb < nbands; nb++)
+  {
+    const double ca = myindex.getldo1(nb)*rcvel1;
+    const double cb = myindex.getldo2(nb)*rcvel1;
+    double c3, c4;
+    if (lognative)
+    {
+      c3 = (log10(ca)-wlmin)/cdelt1+1.0;
+      c4 = (log10(cb)-wlmin)/cdelt1;
+    }
+    else
+    {
+      c3 = (ca-wlmin)/cdelt1+1.0;
+      c4 = (cb-wlmin)/cdelt1;
+    }
+    if ( (c3 < 1.0) || (c4 > static_cast<double>(naxis1-1)) )
+    {
+      jmin=1;
+      jmax=naxis1;
+      return(false);
+    }
+    const long j1 = static_cast<long>(c3);
+    const long j2 = static_cast<long>(c4);
+    if ( (nb == 0) || (j1 < jmin) ) jmin=j1;
+    if ( (nb == 0) || (j2+1 > jmax) ) jmax=j2+1;
+  }
+  return(true);
+}
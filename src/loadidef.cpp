@@ -27,8 +27,15 @@
 
 using namespace std;
 
+bool readidefcat(const char *, const char *, vector< IndexDef > &);
+bool writeidefcat(const char *, const char *, vector< IndexDef > &);
+
 //lee las definiciones de los indices del fichero myindexdef.dat o indexdef.dat
-bool loadidef(vector< IndexDef > &id)
+//(o de su catalogo binario, myindexdef.bin o indexdef.bin, si se ha generado
+//con indexf --compile-defs a partir de la version actual del fichero); si
+//lcompile es true se leen siempre del fichero de texto y se genera el 
+//catalogo
+bool loadidef(vector< IndexDef > &id, const bool lcompile)
 {
   //el directorio de instalacion esta definido como variable global
   extern const char *installdirPtr;
@@ -61,6 +68,14 @@ bool loadidef(vector< IndexDef > &id)
     strcpy(infilenamePtr,installdirPtr); //copiamos directorio
     strcat(infilenamePtr,"/indexdef.dat"); //concatenamos nombre de fichero
   }
+  //el catalogo binario tiene el mismo nombre, con extension .bin
+  string catfilename = infilenamePtr;
+  catfilename.replace(catfilename.length()-4,4,".bin");
+  if ( (!lcompile) && (readidefcat(catfilename.c_str(),infilenamePtr,id)) )
+  {
+    delete [] infilenamePtr;
+    return(true);
+  }
   //abrimos el archivo mediante el constructor de ifstream
   ifstream inpfile(infilenamePtr,ios::in);
   if(!inpfile)
@@ -88,6 +103,17 @@ bool loadidef(vector< IndexDef > &id)
     type = static_cast<long>(strtol(valuePtr,&remainderPtr,0));
     //construimos un objeto de tipo IndexDef
     IndexDef idread(labelPtr,type);
+    //las funciones de IndexDef no muestran mensajes de error: un tipo no
+    //valido da lugar a un indice sin bandas, y los errores al definir las
+    //bandas se comprueban (isvalid) antes de incluir el indice
+    if ( (idread.getnbands() == 0) && (type != 10) )
+    {
+      cout << "FATAL ERROR: index type=" << type << " is not valid" << endl;
+      cout << "--> Check file indexdef.dat, index: " << labelPtr << endl;
+      delete [] linePtr;
+      delete [] infilenamePtr;
+      return(false);
+    }
     nbands = idread.getnbands();
     nconti = idread.getnconti();
     nlines = idread.getnlines();
@@ -259,9 +285,26 @@ bool loadidef(vector< IndexDef > &id)
       }
     }
     //-------------------------------------------------------------------------
+    if (!idread.isvalid())
+    {
+      cout << "FATAL ERROR: invalid band definitions" << endl;
+      cout << "--> index= " << labelPtr << endl;
+      cout << "--> check file " << infilenamePtr << endl;
+      delete [] linePtr;
+      delete [] infilenamePtr;
+      return(false);
+    }
     id.push_back(idread);
     delete [] linePtr;
   } //while (getline(inpfile,s))
+  if (lcompile)
+  {
+    if (!writeidefcat(catfilename.c_str(),infilenamePtr,id))
+    {
+      delete [] infilenamePtr;
+      return(false);
+    }
+  }
   delete [] infilenamePtr;
 
   return(true);
@@ -27,11 +27,22 @@
 #include <sstream>
 #include <cstdlib>
 #include <cmath>
+#include <limits>
 #include <iomanip>
 #include <time.h>
+#include <vector>
+#include <string>
+#include <pthread.h>
 #include "indexparam.h"
 #include "indexdef.h"
 #include "scidata.h"
+#include "randomstream.h"
+#include "cumulativeflux.h"
+#include "mideworkspace.h"
+#include "indexflib.h"
+#include "pybinary.h"
+#include "resulttable.h"
+#include "runningstats.h"
 
 #ifdef HAVE_CPGPLOT_H
 #include "cpgplot.h"
@@ -43,9 +54,12 @@ using namespace std;
 bool mideindex(const bool &, const double *, const double *, 
                const long &,
                const double &, const double &, const double &,
+               const bool &,
                const IndexDef &,
                const long &,
+               const double &,
                const long &,
+               const long &, const double &,
                const bool &,
                const bool &,
                const double &,
@@ -54,12 +68,20 @@ bool mideindex(const bool &, const double *, const double *,
                const double &, const double &, 
                const double &, const double &,
                const bool &,
+               ostream &,
+               PyBinary *,
+               RandomStream &,
+               const CumulativeFlux *,
+               MideWorkspace &,
+               ostream &, long &,
                bool &, bool &, bool &,
                double &, double &, double &);
 
 bool fmean(const long, const double *, const bool *, double *, double *);
 
-void outmeasurement(const long &,
+void outmeasurement(ostream &,
+                    const long &,
+                    const char *,
                     const double &, const double &, 
                     const double &,
                     const double &, const double &,
@@ -67,43 +89,85 @@ void outmeasurement(const long &,
                     const char *,
                     const bool &,
                     const bool &, const bool &,
-                    const bool &, const bool &, const bool &);
+                    const bool &, const bool &, const bool &,
+                    const bool &, const double &, const double &,
+                    const bool &, const long &);
+
+void rowmeasurement(vector< ResultRow > &,
+                    const long &,
+                    const char *,
+                    const double &, const double &, 
+                    const double &,
+                    const double &, const double &,
+                    const double &, const double &,
+                    const char *,
+                    const bool &,
+                    const bool &, const bool &,
+                    const bool &, const bool &, const bool &,
+                    const bool &, const double &, const double &,
+                    const bool &, const long &);
+
+bool checkerrcode(const long, const ostringstream &, ostream &);
 
-bool measuresp(SciData *imagePtr, IndexParam &param, IndexDef &myindex)
+bool indexspan(const IndexDef &, const long,
+               const double, const double, const double,
+               const bool, const double, long &, long &);
+
+bool measure1sp(SciData *, IndexParam &, vector< IndexDef > &, const long,
+                const uint64_t, double *, double *, double *, double *,
+                MideWorkspace &, PyBinary *, vector< ResultRow > *,
+                ostream &);
+
+//-----------------------------------------------------------------------------
+//datos compartidos por los hilos de ejecucion que miden los espectros
+struct MeasureThreadData
+{
+  SciData *imagePtr;
+  IndexParam *paramPtr;
+  vector< IndexDef > *myindexPtr;
+  long ns1, ns2;          //primer y ultimo espectro a medir
+  uint64_t seed;          //semilla de los numeros aleatorios
+  long ns_next;           //siguiente espectro pendiente de medir
+  long ns_print;          //siguiente espectro pendiente de mostrar
+  long nwindow;           //maximo adelanto de los hilos sobre la salida
+  string *output;         //salida de cada espectro (en orden)
+  string *pyoutput;       //registros binarios de cada espectro (o NULL)
+  vector< ResultRow > *rows; //filas de la tabla de cada espectro (o NULL)
+  bool *done;             //indica si la salida de cada espectro esta lista
+  long ns_error;          //primer espectro con error en mideindex (o ns2+1)
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+};
+
+void *measurethread(void *);
+
+//-----------------------------------------------------------------------------
+//si sharedtable no es NULL, las medidas se anaden a esa tabla (abierta por
+//quien llama) en lugar de crear la tabla indicada por el keyword of; nfile
+//es la posicion del fichero en el manifiesto (keyword filelist; 0 en otro
+//caso), que se combina con la semilla para que cada fichero emplee
+//secuencias aleatorias diferentes
+bool measuresp(SciData *imagePtr, IndexParam &param, 
+               vector< IndexDef > &myindex, ResultTable *sharedtable,
+               const long nfile)
 {
+  //semilla de los numeros aleatorios; cada espectro (y cada simulacion) 
+  //genera su propia secuencia a partir de ella (ver randomstream.h)
   const long nseed = param.get_nseed();
+  uint64_t seed;
   if(nseed == 0)
   {
-    srand(time(0)); //aleatorizamos la semilla de los numeros aleatorios
+    seed = static_cast<uint64_t>(time(0)); //aleatorizamos la semilla
   }
   else
   {
-    srand(nseed); //usamos semilla proporcionada por el usuario
+    seed = static_cast<uint64_t>(nseed); //usamos semilla del usuario
   }
-  const double pi2 = 4.*acos(0.0);
-  const double sqrt2 = sqrt(2.0);
-  const bool lerr = ( strcmp(imagePtr->getfilename_error(),"undef") != 0 );
-  const double *const my2Ddata = imagePtr->getdata();
-  const double *my2Derror = NULL;
-  //my2Derror no puede declararse como "const double *const" porque de lo
-  //contrario no puede modificarse en la siguiente linea
-  if ( lerr ) my2Derror = imagePtr->geterror();
-  //OJO: la inicializacion a cero no funciona con el compilador de Solaris;
-  //     por eso estan comentados los finales de las siguientes 2 lineas:
-  double *sp_data = new double [imagePtr->getnaxis1()];// = { 0 };
-  double *sp_error = new double [imagePtr->getnaxis1()];// = { 0 };
-  const double crval1 = imagePtr->getcrval1();
-  const double cdelt1 = imagePtr->getcdelt1();
-  const double crpix1 = imagePtr->getcrpix1();
-  //definimos parametros adicionales
-  const long contperc = param.get_contperc();
-  const long boundfit = param.get_boundfit();
-  const bool flattened = param.get_flattened();
-  const long plotmode = param.get_plotmode();
-  const long plottype = param.get_plottype();
-  //recorremos, extraemos y medimos los espectros requeridos
-  double findex, eindex, sn, findex_rv, eindex_rv, findex_sn, eindex_sn;
+  //el primer fichero (nfile=0) emplea la misma semilla que una ejecucion
+  //sobre ese fichero aislado
+  seed ^= static_cast<uint64_t>(nfile)*0x9E3779B97F4A7C15ULL;
 #ifdef HAVE_CPGPLOT_H
+  const long plotmode = param.get_plotmode();
   if (plotmode != 0)
   {
     const long nwinx=param.get_nwinx();
@@ -129,57 +193,372 @@ bool measuresp(SciData *imagePtr, IndexParam &param, IndexDef &myindex)
   }
 #endif /* HAVE_CPGPLOT_H */
   const bool  pyindexf = param.get_pyindexf();
-  if (pyindexf) //generamos diccionario con parametros del indice a medir
+  //descriptor para los registros binarios de pyindexf (-1: modo texto)
+  const int pybinfd = static_cast<int>(param.get_pybinfd());
+  if ( (pyindexf) && (pybinfd >= 0) ) //registro con el indice a medir
   {
-    cout << "python> {'indextype': " << myindex.gettype() << ", "
-         << "'indexname': '" << myindex.getlabel() << "', "
-         << "'nbands': " << myindex.getnbands() << ", "
-         << "'nconti': " << myindex.getnconti() << ", "
-         << "'nlines': " << myindex.getnlines() << "}" << endl;
+    PyBinary pyheader;
+    pyheader.add(PyBinary::index,0,myindex[0].getnconti(),
+                 myindex[0].gettype(),myindex[0].getnbands());
+    if (!pyheader.flush(pybinfd))
+    {
+      cout << "FATAL ERROR: while writing in file descriptor " << pybinfd
+           << endl;
+      return(false);
+    }
   }
-  //bucle para la medida de los diferentes espectros
-  for (long ns = param.get_ns1(); ns <= param.get_ns2(); ns++)
+  else if (pyindexf) //generamos diccionario con parametros del indice a medir
   {
-    bool out_of_limits,negative_error,log_negative;
-    long i1=(ns-1)*imagePtr->getnaxis1()+1;
-    long i2=i1+imagePtr->getnaxis1()-1;
-    for ( long i = i1; i <= i2; i++ )
-      sp_data[i-i1] = my2Ddata[i-1];
-    if ( lerr )
+    cout << "python> {'indextype': " << myindex[0].gettype() << ", "
+         << "'indexname': '" << myindex[0].getlabel() << "', "
+         << "'nbands': " << myindex[0].getnbands() << ", "
+         << "'nconti': " << myindex[0].getnconti() << ", "
+         << "'nlines': " << myindex[0].getnlines() << "}" << endl;
+  }
+  //numero de hilos de ejecucion
+  long nthreads = param.get_nthreads();
+  const long ns1 = param.get_ns1();
+  const long ns2 = param.get_ns2();
+  //columnas de las imagenes que se leen (antes de lanzar los hilos, y
+  //tambien sin colsubset, porque el objeto puede reutilizarse en --serve)
+  long colj1 = 1, colj2 = imagePtr->getnaxis1();
+  if (param.get_colsubset())
+    imagePtr->columnwindow(param,myindex,colj1,colj2);
+  imagePtr->setcolumns(colj1,colj2);
+  //si se ha solicitado, las medidas se guardan en una tabla FITS en lugar
+  //de mostrarse en la salida estandar
+  ResultTable *table = sharedtable;
+  if ( (table == NULL) && (strcmp(param.get_of(),"undef") != 0) )
+  {
+    long lindexname = 0;
+    for (unsigned long k = 0; k < myindex.size(); k++)
     {
-      for ( long i = i1; i <= i2; i++ )
-        sp_error[i-i1] = my2Derror[i-1];
+      const long l = strlen(myindex[k].getlabel());
+      if (l > lindexname) lindexname = l;
     }
-    else
+    long llabel = 0;
+    for (long ns = ns1; ns <= ns2; ns++)
+    {
+      const long l = strlen(imagePtr->getlabelsp()[ns-1]);
+      if (l > llabel) llabel = l;
+    }
+    table = new ResultTable(param.get_of(),lindexname,llabel);
+  }
+  if (nthreads > ns2-ns1+1) nthreads = ns2-ns1+1;
+  //bucle para la medida de los diferentes espectros (cada espectro se
+  //extrae una unica vez y se miden sobre el todos los indices solicitados)
+  bool lok = true;
+  if (nthreads == 1)
+  {
+    //OJO: la inicializacion a cero no funciona con el compilador de Solaris;
+    //     por eso estan comentados los finales de las siguientes 2 lineas:
+    double *sp_data = new double [imagePtr->getnaxis1()];// = { 0 };
+    double *sp_error = new double [imagePtr->getnaxis1()];// = { 0 };
+    //las simulaciones con S/N variable necesitan su propia copia del error
+    //para no alterar sp_error antes de medir el siguiente indice, y un
+    //vector para el espectro simulado
+    double *sp_error_sn = new double [imagePtr->getnaxis1()];
+    double *sp_data_eff = new double [imagePtr->getnaxis1()];
+    //con colsubset, getspectrum no rellena los pixeles fuera de la ventana
+    for (long j = 1; j <= imagePtr->getnaxis1(); j++)
+      sp_data[j-1] = sp_error[j-1] = 0.0;
+    MideWorkspace workspace;
+    PyBinary pybinary;
+    PyBinary *pybinaryPtr = ( (pyindexf) && (pybinfd >= 0) ) ? &pybinary : NULL;
+    vector< ResultRow > rows;
+    vector< ResultRow > *rowsPtr = (table != NULL) ? &rows : NULL;
+    for (long ns = ns1; ns <= ns2; ns++)
+    {
+      lok = measure1sp(imagePtr,param,myindex,ns,seed,
+                       sp_data,sp_error,sp_error_sn,sp_data_eff,workspace,
+                       pybinaryPtr,rowsPtr,cout);
+      if (table != NULL) table->addrows(rows);
+      if ( (pybinaryPtr != NULL) && (!pybinary.flush(pybinfd)) )
+      {
+        cout << "FATAL ERROR: while writing in file descriptor " << pybinfd
+             << endl;
+        lok = false;
+      }
+      if (!lok) break;
+    }
+    delete [] sp_data;
+    delete [] sp_error;
+    delete [] sp_error_sn;
+    delete [] sp_data_eff;
+  }
+  else
+  {
+    //cada hilo mide los espectros pendientes con sus propios vectores de
+    //trabajo y deja la salida en un buffer; el hilo principal muestra los
+    //buffers en el orden de los espectros, de forma que la salida coincide
+    //exactamente con la de una ejecucion secuencial
+    MeasureThreadData tdata;
+    tdata.imagePtr = imagePtr;
+    tdata.paramPtr = &param;
+    tdata.myindexPtr = &myindex;
+    tdata.ns1 = ns1;
+    tdata.ns2 = ns2;
+    tdata.seed = seed;
+    tdata.ns_next = ns1;
+    tdata.ns_print = ns1;
+    tdata.ns_error = ns2+1;
+    tdata.nwindow = 16*nthreads;
+    tdata.output = new string [ns2-ns1+1];
+    tdata.pyoutput = NULL;
+    if ( (pyindexf) && (pybinfd >= 0) )
+      tdata.pyoutput = new string [ns2-ns1+1];
+    tdata.rows = NULL;
+    if (table != NULL)
+      tdata.rows = new vector< ResultRow > [ns2-ns1+1];
+    tdata.done = new bool [ns2-ns1+1];
+    for (long ns = ns1; ns <= ns2; ns++)
+      tdata.done[ns-ns1] = false;
+    pthread_mutex_init(&tdata.mutex,NULL);
+    pthread_cond_init(&tdata.cond,NULL);
+    //si no pueden crearse todos los hilos, se mide con los ya creados
+    pthread_t *threads = new pthread_t [nthreads];
+    long ncreated = 0;
+    for (long i = 1; i <= nthreads; i++)
+    {
+      if (pthread_create(&threads[i-1],NULL,measurethread,&tdata) != 0) break;
+      ncreated++;
+    }
+    if (ncreated == 0)
     {
+      cout << "FATAL ERROR: while creating thread #1" << endl;
+      lok = false;
     }
-    const double rvel = imagePtr->getrvel()[ns-1];
-    const double rvelerr = imagePtr->getrvelerr()[ns-1];
-    const bool logindex = param.get_logindex();
-    const double biaserr = param.get_biaserr();
-    const double linearerr = param.get_linearerr();
-    const double xmin = param.get_xmin();
-    const double xmax = param.get_xmax();
-    const double ymin = param.get_ymin();
-    const double ymax = param.get_ymax();
+    pthread_mutex_lock(&tdata.mutex);
+    while ( (lok) && (tdata.ns_print <= ns2) )
+    {
+      while (!tdata.done[tdata.ns_print-ns1])
+        pthread_cond_wait(&tdata.cond,&tdata.mutex);
+      //liberamos el mutex mientras se escribe la salida
+      string soutput, spyoutput;
+      vector< ResultRow > rows;
+      soutput.swap(tdata.output[tdata.ns_print-ns1]);
+      if (tdata.pyoutput != NULL)
+        spyoutput.swap(tdata.pyoutput[tdata.ns_print-ns1]);
+      if (tdata.rows != NULL)
+        rows.swap(tdata.rows[tdata.ns_print-ns1]);
+      pthread_mutex_unlock(&tdata.mutex);
+      cout << soutput << flush;
+      if (table != NULL) table->addrows(rows);
+      if ( (tdata.pyoutput != NULL) && (!PyBinary::write(pybinfd,spyoutput)) )
+      {
+        cout << "FATAL ERROR: while writing in file descriptor " << pybinfd
+             << endl;
+        lok = false;
+      }
+      pthread_mutex_lock(&tdata.mutex);
+      //la salida del espectro con error ya incluye el mensaje
+      if (tdata.ns_print == tdata.ns_error) lok = false;
+      tdata.ns_print++;
+      //tras un error no se reparten mas espectros
+      if (!lok) tdata.ns_next = ns2+1;
+      pthread_cond_broadcast(&tdata.cond);
+      if (!lok) break;
+    }
+    pthread_mutex_unlock(&tdata.mutex);
+    for (long i = 1; i <= ncreated; i++)
+      pthread_join(threads[i-1],NULL);
+    pthread_mutex_destroy(&tdata.mutex);
+    pthread_cond_destroy(&tdata.cond);
+    delete [] threads;
+    delete [] tdata.output;
+    delete [] tdata.pyoutput;
+    delete [] tdata.rows;
+    delete [] tdata.done;
+  }
+#ifdef HAVE_CPGPLOT_H
+  if (plotmode != 0)
+  {
+    cpgend();
+  }
+#endif
+  //escribe las filas pendientes y cierra el fichero
+  if (table != sharedtable) delete table;
+  return(lok);
+}
+
+//-----------------------------------------------------------------------------
+//funcion ejecutada por cada hilo: mide espectros hasta que no quedan mas
+void *measurethread(void *arg)
+{
+  MeasureThreadData *tdata = static_cast<MeasureThreadData *>(arg);
+  SciData *imagePtr = tdata->imagePtr;
+  //vectores de trabajo propios de cada hilo
+  double *sp_data = new double [imagePtr->getnaxis1()];
+  double *sp_error = new double [imagePtr->getnaxis1()];
+  double *sp_error_sn = new double [imagePtr->getnaxis1()];
+  double *sp_data_eff = new double [imagePtr->getnaxis1()];
+  for (long j = 1; j <= imagePtr->getnaxis1(); j++)
+    sp_data[j-1] = sp_error[j-1] = 0.0;
+  MideWorkspace workspace;
+  PyBinary pybinary;
+  PyBinary *pybinaryPtr = (tdata->pyoutput != NULL) ? &pybinary : NULL;
+  vector< ResultRow > rows;
+  vector< ResultRow > *rowsPtr = (tdata->rows != NULL) ? &rows : NULL;
+  for (;;)
+  {
+    pthread_mutex_lock(&tdata->mutex);
+    //evitamos que los hilos se adelanten demasiado a la salida
+    while ( (tdata->ns_next <= tdata->ns2) &&
+            (tdata->ns_next-tdata->ns_print >= tdata->nwindow) )
+      pthread_cond_wait(&tdata->cond,&tdata->mutex);
+    const long ns = tdata->ns_next;
+    if (ns <= tdata->ns2) tdata->ns_next++;
+    pthread_mutex_unlock(&tdata->mutex);
+    if (ns > tdata->ns2) break;
+    ostringstream sout;
+    const bool lok = measure1sp(imagePtr,*(tdata->paramPtr),
+                                *(tdata->myindexPtr),ns,tdata->seed,
+                                sp_data,sp_error,sp_error_sn,sp_data_eff,
+                                workspace,pybinaryPtr,rowsPtr,sout);
+    pthread_mutex_lock(&tdata->mutex);
+    //si hay error no se reparten mas espectros; los que ya se estan
+    //midiendo terminan, pero solo se muestran los anteriores a este
+    if ( (!lok) && (ns < tdata->ns_error) )
+    {
+      tdata->ns_error = ns;
+      tdata->ns_next = tdata->ns2+1;
+    }
+    tdata->output[ns-tdata->ns1] = sout.str();
+    if (pybinaryPtr != NULL)
+      tdata->pyoutput[ns-tdata->ns1].swap(pybinary.getbuffer());
+    if (rowsPtr != NULL)
+      tdata->rows[ns-tdata->ns1].swap(rows);
+    tdata->done[ns-tdata->ns1] = true;
+    pthread_cond_broadcast(&tdata->cond);
+    pthread_mutex_unlock(&tdata->mutex);
+  }
+  delete [] sp_data;
+  delete [] sp_error;
+  delete [] sp_error_sn;
+  delete [] sp_data_eff;
+  return(NULL);
+}
+
+//-----------------------------------------------------------------------------
+//mide todos los indices solicitados en el espectro numero ns, utilizando
+//los vectores de trabajo sp_data, sp_error, sp_error_sn y sp_data_eff (de
+//dimension NAXIS1) y la memoria de trabajo de mideindex (workspace), y envia la 
+//salida a out (y, si pybinary no es NULL, los registros binarios para
+//pyindexf a pybinary en lugar de las lineas "python>"; y, si rows no es 
+//NULL, las medidas a rows en lugar de a out); las simulaciones emplean 
+//secuencias aleatorias que dependen unicamente de seed, ns y el numero de
+//simulacion; si mideindex devuelve un error, el mensaje se envia a out y
+//la funcion retorna false sin medir el resto de indices
+bool measure1sp(SciData *imagePtr, IndexParam &param, 
+                vector< IndexDef > &myindex, const long ns,
+                const uint64_t seed,
+                double *sp_data, double *sp_error, double *sp_error_sn,
+                double *sp_data_eff,
+                MideWorkspace &workspace, PyBinary *pybinary,
+                vector< ResultRow > *rows, ostream &out)
+{
+  const long nindices = myindex.size();
+  const bool lerr = ( strcmp(imagePtr->getfilename_error(),"undef") != 0 );
+  const double crval1 = imagePtr->getcrval1();
+  const double cdelt1 = imagePtr->getcdelt1();
+  const double crpix1 = imagePtr->getcrpix1();
+  const bool lognative = imagePtr->getlognative();
+  //definimos parametros adicionales
+  const long contperc = param.get_contperc();
+  const long boundfit = param.get_boundfit();
+  const long bfitdeg = param.get_bfitdeg();
+  const double bfitasym = param.get_bfitasym();
+  const bool flattened = param.get_flattened();
+  const long plotmode = param.get_plotmode();
+  const long plottype = param.get_plottype();
+  const bool  pyindexf = param.get_pyindexf();
+  //simulaciones adaptativas (0: numero fijo de simulaciones)
+  const double simtol = param.get_simtol();
+  const long simmode = param.get_simmode();
+  //mensajes de error de mideindex (la medida termina si se produce alguno)
+  ostringstream err;
+  long errcode = INDEXF_OK;
+  //extraemos y medimos el espectro
+  if (pybinary != NULL) pybinary->setspectrum(ns);
+  double findex, eindex, sn, findex_rv, eindex_rv, findex_sn, eindex_sn;
+  //sp_data_eff solo se emplea (tras reinicializarlo) en las simulaciones
+  //con S/N variable, por lo que sirve como vector de trabajo al leer; la
+  //lectura solo puede fallar si imagePtr no termina el programa en caso de
+  //error (modo filelist)
+  if (!imagePtr->getspectrum(ns,sp_data,sp_error,sp_data_eff))
+  {
+    out << imagePtr->getreaderror() << endl;
+    return(false);
+  }
+  long i1=(ns-1)*imagePtr->getnaxis1()+1;
+  long i2=i1+imagePtr->getnaxis1()-1;
+  const double rvelerr = imagePtr->getrvelerr()[ns-1];
+  const bool logindex = param.get_logindex();
+  const double biaserr = param.get_biaserr();
+  const double linearerr = param.get_linearerr();
+  const double xmin = param.get_xmin();
+  const double xmax = param.get_xmax();
+  const double ymin = param.get_ymin();
+  const double ymax = param.get_ymax();
+  //vectores para las simulaciones (reservados una unica vez por espectro,
+  //y no en cada indice o simulacion)
+  double *findex_sim = NULL;
+  bool *iffindex_sim = NULL;
+  if (param.get_nsimul() > 0)
+  {
+    findex_sim = new double [param.get_nsimul()];
+    iffindex_sim = new bool [param.get_nsimul()];
+  }
+  //si se ha solicitado, calculamos (una unica vez por espectro) las tablas
+  //de flujo acumulado, que se emplean para todos los indices y para las
+  //simulaciones de velocidad radial (en las que el espectro no cambia);
+  //las tablas asumen una escala lineal en longitud de onda
+  CumulativeFlux *cumflux = NULL;
+  if ( (param.get_cumflux()) && (!lognative) )
+  {
+    cumflux = new CumulativeFlux(imagePtr->getnaxis1(),sp_data,
+                                 (lerr ? sp_error : NULL),
+                                 crval1,cdelt1,crpix1);
+  }
+  //con rvgrid, cada indice se mide en todas las velocidades radiales de la
+  //malla (reutilizando el espectro ya extraido y las tablas de flujo
+  //acumulado); las medidas se ordenan por indice y, dentro de cada indice,
+  //por velocidad radial
+  const long nrvgrid = param.get_nrvgrid();
+  const long nvel = ( nrvgrid > 0 ? nrvgrid : 1 );
+  for (long kvel = 0; kvel < nindices*nvel; kvel++)
+  {
+    const long k = kvel/nvel+1;
+    double rvel = imagePtr->getrvel()[ns-1];
+    if (nrvgrid > 0)
+      rvel = param.get_rvgrid1()+
+             static_cast<double>(kvel%nvel)*param.get_rvgridstep();
+    bool out_of_limits,negative_error,log_negative;
+    //nombre del indice en la salida (solo si se mide mas de un indice)
+    const char *indexname = NULL;
+    if (nindices > 1) indexname = myindex[k-1].getlabel();
+    RandomStream rstream(seed,RandomStream::percentile,ns,0,0);
     bool lfindex = mideindex(lerr,sp_data,sp_error,imagePtr->getnaxis1(),
-                             crval1,cdelt1,crpix1,myindex,
-                             contperc,boundfit,flattened,
+                             crval1,cdelt1,crpix1,lognative,myindex[k-1],
+                             contperc,simtol,
+                             boundfit,bfitdeg,bfitasym,flattened,
                              logindex,
                              rvel,
                              biaserr,linearerr,
                              plotmode,plottype,
                              xmin, xmax,
                              ymin, ymax,
-                             pyindexf,
+                             pyindexf,out,pybinary,rstream,cumflux,workspace,
+                             err,errcode,
                              out_of_limits,negative_error,log_negative,
                              findex,eindex,sn);
+    if (!checkerrcode(errcode,err,out)) break;
 #ifdef HAVE_CPGPLOT_H
     if ((plotmode != 0) && (plottype >= 1))
     {
       //nombre del indice que se esta midiendo
       cpgsci(3);
-      cpgmtxt("t",6.5,0.0,0.0,param.get_index());
+      cpgmtxt("t",6.5,0.0,0.0,myindex[k-1].getlabel());
       //numero de espectro
       cpgsci(6);
       ostringstream snumber;
@@ -194,50 +573,126 @@ bool measuresp(SciData *imagePtr, IndexParam &param, IndexDef &myindex)
     }
 #endif /* HAVE_CPGPLOT_H */
     //si hay error en velocidad radial, hacemos simulaciones numericas
+    //rverrmode: 0 = simulaciones, 1 = propagacion analitica, 2 = ambas
+    const long rverrmode = param.get_rverrmode();
     eindex_rv=0;
     bool leindex_rv = true;
-    if( (lfindex) && (rvelerr > 0) && (param.get_nsimul() > 0) )
+    long nsimul_rv = 0; //numero de simulaciones realizadas
+    if( (lfindex) && (rvelerr > 0) && (param.get_nsimul() > 0) &&
+        (rverrmode != 1) )
     {
-      double *findex_sim = new double [param.get_nsimul()];
-      bool *iffindex_sim = new bool [param.get_nsimul()];
-      const double fRAND_MAX = static_cast<double>(RAND_MAX);
+      RunningStats rvstats(simtol);
       for (long nsimul=1; nsimul <= param.get_nsimul(); nsimul++)
       {
-        long iran; //evitamos obtener ran1=1 y ran2=1
-        while ( (iran=rand()) == RAND_MAX);
-        const double ran1 = static_cast<double>(iran)/fRAND_MAX;
-        while ( (iran=rand()) == RAND_MAX);
-        const double ran2 = static_cast<double>(iran)/fRAND_MAX;
-        const double delta_rvel=sqrt2*rvelerr*
-                                sqrt(-1*log(1-ran1))*cos(pi2*ran2);
+        RandomStream rstream_rv(seed,RandomStream::rvsimul,ns,0,nsimul,
+                                simmode);
+        RandomStream rstream_sim(seed,RandomStream::percentile,ns,0,nsimul);
+        const double delta_rvel=rvelerr*rstream_rv.gaussian();
         const double rvel_eff = rvel+delta_rvel;
         const bool logindex = param.get_logindex();
         double eindex_sim,sn_sim;
         bool out_of_limits_sim,negative_error_sim,log_negative_sim;
         iffindex_sim[nsimul-1]=
           mideindex(lerr,sp_data,sp_error,imagePtr->getnaxis1(),
-                    crval1,cdelt1,crpix1,myindex,
-                    contperc,boundfit,flattened,
+                    crval1,cdelt1,crpix1,lognative,myindex[k-1],
+                    contperc,simtol,boundfit,bfitdeg,bfitasym,flattened,
                     logindex,
                     rvel_eff,
                     biaserr,linearerr,
                     0,plottype, //no queremos plots (salvo continuo)
                     xmin, xmax,
                     ymin, ymax,
-                    false, //no queremos python output aqui
+                    false,out,NULL, //no queremos python output aqui
+                    rstream_sim,cumflux,workspace,
+                    err,errcode,
                     out_of_limits_sim,negative_error_sim,log_negative_sim,
                     findex_sim[nsimul-1],eindex_sim,sn_sim);
+        if (!checkerrcode(errcode,err,out)) break;
+        nsimul_rv = nsimul;
+        if (iffindex_sim[nsimul-1]) rvstats.add(findex_sim[nsimul-1]);
+        if (rvstats.converged()) break;
       }
-      leindex_rv=fmean(param.get_nsimul(),findex_sim,iffindex_sim,
+      leindex_rv=fmean(nsimul_rv,findex_sim,iffindex_sim,
                        &findex_rv,&eindex_rv);
-      delete [] findex_sim;
-      delete [] iffindex_sim;
     }
+    if (errcode != INDEXF_OK) break;
+    //propagacion analitica del error en velocidad radial: medimos el indice
+    //en rvel-rvelerr y rvel+rvelerr; la diferencia finita centrada 
+    //proporciona dI/dv (error = |dI/dv|*rvelerr) y el promedio de ambas
+    //medidas es la estimacion (a segundo orden) del valor medio del indice
+    double findex_rva=0, eindex_rva=0;
+    bool leindex_rva = true;
+    if( (lfindex) && (rvelerr > 0) && (rverrmode != 0) )
+    {
+      double findex_pm[2];
+      for (long i = 0; i < 2; i++)
+      {
+        //usamos la misma secuencia aleatoria que en la medida original
+        RandomStream rstream_sim(seed,RandomStream::percentile,ns,0,0);
+        const double rvel_eff = (i == 0) ? rvel-rvelerr : rvel+rvelerr;
+        double eindex_sim,sn_sim;
+        bool out_of_limits_sim,negative_error_sim,log_negative_sim;
+        if(!mideindex(lerr,sp_data,sp_error,imagePtr->getnaxis1(),
+                      crval1,cdelt1,crpix1,lognative,myindex[k-1],
+                      contperc,simtol,boundfit,bfitdeg,bfitasym,flattened,
+                      logindex,
+                      rvel_eff,
+                      biaserr,linearerr,
+                      0,plottype, //no queremos plots (salvo continuo)
+                      xmin, xmax,
+                      ymin, ymax,
+                      false,out,NULL, //no queremos python output aqui
+                      rstream_sim,cumflux,workspace,
+                      err,errcode,
+                      out_of_limits_sim,negative_error_sim,log_negative_sim,
+                      findex_pm[i],eindex_sim,sn_sim))
+        {
+          leindex_rva = false;
+        }
+        if (!checkerrcode(errcode,err,out)) break;
+      }
+      if (leindex_rva)
+      {
+        findex_rva = (findex_pm[0]+findex_pm[1])/2.0;
+        eindex_rva = fabs(findex_pm[1]-findex_pm[0])/2.0;
+      }
+      if (rverrmode == 1)
+      {
+        findex_rv = findex_rva;
+        eindex_rv = eindex_rva;
+        leindex_rv = leindex_rva;
+      }
+    }
+    if (errcode != INDEXF_OK) break;
     const char* labelsp = imagePtr->getlabelsp()[ns-1];
-    outmeasurement(ns,findex,eindex,sn,
-                   rvel,rvelerr,findex_rv,eindex_rv,labelsp,
-                   lfindex,lerr,leindex_rv,
-                   out_of_limits,negative_error,log_negative);
+    if (rows != NULL)
+    {
+      rowmeasurement(*rows,ns,myindex[k-1].getlabel(),findex,eindex,sn,
+                     rvel,rvelerr,findex_rv,eindex_rv,labelsp,
+                     lfindex,lerr,leindex_rv,
+                     out_of_limits,negative_error,log_negative,
+                     (rverrmode == 2),findex_rva,eindex_rva,leindex_rva,
+                     (simtol > 0 ? nsimul_rv : -1));
+    }
+    else
+    {
+      outmeasurement(out,ns,indexname,findex,eindex,sn,
+                     rvel,rvelerr,findex_rv,eindex_rv,labelsp,
+                     lfindex,lerr,leindex_rv,
+                     out_of_limits,negative_error,log_negative,
+                     (rverrmode == 2),findex_rva,eindex_rva,leindex_rva,
+                     (simtol > 0 ? nsimul_rv : -1));
+    }
+    if (pybinary != NULL)
+    {
+      long flags = 0;
+      if (lfindex) flags += PyBinary::measured;
+      if (out_of_limits) flags += PyBinary::out_of_limits;
+      if (negative_error) flags += PyBinary::negative_error;
+      if (log_negative) flags += PyBinary::log_negative;
+      pybinary->add(PyBinary::measurement,0,flags,findex,eindex);
+      pybinary->add(PyBinary::sn,0,0,sn);
+    }
     //si se ha solicitado, se realizan las simulaciones con S/N variable
     //(usamos escala logaritmica en S/N para tener una distribucion
     //homogenea de puntos al calcular las constantes de los errores)
@@ -245,62 +700,87 @@ bool measuresp(SciData *imagePtr, IndexParam &param, IndexDef &myindex)
     bool leindex_sn = true;
     if( (lfindex) && (param.get_nsimulsn() > 0) )
     {
-      const double fRAND_MAX = static_cast<double>(RAND_MAX);
       const double minsn_pixel=log10(param.get_minsn()*sqrt(cdelt1));
       const double deltasn_pixel=log10(param.get_maxsn()*sqrt(cdelt1))-
                                  minsn_pixel;
+      //solo simulamos el ruido en los pixeles que emplea el indice; el
+      //resto del espectro simulado conserva los datos originales
+      long jmin, jmax;
+      indexspan(myindex[k-1],imagePtr->getnaxis1(),crval1,cdelt1,crpix1,
+                lognative,rvel,jmin,jmax);
+      const long nspan = jmax-jmin+1;
+      for (long j = 1; j <= imagePtr->getnaxis1(); j++)
+        sp_data_eff[j-1]=sp_data[j-1];
       for (long nsimulsn=1; nsimulsn <= param.get_nsimulsn(); nsimulsn++)
       {
-        const double ran = static_cast<double>(rand())/fRAND_MAX;
-        const double sn_pixel_simul = pow(10.0,minsn_pixel+ran*deltasn_pixel);
+        RandomStream rstream_level(seed,RandomStream::snlevel,ns,nsimulsn,0);
+        const double ran = rstream_level.uniform();
+        const double sn_pixel_simul =
+          pow(10.0,minsn_pixel+ran*deltasn_pixel);
         const double sn_Ang_simul = sn_pixel_simul/sqrt(cdelt1);
         for ( long i = i1; i <= i2; i++ )
-          sp_error[i-i1]=sp_data[i-i1]/sn_pixel_simul;
-        double *findex_sim = new double [param.get_nsimul()];
-        bool *iffindex_sim = new bool [param.get_nsimul()];
+          sp_error_sn[i-i1]=sp_data[i-i1]/sn_pixel_simul;
+        long nsimul_sn = 0; //numero de simulaciones realizadas
+        RunningStats snstats(simtol);
         for (long nsimul=1; nsimul <= param.get_nsimul(); nsimul++)
         {
-          double *sp_data_eff = new double [imagePtr->getnaxis1()];
-          for ( long i = i1; i <= i2; i++ )
-          {
-            long iran; //evitamos obtener ran1=1 y ran2=1
-            while ( (iran=rand()) == RAND_MAX);
-            const double ran1 = static_cast<double>(iran)/fRAND_MAX;
-            while ( (iran=rand()) == RAND_MAX);
-            const double ran2 = static_cast<double>(iran)/fRAND_MAX;
-            const double delta_data=sqrt2*sp_error[i-i1]*
-                                    sqrt(-1*log(1-ran1))*cos(pi2*ran2);
-            sp_data_eff[i-i1]=sp_data[i-i1]+delta_data;
-          }
+          RandomStream rstream_sn(seed,RandomStream::snsimul,
+                                  ns,nsimulsn,nsimul,simmode);
+          RandomStream rstream_sim(seed,RandomStream::percentile,
+                                   ns,nsimulsn,nsimul);
+          //numeros aleatorios (los mismos que para el espectro completo)
+          rstream_sn.gaussian(sp_data_eff+jmin-1,jmin-1,nspan);
+          for (long j = jmin; j <= jmax; j++)
+            sp_data_eff[j-1]=sp_data[j-1]+sp_error_sn[j-1]*sp_data_eff[j-1];
           const bool logindex = param.get_logindex();
           double eindex_sim,sn_sim;
           bool out_of_limits_sim,negative_error_sim,log_negative_sim;
           iffindex_sim[nsimul-1]=
-            mideindex(lerr,sp_data_eff,sp_error,imagePtr->getnaxis1(),
-                      crval1,cdelt1,crpix1,myindex,
-                      contperc,boundfit,flattened,
+            mideindex(lerr,sp_data_eff,sp_error_sn,imagePtr->getnaxis1(),
+                      crval1,cdelt1,crpix1,lognative,myindex[k-1],
+                      contperc,simtol,boundfit,bfitdeg,bfitasym,flattened,
                       logindex,
                       rvel,
                       biaserr,linearerr,
                       0,0, //no queremos plots
                       xmin, xmax,
                       ymin, ymax,
-                      false, //no queremos python output aqui
+                      false,out,NULL, //no queremos python output aqui
+                      rstream_sim,NULL, //el espectro simulado es distinto
+                      workspace,err,errcode,
                       out_of_limits_sim,negative_error_sim,log_negative_sim,
                       findex_sim[nsimul-1],eindex_sim,sn_sim);
-          delete [] sp_data_eff;
+          if (!checkerrcode(errcode,err,out)) break;
+          nsimul_sn = nsimul;
+          if (iffindex_sim[nsimul-1]) snstats.add(findex_sim[nsimul-1]);
+          if (snstats.converged()) break;
         }
-        leindex_sn=fmean(param.get_nsimul(),findex_sim,iffindex_sim,
+        if (errcode != INDEXF_OK) break;
+        leindex_sn=fmean(nsimul_sn,findex_sim,iffindex_sim,
                          &findex_sn,&eindex_sn);
         const char* label_false_NULL = " ";
-        cout << endl;
-        outmeasurement(-nsimulsn,findex_sn,eindex_sn,sn_Ang_simul,
-                       rvel,0.0,0.0,0.0,label_false_NULL,
-                       lfindex,true,false,false,false,false);
-        delete [] findex_sim;
-        delete [] iffindex_sim;
+        if (rows != NULL)
+        {
+          rowmeasurement(*rows,-nsimulsn,myindex[k-1].getlabel(),
+                         findex_sn,eindex_sn,sn_Ang_simul,
+                         rvel,0.0,0.0,0.0,"",
+                         lfindex,true,false,false,false,false,
+                         (rverrmode == 2),0.0,0.0,false,
+                         (simtol > 0 ? nsimul_sn : -1));
+        }
+        else
+        {
+          out << endl;
+          outmeasurement(out,-nsimulsn,indexname,
+                         findex_sn,eindex_sn,sn_Ang_simul,
+                         rvel,0.0,0.0,0.0,label_false_NULL,
+                         lfindex,true,false,false,false,false,
+                         (rverrmode == 2),0.0,0.0,false,
+                         (simtol > 0 ? nsimul_sn : -1));
+        }
       }
     }
+    if (errcode != INDEXF_OK) break;
 #ifdef HAVE_CPGPLOT_H
     if ((plotmode == 1) || (plotmode == -1))
     {
@@ -309,23 +789,21 @@ bool measuresp(SciData *imagePtr, IndexParam &param, IndexDef &myindex)
     }
     else
 #endif /* HAVE_CPGPLOT_H */
+    if (rows == NULL)
     {
-      cout << endl;
+      out << endl;
     }
   }
-#ifdef HAVE_CPGPLOT_H
-  if (plotmode != 0)
-  {
-    cpgend();
-  }
-#endif
-  delete [] sp_data;
-  delete [] sp_error;
-  return(true);
+  delete cumflux;
+  delete [] findex_sim;
+  delete [] iffindex_sim;
+  return(errcode == INDEXF_OK);
 }
 
 //-----------------------------------------------------------------------------
-void outmeasurement(const long & ns,
+void outmeasurement(ostream & out,
+                    const long & ns,
+                    const char * indexname,
                     const double & findex, const double & eindex, 
                     const double & sn,
                     const double & rvel, const double & rvelerr,
@@ -335,7 +813,11 @@ void outmeasurement(const long & ns,
                     const bool & lerr, const bool & leindex_rv,
                     const bool & out_of_limits, 
                     const bool & negative_error,
-                    const bool & log_negative)
+                    const bool & log_negative,
+                    const bool & lrvboth,
+                    const double & findex_rva, const double & eindex_rva,
+                    const bool & leindex_rva,
+                    const long & nsimused)
 {
   //formateamos la salida
   ostringstream srvel, srvelerr;
@@ -356,6 +838,7 @@ void outmeasurement(const long & ns,
   }
   
   ostringstream sfindex, seindex, sfindex_rv, seindex_rv, ssn;
+  ostringstream sfindex_rva, seindex_rva; //rverrmode=both
   if (lfindex)
   {
     sfindex.setf(ios::fixed);
@@ -396,6 +879,26 @@ void outmeasurement(const long & ns,
       sfindex_rv << setw(10) << "undef4";
       seindex_rv << setw(10) << "undef4";
     }
+    if (lrvboth)
+    {
+      if (rvelerr <= 0)
+      {
+        sfindex_rva << setw(10) << "undef4";
+        seindex_rva << setw(10) << "undef4";
+      }
+      else if (leindex_rva)
+      {
+        sfindex_rva.setf(ios::fixed);
+        sfindex_rva << setprecision(4) << setw(10) << findex_rva;
+        seindex_rva.setf(ios::fixed);
+        seindex_rva << setprecision(4) << setw(10) << eindex_rva;
+      }
+      else
+      {
+        sfindex_rva << setw(10) << "undef1";
+        seindex_rva << setw(10) << "undef1";
+      }
+    }
   }
   else
   {
@@ -410,15 +913,137 @@ void outmeasurement(const long & ns,
     seindex << setw(10) << tipo_error;
     sfindex_rv << setw(10) << tipo_error;
     seindex_rv << setw(10) << tipo_error;
+    if (lrvboth)
+    {
+      sfindex_rva << setw(10) << tipo_error;
+      seindex_rva << setw(10) << tipo_error;
+    }
     ssn << setw(8) << tipo_error;
   }
+  //nombre del indice (solo cuando se miden varios indices)
+  ostringstream sindexname;
+  if (indexname != NULL)
+  {
+    sindexname << setiosflags(ios::left) << setw(8) << indexname << " ";
+  }
   //mostramos salida
   //cout << setw(5) << ns << " "
-  cout << snscan.str() << " "
+  out << snscan.str() << " "
+       << sindexname.str()
        << sfindex.str() << " "
        << seindex.str() << " "
        << ssn.str() << " "
        << srvel.str() << " " << srvelerr.str()
-       << sfindex_rv.str() << " " << seindex_rv.str() << "  "
-       << labelsp;
+       << sfindex_rv.str() << " " << seindex_rv.str();
+  if (lrvboth)
+  {
+    out << " " << sfindex_rva.str() << " " << seindex_rva.str();
+  }
+  //numero de simulaciones realizadas (solo con simtol > 0)
+  if (nsimused >= 0)
+  {
+    out << " " << setw(5) << nsimused;
+  }
+  out << "  " << labelsp;
+}
+
+//-----------------------------------------------------------------------------
+//anade a rows la misma informacion que outmeasurement muestra en modo
+//texto; los valores no disponibles son NaN, y el bit n de status indica
+//que outmeasurement habria mostrado el codigo undefn (el bit 6 indica el
+//codigo undef1 en las columnas de la estimacion analitica, rverrmode=both)
+void rowmeasurement(vector< ResultRow > &rows,
+                    const long & ns,
+                    const char * indexname,
+                    const double & findex, const double & eindex, 
+                    const double & sn,
+                    const double & rvel, const double & rvelerr,
+                    const double & findex_rv, const double & eindex_rv,
+                    const char * labelsp,
+                    const bool & lfindex,
+                    const bool & lerr, const bool & leindex_rv,
+                    const bool & out_of_limits, 
+                    const bool & negative_error,
+                    const bool & log_negative,
+                    const bool & lrvboth,
+                    const double & findex_rva, const double & eindex_rva,
+                    const bool & leindex_rva,
+                    const long & nsimused)
+{
+  const double undef = numeric_limits<double>::quiet_NaN();
+  ResultRow row;
+  row.ns = ns;
+  row.indexname = indexname;
+  row.findex = row.eindex = row.sn = undef;
+  row.rvel = rvel;
+  row.rvelerr = rvelerr;
+  row.findex_rv = row.eindex_rv = undef;
+  row.findex_rva = row.eindex_rva = undef;
+  row.label = labelsp;
+  row.nsimul = nsimused;
+  row.status = 0;
+  if (lfindex)
+  {
+    row.findex = findex;
+    if (lerr)
+    {
+      row.eindex = eindex;
+      row.sn = sn;
+    }
+    else
+    {
+      row.status |= 1;       //undef0
+    }
+    if (rvelerr > 0)
+    {
+      if (leindex_rv)
+      {
+        row.findex_rv = findex_rv;
+        row.eindex_rv = eindex_rv;
+      }
+      else
+      {
+        row.status |= 2;     //undef1
+      }
+    }
+    else
+    {
+      row.status |= 16;      //undef4
+    }
+    if ( (lrvboth) && (rvelerr > 0) )
+    {
+      if (leindex_rva)
+      {
+        row.findex_rva = findex_rva;
+        row.eindex_rva = eindex_rva;
+      }
+      else
+      {
+        row.status |= 64;    //undef1 en la estimacion analitica
+      }
+    }
+  }
+  else
+  {
+    if(out_of_limits)
+      row.status |= 4;       //undef2
+    else if(negative_error)
+      row.status |= 8;       //undef3
+    else if(log_negative)
+      row.status |= 32;      //undef5
+  }
+  rows.push_back(row);
+}
+
+//-----------------------------------------------------------------------------
+//mideindex no termina el programa cuando encuentra un error; en ese caso se
+//envia el mensaje a out (junto a la salida del espectro) y se retorna false
+bool checkerrcode(const long errcode, const ostringstream &err, ostream &out)
+{
+  if (errcode != INDEXF_OK)
+  {
+    out << err.str() << flush;
+    return(false);
+  }
+  return(true);
 }
@@ -34,22 +34,33 @@
 #include "cpgplot_d.h"
 #endif /* HAVE_CPGPLOT_H */
 #include "genericpixel.h"
+#include "randomstream.h"
+#include "cumulativeflux.h"
+#include "mideworkspace.h"
+#include "indexflib.h"
+#include "pybinary.h"
 
 using namespace std;
 
 bool fpercent(vector <GenericPixel> &, const long, const bool, 
-              double *, double *);
-bool boundaryfit(const long , vector <GenericPixel> &, const bool, 
-                 vector <GenericPixel> &, vector <GenericPixel> &);
+              const double, RandomStream &, double *, double *,
+              MideWorkspace &, ostream &);
+bool boundaryfit(const long, const long, const double,
+                 vector <GenericPixel> &, const bool, 
+                 vector <GenericPixel> &, vector <GenericPixel> &,
+                 MideWorkspace &, ostream &);
 
 bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error, 
                const long &naxis1,
                const double &crval1, 
                const double &cdelt1, 
                const double &crpix1,
+               const bool &lognative,
                const IndexDef &myindex,
                const long &contperc,
+               const double &simtol,
                const long &boundfit,
+               const long &bfitdeg, const double &bfitasym,
                const bool &flattened,
                const bool &logindex,
                const double &rvel,
@@ -58,28 +69,41 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
                const double &xmin_user, const double &xmax_user,
                const double &ymin_user, const double &ymax_user,
                const bool &pyindexf,
+               ostream &out,
+               PyBinary *pybinary,
+               RandomStream &rstream,
+               const CumulativeFlux *cumflux,
+               MideWorkspace &workspace,
+               ostream &err, long &errcode,
                bool &out_of_limits, bool &negative_error, bool &log_negative,
                double &findex, double &eindex, double &sn)
 {
+  //---------------------------------------------------------------------------
+  //los errores no abortan la ejecucion: el mensaje se envia a err, su codigo
+  //se devuelve en errcode (ver indexflib.h) y la funcion retorna false
+  errcode=INDEXF_OK;
   //---------------------------------------------------------------------------
   //protecciones
   if ( (contperc >= 0) && (boundfit != 0) )
   {
-    cout << "ERROR: contperc and boundfit cannot be used simultaneously"
-         << endl;
-    exit(1);
+    err << "ERROR: contperc and boundfit cannot be used simultaneously"
+        << endl;
+    errcode=INDEXF_INVALID_OPTIONS;
+    return(false);
   }
   if ( (contperc >= 0) && (flattened) )
   {
-    cout << "ERROR: contperc and flattened cannot be used simultaneously"
-         << endl;
-    exit(1);
+    err << "ERROR: contperc and flattened cannot be used simultaneously"
+        << endl;
+    errcode=INDEXF_INVALID_OPTIONS;
+    return(false);
   }
   if ( (boundfit != 0) && (flattened) )
   {
-    cout << "ERROR: boundfit and flattened cannot be used simultaneously"
-         << endl;
-    exit(1);
+    err << "ERROR: boundfit and flattened cannot be used simultaneously"
+        << endl;
+    errcode=INDEXF_INVALID_OPTIONS;
+    return(false);
   }
   //---------------------------------------------------------------------------
   //mientras no se demuestre lo contario, no hay problemas al medir
@@ -109,49 +133,86 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
   //se calcula como:
   //lambda=crval1+(j-crpix1)*cdelt1
   //con j definido en el intervalo [1,NAXIS1]
+  //Si lognative=true, los espectros estan en su escala logaritmica original
+  //y lo anterior se aplica a log10(lambda): los limites de las bandas se
+  //calculan en esa escala y cada pixel tiene una anchura distinta en
+  //Angstroms (ver dwpix mas abajo)
   //---------------------------------------------------------------------------
   //calculamos parametros de cada banda a medir
   const long nbands = myindex.getnbands();
-  double *ca = new double [nbands];
-  double *cb = new double [nbands];
-  double *c3 = new double [nbands];
-  double *c4 = new double [nbands];
-  long *j1 = new long [nbands];
-  long *j2 = new long [nbands];
-  double *d1 = new double [nbands];
-  double *d2 = new double [nbands];
-  double *rl = new double [nbands];
-  double *rg = new double [nbands];
+  //los vectores de trabajo pertenecen a workspace (reutilizados entre
+  //llamadas); aqui solo se garantiza su dimension
+  workspace.reserve(nbands,naxis1);
+  double *ca = workspace.ca;
+  double *cb = workspace.cb;
+  double *c3 = workspace.c3;
+  double *c4 = workspace.c4;
+  long *j1 = workspace.j1;
+  long *j2 = workspace.j2;
+  double *d1 = workspace.d1;
+  double *d2 = workspace.d2;
+  double *rl = workspace.rl;
+  double *rg = workspace.rg;
   for (long nb=0; nb < nbands; nb++)
   {
     ca[nb] = myindex.getldo1(nb)*rcvel1;             //redshifted wavelength
     cb[nb] = myindex.getldo2(nb)*rcvel1;             //redshifted wavelength
     if(pyindexf)
     {
-      cout << "python> {'w_ini" << setw(3) << setfill('0') << nb+1 << "': " 
-           <<           ca[nb] << ", "
-           <<          "'w_end" << setw(3) << setfill('0') << nb+1 << "': " 
-           <<           cb[nb] << "}"
-           << endl;
-      if (myindex.gettype() == 10)
+      if (pybinary != NULL)
       {
-        cout << "python> {'factor" << setw(3) << setfill('0') << nb+1 << "': "
-             <<           myindex.getfactor_el(nb) << "}"
+        pybinary->add(PyBinary::wband,nb+1,0,ca[nb],cb[nb]);
+      }
+      else
+      {
+        out << "python> {'w_ini" << setw(3) << setfill('0') << nb+1 << "': " 
+             <<           ca[nb] << ", "
+             <<          "'w_end" << setw(3) << setfill('0') << nb+1 << "': " 
+             <<           cb[nb] << "}"
              << endl;
       }
+      if (myindex.gettype() == 10)
+      {
+        if (pybinary != NULL)
+        {
+          pybinary->add(PyBinary::factor,nb+1,0,myindex.getfactor_el(nb));
+        }
+        else
+        {
+          out << "python> {'factor" << setw(3) << setfill('0') << nb+1 << "': "
+               <<           myindex.getfactor_el(nb) << "}"
+               << endl;
+        }
+      }
       else if ((myindex.gettype() >= 101) & (myindex.gettype() <= 9999))
       {
         long nconti = myindex.getnconti();
         if (nb >= nconti)
         {
-          cout << "python> {'factor" << setw(3) << setfill('0') << nb+1 << "': "
-               <<           myindex.getfactor(nb-nconti) << "}"
-               << endl;
+          if (pybinary != NULL)
+          {
+            pybinary->add(PyBinary::factor,nb+1,0,
+                          myindex.getfactor(nb-nconti));
+          }
+          else
+          {
+            out << "python> {'factor" << setw(3) << setfill('0') << nb+1 
+                 << "': " <<  myindex.getfactor(nb-nconti) << "}"
+                 << endl;
+          }
         }
       }
     }
-    c3[nb] = (ca[nb]-wlmin)/cdelt1+1.0;              //band limit (channel)
-    c4[nb] = (cb[nb]-wlmin)/cdelt1;                  //band limit (channel)
+    if (lognative)
+    {
+      c3[nb] = (log10(ca[nb])-wlmin)/cdelt1+1.0;     //band limit (channel)
+      c4[nb] = (log10(cb[nb])-wlmin)/cdelt1;         //band limit (channel)
+    }
+    else
+    {
+      c3[nb] = (ca[nb]-wlmin)/cdelt1+1.0;            //band limit (channel)
+      c4[nb] = (cb[nb]-wlmin)/cdelt1;                //band limit (channel)
+    }
     if ( (c3[nb] < 1.0) || (c4[nb] > static_cast<double>(naxis1-1)) )
     {
       out_of_limits=true;          //indice fuera de limites: no se puede medir
@@ -162,6 +223,15 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       j2[nb] = static_cast<long>(c4[nb]);       //band limit: integer (channel)
       d1[nb] = c3[nb]-static_cast<double>(j1[nb]);//fraction (excess left chan)
       d2[nb] = c4[nb]-static_cast<double>(j2[nb]);//fraction (defect right chan)
+      if (lognative) //fracciones de los pixels extremos medidas en Angstroms
+      {
+        const double w1a=pow(10.0,wlmin+static_cast<double>(j1[nb]-1)*cdelt1);
+        const double w1b=pow(10.0,wlmin+static_cast<double>(j1[nb])*cdelt1);
+        d1[nb] = (ca[nb]-w1a)/(w1b-w1a);
+        const double w2a=pow(10.0,wlmin+static_cast<double>(j2[nb])*cdelt1);
+        const double w2b=pow(10.0,wlmin+static_cast<double>(j2[nb]+1)*cdelt1);
+        d2[nb] = (cb[nb]-w2a)/(w2b-w2a);
+      }
       rl[nb] = cb[nb]-ca[nb];               //redshifted band width (angstroms)
       rg[nb] = c4[nb]-c3[nb]+1;             //redshifted band width (channels)
     }
@@ -200,15 +270,27 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
           {
             for (long j=j1[nb]; j <= j2[nb]+1; j++)
             {
-              meansn+=sp_data[j-1]/sp_error[j-1];
+              double dw=1.0; //anchura relativa del pixel
+              if (lognative)
+                dw=pow(10.0,wlmin+static_cast<double>(j)*cdelt1)-
+                   pow(10.0,wlmin+static_cast<double>(j-1)*cdelt1);
+              meansn+=sp_data[j-1]/sp_error[j-1]/sqrt(dw);
             }
             meansn/=static_cast<double>(j2[nb]-j1[nb]+2);
-            meansn/=sqrt(cdelt1); //calculamos senal/ruido por angstrom
+            if (!lognative)
+              meansn/=sqrt(cdelt1); //calculamos senal/ruido por angstrom
           }
         }
       }
-      cout << "python> {'meansn" << setw(3) << setfill('0') << nb+1 << "': "
-           <<           meansn << "}" << endl;
+      if (pybinary != NULL)
+      {
+        pybinary->add(PyBinary::meansn,nb+1,0,meansn);
+      }
+      else
+      {
+        out << "python> {'meansn" << setw(3) << setfill('0') << nb+1 << "': "
+             <<           meansn << "}" << endl;
+      }
     }
   }
   // si el indice cae fuera de limites, no se puede medir
@@ -229,17 +311,57 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     if (j1min > j1[nb]) j1min=j1[nb];
     if (j2max < j2[nb]) j2max=j2[nb];
   }
-  //calculamos limites en longitud de onda (rest frame)
-  double wvmin= myindex.getldo1(0);
-  double wvmax= myindex.getldo2(0);
-  double wv1temp,wv2temp;
-  for (long nb=0; nb < nbands; nb++ )
+  //pixeles a procesar: sin graficos basta con la region que ocupan las
+  //bandas del indice (j1min...j2max+1), de forma que el coste de cada
+  //medida (y de cada simulacion) depende de la anchura del indice y no de
+  //la longitud del espectro; los graficos necesitan el espectro completo
+  const long jlo = ( plotmode == 0 ? j1min : 1 );
+  const long jhi = ( plotmode == 0 ? j2max+1 : naxis1 );
+  //longitud de onda en el centro de cada pixel (wpix) y anchura de cada
+  //pixel (dwpix*dlambda, en Angstroms); en escala lineal dwpix=1 y la
+  //anchura comun dlambda=cdelt1 se aplica al final de cada integral; los
+  //ajustes del continuo a una recta emplean la coordenada xpix, que es el
+  //numero de pixel en escala lineal y una funcion lineal de la longitud de
+  //onda en escala logaritmica: xpix=(lambda-wxref)/wxstep+wxpix
+  const double dlambda = ( lognative ? 1.0 : cdelt1 );
+  double *wpix = workspace.wpix;
+  double *dwpix = workspace.dwpix;
+  double *xpix = workspace.xpix;
+  if (lognative)
+  {
+    double wedge1=pow(10.0,wlmin+static_cast<double>(jlo-1)*cdelt1);
+    for (long j=jlo; j <= jhi; j++)
+    {
+      const double wedge2=pow(10.0,wlmin+static_cast<double>(j)*cdelt1);
+      wpix[j-1]=pow(10.0,wlmin+(static_cast<double>(j)-0.5)*cdelt1);
+      dwpix[j-1]=wedge2-wedge1;
+      wedge1=wedge2;
+    }
+  }
+  else
+  {
+    for (long j=jlo; j <= jhi; j++)
+    {
+      wpix[j-1]=static_cast<double>(j-1)*cdelt1+crval1-(crpix1-1.0)*cdelt1;
+      dwpix[j-1]=1.0;
+    }
+  }
+  //(en escala logaritmica la referencia es el primer pixel del espectro)
+  const double wxref =
+    ( lognative ? pow(10.0,wlmin+0.5*cdelt1) : crval1 );
+  const double wxstep =
+    ( lognative ? pow(10.0,wlmin+cdelt1)-pow(10.0,wlmin) : cdelt1 );
+  const double wxpix = ( lognative ? 1.0 : crpix1 );
+  for (long j=jlo; j <= jhi; j++)
   {
-    wv1temp=myindex.getldo1(nb);
-    wv2temp=myindex.getldo2(nb);
-    if(wvmin > wv1temp) wvmin=wv1temp;
-    if(wvmax < wv2temp) wvmax=wv2temp;
+    if (lognative)
+      xpix[j-1]=(wpix[j-1]-wxref)/wxstep+wxpix;
+    else
+      xpix[j-1]=static_cast<double>(j);
   }
+  //limites en longitud de onda (rest frame), precalculados en IndexDef
+  const double wvmin= myindex.getldomin();
+  const double wvmax= myindex.getldomax();
 
 #ifdef HAVE_CPGPLOT_H
   //===========================================================================
@@ -467,8 +589,9 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       }
       else //.......................................................sin definir
       {
-        cout << "Invalid index type=" << myindex.gettype() << endl;
-        exit(1);
+        err << "Invalid index type=" << myindex.gettype() << endl;
+        errcode=INDEXF_INVALID_INDEX;
+        return(false);
       }
       const double xc1=(ca[nb]-crval1)/cdelt1+crpix1;
       const double xc2=(cb[nb]-crval1)/cdelt1+crpix1;
@@ -486,8 +609,8 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
   //---------------------------------------------------------------------------
   //fijamos los canales a usar para medir el indice (usando la variable
   //logica evitamos el problema de la posible superposicion de las bandas)
-  bool *ifchan = new bool [naxis1];
-  for (long j=1; j <= naxis1; j++)
+  bool *ifchan = workspace.ifchan;
+  for (long j=jlo; j <= jhi; j++)
   {
     ifchan[j-1] = false;
   }
@@ -499,7 +622,7 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     }
   }
   long nceff=0;
-  for (long j=1; j <= naxis1; j++)
+  for (long j=jlo; j <= jhi; j++)
   {
     if (ifchan[j-1]) nceff++;
   }
@@ -507,8 +630,8 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
   //---------------------------------------------------------------------------
   //normalizamos datos usando la senal solo en la region del indice a medir
   //(si flattened=true, no lo hacemos)
-  double *s = new double [naxis1];
-  double *es = new double [naxis1];
+  double *s = workspace.s;
+  double *es = workspace.es;
   double smean;
   if (flattened)
   {
@@ -517,20 +640,20 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
   else
   {
     smean=0.0;
-    for (long j=1; j <= naxis1; j++)
+    for (long j=jlo; j <= jhi; j++)
     {
       if (ifchan[j-1]) smean+=sp_data[j-1];
     }
     smean/=static_cast<double>(nceff);
     smean = ( smean != 0 ? smean : 1.0); //evitamos division por cero
   }
-  for (long j=1; j <= naxis1; j++)
+  for (long j=jlo; j <= jhi; j++)
   {
     s[j-1]=sp_data[j-1]/smean;
   }
   if(lerr)
   {
-    for (long j=1; j <= naxis1; j++)
+    for (long j=jlo; j <= jhi; j++)
     {
       es[j-1]=sp_error[j-1]/smean;
     }
@@ -542,15 +665,15 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
   sn=0.0;
   if(lerr)
   {
-    for (long j=1; j <= naxis1; j++)
+    for (long j=jlo; j <= jhi; j++)
     {
       if (ifchan[j-1])
       {
-        sn+=s[j-1]/es[j-1];
+        sn+=s[j-1]/es[j-1]/sqrt(dwpix[j-1]);
       }
     }
     sn/=static_cast<double>(nceff);
-    sn/=sqrt(cdelt1); //calculamos senal/ruido por angstrom
+    sn/=sqrt(dlambda); //calculamos senal/ruido por angstrom
   }
 
   //---------------------------------------------------------------------------
@@ -562,21 +685,24 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     //protecciones
     if ( contperc >= 0 )
     {
-      cout << "ERROR: biaserr and contperc cannot be used simultaneously"
-           << endl;
-      exit(1);
+      err << "ERROR: biaserr and contperc cannot be used simultaneously"
+          << endl;
+      errcode=INDEXF_INVALID_OPTIONS;
+      return(false);
     }
     if ( boundfit != 0 )
     {
-      cout << "ERROR: biaserr and boundfit cannot be used simultaneously"
-           << endl;
-      exit(1);
+      err << "ERROR: biaserr and boundfit cannot be used simultaneously"
+          << endl;
+      errcode=INDEXF_INVALID_OPTIONS;
+      return(false);
     }
     if ( flattened )
     {
-      cout << "ERROR: biaserr and flattened cannot be used simultaneously"
-           << endl;
-      exit(1);
+      err << "ERROR: biaserr and flattened cannot be used simultaneously"
+          << endl;
+      errcode=INDEXF_INVALID_OPTIONS;
+      return(false);
     }
     //indice atomico o molecular
     if ( (myindex.gettype() == 1) || (myindex.gettype() == 2) )
@@ -621,14 +747,21 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       double sc = (sb*(mwr-wla)+sr*(wla-mwb))/(mwr-mwb);
       //anadimos el efecto sistematico al espectro de datos (el espectro de
       //errores no se modifica)
-      for (long j=1; j <= naxis1; j++)
+      for (long j=jlo; j <= jhi; j++)
       {
         s[j-1]+=sc*biaserr/100.0;
       }
       if (pyindexf)
       {
-        cout << "python> {'biaserrfactor': " << sc*biaserr/100.0
-             << "}" << endl;
+        if (pybinary != NULL)
+        {
+          pybinary->add(PyBinary::biaserrfactor,0,0,sc*biaserr/100.0);
+        }
+        else
+        {
+          out << "python> {'biaserrfactor': " << sc*biaserr/100.0
+               << "}" << endl;
+        }
       }
     }
     //D4000 o B4000
@@ -670,29 +803,44 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       double sc = (sb+sr)/2.0;
       //anadimos el efecto sistematico al espectro de datos (el espectro de
       //errores no se modifica)
-      for (long j=1; j <= naxis1; j++)
+      for (long j=jlo; j <= jhi; j++)
       {
         s[j-1]+=sc*biaserr/100.0;
       }
       if (pyindexf)
       {
-        cout << "python> {'biaserrfactor': " << sc*biaserr/100.0
-             << "}" << endl;
+        if (pybinary != NULL)
+        {
+          pybinary->add(PyBinary::biaserrfactor,0,0,sc*biaserr/100.0);
+        }
+        else
+        {
+          out << "python> {'biaserrfactor': " << sc*biaserr/100.0
+               << "}" << endl;
+        }
       }
     }
     //indices para los cuales no se ha incluido el efecto de biaserr
     else
     {
-      cout << "FATAL ERROR: biaserr=" << biaserr
-           << " cannot be handled for this type of index." << endl;
-      exit(1);
+      err << "FATAL ERROR: biaserr=" << biaserr
+          << " cannot be handled for this type of index." << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
   }
   else
   {
     if (pyindexf)
     {
-      cout << "python> {'biaserrfactor': 0.0}" << endl;
+      if (pybinary != NULL)
+      {
+        pybinary->add(PyBinary::biaserrfactor,0,0,0.0);
+      }
+      else
+      {
+        out << "python> {'biaserrfactor': 0.0}" << endl;
+      }
     }
   }
 
@@ -705,24 +853,27 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     //proteccion
     if ( contperc >= 0 )
     {
-      cout << "ERROR: linearerr and contperc cannot be used simultaneously"
-           << endl;
-      exit(1);
+      err << "ERROR: linearerr and contperc cannot be used simultaneously"
+          << endl;
+      errcode=INDEXF_INVALID_OPTIONS;
+      return(false);
     }
     if ( boundfit != 0 )
     {
-      cout << "ERROR: linearerr and boundfit cannot be used simultaneously"
-           << endl;
-      exit(1);
+      err << "ERROR: linearerr and boundfit cannot be used simultaneously"
+          << endl;
+      errcode=INDEXF_INVALID_OPTIONS;
+      return(false);
     }
     if ( flattened )
     {
-      cout << "ERROR: linearerr and flattened cannot be used simultaneously"
-           << endl;
-      exit(1);
+      err << "ERROR: linearerr and flattened cannot be used simultaneously"
+          << endl;
+      errcode=INDEXF_INVALID_OPTIONS;
+      return(false);
     }
     double scale_factor;
-    for (long j=1; j <= naxis1; j++)
+    for (long j=jlo; j <= jhi; j++)
     {
       if (s[j-1] >= 0.0 )
       {
@@ -737,6 +888,13 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     }
   }
 
+  //---------------------------------------------------------------------------
+  //las tablas de flujo acumulado (si se dispone de ellas) se calculan con el
+  //espectro original, por lo que solo pueden emplearse si este no se ha
+  //modificado con biaserr o linearerr
+  const bool lcumflux = ( (cumflux != NULL) && (!lognative) &&
+                          (fabs(biaserr) == 0.0) && (fabs(linearerr) == 0.0) );
+
   //***************************************************************************
   //Indices atomicos y moleculares
   //***************************************************************************
@@ -746,14 +904,14 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     //protecciones
     if ( contperc >= 0 )
     {
-      cout << "#WARNING: contperc is being implemented for this index"
+      out << "#WARNING: contperc is being implemented for this index"
            << endl;
     }
     if ( boundfit != 0 )
     {
-      cout << "#WARNING: boundfit is being implemented for this index"
+      out << "#WARNING: boundfit is being implemented for this index"
            << endl;
-      cout << "#smean: " << smean << endl;
+      out << "#smean: " << smean << endl;
     }
     //calculamos longitudes de onda en el centro de las bandas de continuo
     double mwb = (myindex.getldo1(0)+myindex.getldo2(0))/2.0;
@@ -762,13 +920,20 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     mwr*=rcvel1;
     if(pyindexf)
     {
-      cout << "python> {'w_blue_center': " << mwb << ", "
-                       "'w_red_center': "  << mwr << "}" << endl;
+      if (pybinary != NULL)
+      {
+        pybinary->add(PyBinary::wcenter,0,0,mwb,mwr);
+      }
+      else
+      {
+        out << "python> {'w_blue_center': " << mwb << ", "
+                         "'w_red_center': "  << mwr << "}" << endl;
+      }
     }
     //declaramos las variables en las que incluiremos el pseudo-continuo
     //evaluado en la banda central
-    double *sc = new double [naxis1];
-    double *esc2 = new double [naxis1];
+    double *sc = workspace.sc;
+    double *esc2 = workspace.esc2;
     //-------------------------------------------------------------------------
     double sb=0.0;                 //flujo "promedio" para centro de banda azul
     double esb2=0.0;               //error en el flujo anterior
@@ -778,8 +943,10 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     if(fabs(boundfit) == 1) //..boundfit independiente a cada banda de continuo
     {
       //...................................................incluimos banda azul
-      vector <GenericPixel> fluxpix_blue;  //datos a ajustar
-      vector <GenericPixel> boundfit_blue; //ajuste a los datos
+      vector <GenericPixel> &fluxpix_blue = //datos a ajustar
+        workspace.getpixels(MideWorkspace::fluxpix);
+      vector <GenericPixel> &boundfit_blue = //ajuste a los datos
+        workspace.getpixels(MideWorkspace::fitpix);
       for (long j=j1[0]; j<=j2[0]+1; j++)
       {
         double f;
@@ -798,13 +965,17 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         boundfit_blue.push_back(temppix);
       }
       GenericPixel evalpix; //pixel puntual a ser evaluado
-      vector <GenericPixel> evaluate_blue; //vector de pixeles a evaluar
+      vector <GenericPixel> &evaluate_blue = //vector de pixeles a evaluar
+        workspace.getpixels(MideWorkspace::evalpix);
       evalpix.setwave(mwb);
       evaluate_blue.push_back(evalpix);
-      if(!boundaryfit(boundfit,fluxpix_blue,lerr,boundfit_blue,evaluate_blue))
+      if(!boundaryfit(boundfit,bfitdeg,bfitasym,
+                      fluxpix_blue,lerr,boundfit_blue,evaluate_blue,
+                      workspace,err))
       {
-        cout << "ERROR: while computing boundary fit in blue band" << endl;
-        exit(1);
+        err << "ERROR: while computing boundary fit in blue band" << endl;
+        errcode=INDEXF_FIT_FAILED;
+        return(false);
       }
       sb=evaluate_blue[0].getflux();
       esb2=evaluate_blue[0].geteflux();
@@ -830,8 +1001,10 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       }//======================================================================
 #endif /* HAVE_CPGPLOT_H */     
       //...................................................incluimos banda roja
-      vector <GenericPixel> fluxpix_red;
-      vector <GenericPixel> boundfit_red;
+      vector <GenericPixel> &fluxpix_red =
+        workspace.getpixels(MideWorkspace::fluxpix);
+      vector <GenericPixel> &boundfit_red =
+        workspace.getpixels(MideWorkspace::fitpix);
       for (long j=j1[2]; j<=j2[2]+1; j++)
       {
         double f;
@@ -849,13 +1022,17 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         temppix.seteflux(0.0);
         boundfit_red.push_back(temppix);
       }
-      vector <GenericPixel> evaluate_red; //vector de pixeles a evaluar
+      vector <GenericPixel> &evaluate_red = //vector de pixeles a evaluar
+        workspace.getpixels(MideWorkspace::evalpix);
       evalpix.setwave(mwr);
       evaluate_red.push_back(evalpix);
-      if(!boundaryfit(boundfit,fluxpix_red,lerr,boundfit_red,evaluate_red))
+      if(!boundaryfit(boundfit,bfitdeg,bfitasym,
+                      fluxpix_red,lerr,boundfit_red,evaluate_red,
+                      workspace,err))
       {
-        cout << "ERROR: while computing boundary fit in red band" << endl;
-        exit(1);
+        err << "ERROR: while computing boundary fit in red band" << endl;
+        errcode=INDEXF_FIT_FAILED;
+        return(false);
       }
       sr=evaluate_red[0].getflux();
       esr2=evaluate_red[0].geteflux();
@@ -885,8 +1062,10 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     else if( (fabs(boundfit) == 2) || (fabs(boundfit) == 3) )
     {
       //...................................................incluimos banda azul
-      vector <GenericPixel> fluxpix_all;  //datos a ajustar
-      vector <GenericPixel> boundfit_all; //ajuste a los datos
+      vector <GenericPixel> &fluxpix_all = //datos a ajustar
+        workspace.getpixels(MideWorkspace::fluxpix);
+      vector <GenericPixel> &boundfit_all = //ajuste a los datos
+        workspace.getpixels(MideWorkspace::fitpix);
       for (long j=j1[0]; j<=j2[0]+1; j++)
       {
         double f;
@@ -943,15 +1122,19 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         boundfit_all.push_back(temppix);
       }
       GenericPixel evalpix; //pixel puntual a ser evaluado
-      vector <GenericPixel> evaluate; //vector de pixeles a evaluar
+      vector <GenericPixel> &evaluate = //vector de pixeles a evaluar
+        workspace.getpixels(MideWorkspace::evalpix);
       evalpix.setwave(mwb);
       evaluate.push_back(evalpix);
       evalpix.setwave(mwr);
       evaluate.push_back(evalpix);
-      if(!boundaryfit(boundfit,fluxpix_all,lerr,boundfit_all,evaluate))
+      if(!boundaryfit(boundfit,bfitdeg,bfitasym,
+                      fluxpix_all,lerr,boundfit_all,evaluate,
+                      workspace,err))
       {
-        cout << "ERROR: while computing boundary fit in several bands" << endl;
-        exit(1);
+        err << "ERROR: while computing boundary fit in several bands" << endl;
+        errcode=INDEXF_FIT_FAILED;
+        return(false);
       }
       sb=evaluate[0].getflux();
       esb2=evaluate[0].geteflux();
@@ -985,8 +1168,10 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     //boundfit=5 calcula integral entre el boundary fit y el espectro
     else if( (fabs(boundfit) == 4) || (fabs(boundfit) == 5) )
     {
-      vector <GenericPixel> fluxpix_all;  //datos a ajustar
-      vector <GenericPixel> boundfit_all; //ajuste a los datos
+      vector <GenericPixel> &fluxpix_all = //datos a ajustar
+        workspace.getpixels(MideWorkspace::fluxpix);
+      vector <GenericPixel> &boundfit_all = //ajuste a los datos
+        workspace.getpixels(MideWorkspace::fitpix);
       for (long j=j1[0]; j<=j2[2]+1; j++) //.....................incluimos todo
       {
         double f;
@@ -1005,7 +1190,8 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         boundfit_all.push_back(temppix);
       }
       GenericPixel evalpix; //pixel puntual a ser evaluado
-      vector <GenericPixel> evaluate; //vector de pixeles a evaluar
+      vector <GenericPixel> &evaluate = //vector de pixeles a evaluar
+        workspace.getpixels(MideWorkspace::evalpix);
       if (fabs(boundfit) == 4) //evaluamos puntos centrales de bandas laterales
       {
         evalpix.setwave(mwb);
@@ -1033,10 +1219,13 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
           evaluate.push_back(evalpix);
         }
       }
-      if(!boundaryfit(boundfit,fluxpix_all,lerr,boundfit_all,evaluate))
+      if(!boundaryfit(boundfit,bfitdeg,bfitasym,
+                      fluxpix_all,lerr,boundfit_all,evaluate,
+                      workspace,err))
       {
-        cout << "ERROR: while computing boundary fit in several bands" << endl;
-        exit(1);
+        err << "ERROR: while computing boundary fit in several bands" << endl;
+        errcode=INDEXF_FIT_FAILED;
+        return(false);
       }
       if (fabs(boundfit) == 4)
       {
@@ -1082,14 +1271,16 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       //banda azul
       if (j2[0]-j1[0] < 2)
       {
-        cout << "ERROR: number of pixels in blue continuum bandpass too low "
-             << "to use contperc"
-             << endl;
-        exit(1);
+        err << "ERROR: number of pixels in blue continuum bandpass too low "
+            << "to use contperc"
+            << endl;
+        errcode=INDEXF_FIT_FAILED;
+        return(false);
       }
       else
       {
-        vector <GenericPixel> fluxpix_blue;
+        vector <GenericPixel> &fluxpix_blue =
+          workspace.getpixels(MideWorkspace::fluxpix);
         for (long j=j1[0]; j<=j2[0]+1; j++)
         {
           double f;
@@ -1104,23 +1295,27 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
           GenericPixel temppix(wave,s[j-1],es[j-1],f);
           fluxpix_blue.push_back(temppix);
         }
-        if(!fpercent(fluxpix_blue,contperc,lerr,&sb,&esb2))
+        if(!fpercent(fluxpix_blue,contperc,lerr,simtol,rstream,&sb,&esb2,
+                     workspace,err))
         {
-          cout << "ERROR: while computing percentile" << endl;
-          exit(1);
+          err << "ERROR: while computing percentile" << endl;
+          errcode=INDEXF_FIT_FAILED;
+          return(false);
         }
       }
       //banda roja
       if (j2[2]-j1[2] < 2)
       {
-        cout << "ERROR: number of pixels in red continuum bandpass too low "
-             << "to use contperc"
-             << endl;
-        exit(1);
+        err << "ERROR: number of pixels in red continuum bandpass too low "
+            << "to use contperc"
+            << endl;
+        errcode=INDEXF_FIT_FAILED;
+        return(false);
       }
       else
       {
-        vector <GenericPixel> fluxpix_red;
+        vector <GenericPixel> &fluxpix_red =
+          workspace.getpixels(MideWorkspace::fluxpix);
         for (long j=j1[2]; j<=j2[2]+1; j++)
         {
           double f;
@@ -1135,10 +1330,12 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
           GenericPixel temppix(wave,s[j-1],es[j-1],f);
           fluxpix_red.push_back(temppix);
         }
-        if(!fpercent(fluxpix_red,contperc,lerr,&sr,&esr2))
+        if(!fpercent(fluxpix_red,contperc,lerr,simtol,rstream,&sr,&esr2,
+                     workspace,err))
         {
-          cout << "ERROR: while computing percentile" << endl;
-          exit(1);
+          err << "ERROR: while computing percentile" << endl;
+          errcode=INDEXF_FIT_FAILED;
+          return(false);
         }
       }
     }
@@ -1150,6 +1347,19 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         sb = 1.0;
         esb2 = 0.0;
       }
+      else if (lcumflux)
+      {
+        sb=cumflux->getsumflux(j1[0],j2[0],d1[0],d2[0])/smean;
+        if(lerr) esb2=cumflux->getsumvar(j1[0],j2[0],d1[0],d2[0])/
+                      (smean*smean);
+        sb*=cdelt1;
+        sb/=rl[0];
+        if(lerr)
+        {
+          esb2*=cdelt1*cdelt1;
+          esb2/=(rl[0]*rl[0]);
+        }
+      }
       else
       {
         for (long j=j1[0]; j<=j2[0]+1; j++)
@@ -1161,14 +1371,14 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
             f=d2[0];
           else
             f=1.0;
-          sb+=f*s[j-1];
-          if(lerr) esb2+=f*f*es[j-1]*es[j-1];
+          sb+=f*s[j-1]*dwpix[j-1];
+          if(lerr) esb2+=f*f*es[j-1]*es[j-1]*dwpix[j-1]*dwpix[j-1];
         }
-        sb*=cdelt1;
+        sb*=dlambda;
         sb/=rl[0];
         if(lerr)
         {
-          esb2*=cdelt1*cdelt1;
+          esb2*=dlambda*dlambda;
           esb2/=(rl[0]*rl[0]);
         }
       }
@@ -1178,6 +1388,19 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         sr = 1.0;
         esr2 = 0.0;
       }
+      else if (lcumflux)
+      {
+        sr=cumflux->getsumflux(j1[2],j2[2],d1[2],d2[2])/smean;
+        if(lerr) esr2=cumflux->getsumvar(j1[2],j2[2],d1[2],d2[2])/
+                      (smean*smean);
+        sr*=cdelt1;
+        sr/=rl[2];
+        if(lerr)
+        {
+          esr2*=cdelt1*cdelt1;
+          esr2/=(rl[2]*rl[2]);
+        }
+      }
       else
       {
         for (long j=j1[2]; j<=j2[2]+1; j++)
@@ -1189,21 +1412,28 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
             f=d2[2];
           else
             f=1.0;
-          sr+=f*s[j-1];
-          if(lerr) esr2+=f*f*es[j-1]*es[j-1];
+          sr+=f*s[j-1]*dwpix[j-1];
+          if(lerr) esr2+=f*f*es[j-1]*es[j-1]*dwpix[j-1]*dwpix[j-1];
         }
-        sr*=cdelt1;
+        sr*=dlambda;
         sr/=rl[2];
         if(lerr)
         {
-          esr2*=cdelt1*cdelt1;
+          esr2*=dlambda*dlambda;
           esr2/=(rl[2]*rl[2]);
         }
       }
       if(pyindexf)
       {
-        cout << "python> {'f_blue_center': " << sb*smean << ", "
-             <<          "'f_red_center': "  << sr*smean << "}" << endl;
+        if (pybinary != NULL)
+        {
+          pybinary->add(PyBinary::fcenter,0,0,sb*smean,sr*smean);
+        }
+        else
+        {
+          out << "python> {'f_blue_center': " << sb*smean << ", "
+               <<          "'f_red_center': "  << sr*smean << "}" << endl;
+        }
       }
     }
     //.........................................................................
@@ -1213,14 +1443,14 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     {
       for (long j = j1min; j <= j2max+1; j++)
       {
-        double wla=static_cast<double>(j-1)*cdelt1+crval1-(crpix1-1.0)*cdelt1;
+        double wla=wpix[j-1];
         sc[j-1] = (sb*(mwr-wla)+sr*(wla-mwb))/(mwr-mwb);
       }
       if(lerr)
       {
         for (long j = j1min; j <= j2max+1; j++)
         {
-          double wla=static_cast<double>(j-1)*cdelt1+crval1-(crpix1-1.0)*cdelt1;
+          double wla=wpix[j-1];
           esc2[j-1] = (esb2*(mwr-wla)*(mwr-wla)+esr2*(wla-mwb)*(wla-mwb))/
                       ((mwr-mwb)*(mwr-mwb));
         }
@@ -1238,7 +1468,7 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         f=d2[1];
       else
         f=1.0;
-      tc+=f*s[j-1]/sc[j-1];
+      tc+=f*s[j-1]/sc[j-1]*dwpix[j-1];
 #ifdef HAVE_CPGPLOT_H
       //================================================
       //dibujamos lineas verticales uniendo el flujo en
@@ -1253,9 +1483,8 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       if(lerr) 
       {
         etc2+=f*f*(s[j-1]*s[j-1]*esc2[j-1]+sc[j-1]*sc[j-1]*es[j-1]*es[j-1])/
-        (sc[j-1]*sc[j-1]*sc[j-1]*sc[j-1]);
-        double wla1=static_cast<double>(j-1)*cdelt1
-                    +crval1-(crpix1-1.0)*cdelt1;
+        (sc[j-1]*sc[j-1]*sc[j-1]*sc[j-1])*dwpix[j-1]*dwpix[j-1];
+        double wla1=wpix[j-1];
         for (long jj=j1[1]; jj<=j2[1]+1; jj++)
         {
           if (jj != j)
@@ -1267,18 +1496,18 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
               ff=d2[1];
             else
               ff=1.0;
-            double wla2=static_cast<double>(jj-1)*cdelt1
-                        +crval1-(crpix1-1.0)*cdelt1;
+            double wla2=wpix[jj-1];
             double cov=((mwr-wla1)*(mwr-wla2)*esb2+
                         (wla1-mwb)*(wla2-mwb)*esr2)/
                        ((mwr-mwb)*(mwr-mwb));
-            etc2+=ff*f*s[j-1]*s[jj-1]*cov/(sc[j-1]*sc[j-1]*sc[jj-1]*sc[jj-1]);
+            etc2+=ff*f*s[j-1]*s[jj-1]*cov/(sc[j-1]*sc[j-1]*sc[jj-1]*sc[jj-1])*
+                  dwpix[j-1]*dwpix[jj-1];
           }
         }
       }
     }
-    tc*=cdelt1;
-    etc=sqrt(etc2)*cdelt1;
+    tc*=dlambda;
+    etc=sqrt(etc2)*dlambda;
     if (myindex.gettype() == 1) //indice molecular
     {
       if (tc/rl[1] <= 0.0)
@@ -1311,8 +1540,6 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         if(lerr) eindex=etc/rcvel1;
       }
     }
-    delete [] sc;
-    delete [] esc2;
 #ifdef HAVE_CPGPLOT_H
     //=======================================================================
     //dibujamos
@@ -1329,8 +1556,8 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         wdum[1]=(mwr-crval1)/cdelt1+crpix1;
         ydum[1]=sr*smean;
         cpgpt_d(2,wdum,ydum,17);
-        cout << "#Continuum, point #1: " << mwb << ", " << ydum[0] << endl;
-        cout << "#Continuum, point #2: " << mwr << ", " << ydum[1] << endl;
+        out << "#Continuum, point #1: " << mwb << ", " << ydum[0] << endl;
+        out << "#Continuum, point #2: " << mwr << ", " << ydum[1] << endl;
         delete [] wdum;
         delete [] ydum;
       }
@@ -1377,29 +1604,29 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     //protecciones
     if ( contperc >= 0 )
     {
-      cout << "#WARNING: contperc is being implemented for this index"
+      out << "#WARNING: contperc is being implemented for this index"
            << endl;
     }
     if ( boundfit != 0 )
     {
-      cout << "#WARNING: boundfit is being implemented for this index"
+      out << "#WARNING: boundfit is being implemented for this index"
            << endl;
     }
     if ( flattened )
     {
-      cout << "ERROR: flattened has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: flattened has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     //pesos para la discontinuidad
-    double *wl = new double [naxis1];
-    double *wl2 = new double [naxis1];
+    double *wl = workspace.wl;
+    double *wl2 = workspace.wl2;
     if (myindex.gettype() == 3) //D4000
     {
-      //for (long j = j1min; j <= j2max+1; j++)
-      for (long j = 1; j <= naxis1; j++)
+      for (long j = jlo; j <= jhi; j++)
       {
-        double wla=static_cast<double>(j-1)*cdelt1+crval1-(crpix1-1.0)*cdelt1;
+        double wla=wpix[j-1];
         wla/=rcvel1;
         wla/=4000.0;
         wl[j-1] = wla*wla;
@@ -1416,16 +1643,18 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     }
     //-------------------------------------------------------------------------
     //calculamos las integrales
-    double *fx = new double [nbands];
-    double *efx = new double [nbands];
+    double *fx = workspace.fx;
+    double *efx = workspace.efx;
     //.........................................................................
     //boundfit independiente en cada banda
     if (fabs(boundfit) == 1)
     {
       for (long nb=0; nb < nbands; nb++)
       {
-        vector <GenericPixel> fluxpix_band;  //datos a ajustar
-        vector <GenericPixel> boundfit_band; //ajuste a los datos
+        vector <GenericPixel> &fluxpix_band = //datos a ajustar
+          workspace.getpixels(MideWorkspace::fluxpix);
+        vector <GenericPixel> &boundfit_band = //ajuste a los datos
+          workspace.getpixels(MideWorkspace::fitpix);
         for (long j=j1[nb]; j<=j2[nb]+1; j++)
         {
           double f;
@@ -1443,12 +1672,16 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
           temppix.seteflux(0.0);
           boundfit_band.push_back(temppix);
         }
-        vector <GenericPixel> evaluate; //vector de pixeles a evaluar
+        vector <GenericPixel> &evaluate = //vector de pixeles a evaluar
+          workspace.getpixels(MideWorkspace::evalpix);
         //el vector anterior estara vacio en este caso
-        if(!boundaryfit(boundfit,fluxpix_band,lerr,boundfit_band,evaluate))
+        if(!boundaryfit(boundfit,bfitdeg,bfitasym,
+                        fluxpix_band,lerr,boundfit_band,evaluate,
+                        workspace,err))
         {
-          cout << "ERROR: while computing boundary fit in band" << endl;
-          exit(1);
+          err << "ERROR: while computing boundary fit in band" << endl;
+          errcode=INDEXF_FIT_FAILED;
+          return(false);
         }
 #ifdef HAVE_CPGPLOT_H
         //=====================================================================
@@ -1501,8 +1734,10 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     //boundfit con los datos de las dos bandas
     else if (fabs(boundfit) == 2)
     {
-      vector <GenericPixel> fluxpix_all;  //datos a ajustar
-      vector <GenericPixel> boundfit_all; //ajuste a los datos
+      vector <GenericPixel> &fluxpix_all = //datos a ajustar
+        workspace.getpixels(MideWorkspace::fluxpix);
+      vector <GenericPixel> &boundfit_all = //ajuste a los datos
+        workspace.getpixels(MideWorkspace::fitpix);
       for (long nb=0; nb < nbands; nb++)
       {
         for (long j=j1[nb]; j<=j2[nb]+1; j++)
@@ -1526,7 +1761,8 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       for (long nb=0; nb < nbands; nb++)
       {
         GenericPixel evalpix; //pixel puntual a ser evaluado
-        vector <GenericPixel> evaluate; //vector de pixeles a evaluar
+        vector <GenericPixel> &evaluate = //vector de pixeles a evaluar
+          workspace.getpixels(MideWorkspace::evalpix);
         for (long j=j1[nb]; j<=j2[nb]+1; j++)
         {
           /*
@@ -1543,10 +1779,13 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
           evalpix.setwave(wave);
           evaluate.push_back(evalpix);
         }
-        if(!boundaryfit(boundfit,fluxpix_all,lerr,boundfit_all,evaluate))
+        if(!boundaryfit(boundfit,bfitdeg,bfitasym,
+                        fluxpix_all,lerr,boundfit_all,evaluate,
+                        workspace,err))
         {
-          cout << "ERROR: while computing boundary fit in band" << endl;
-          exit(1);
+          err << "ERROR: while computing boundary fit in band" << endl;
+          errcode=INDEXF_FIT_FAILED;
+          return(false);
         }
 #ifdef HAVE_CPGPLOT_H
         //=====================================================================
@@ -1599,8 +1838,10 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     //boundfit con los datos entre la primera y la segunda banda
     else if (fabs(boundfit) == 4)
     {
-      vector <GenericPixel> fluxpix_all;  //datos a ajustar
-      vector <GenericPixel> boundfit_all; //ajuste a los datos
+      vector <GenericPixel> &fluxpix_all = //datos a ajustar
+        workspace.getpixels(MideWorkspace::fluxpix);
+      vector <GenericPixel> &boundfit_all = //ajuste a los datos
+        workspace.getpixels(MideWorkspace::fitpix);
       for (long j=j1[0]; j<=j2[1]+1; j++)
       {
         double f;
@@ -1627,11 +1868,15 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       //=======================================================================
       if (true)
       {
-        vector <GenericPixel> evaluate; //vector de pixeles a evaluar
-        if(!boundaryfit(boundfit,fluxpix_all,lerr,boundfit_all,evaluate))
+        vector <GenericPixel> &evaluate = //vector de pixeles a evaluar
+          workspace.getpixels(MideWorkspace::evalpix);
+        if(!boundaryfit(boundfit,bfitdeg,bfitasym,
+                        fluxpix_all,lerr,boundfit_all,evaluate,
+                        workspace,err))
         {
-          cout << "ERROR: while computing boundary fit in band" << endl;
-          exit(1);
+          err << "ERROR: while computing boundary fit in band" << endl;
+          errcode=INDEXF_FIT_FAILED;
+          return(false);
         }
         //dibujamos boundary fit de la banda considerada
         if((plotmode != 0) && (plottype ==2))
@@ -1657,7 +1902,8 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       for (long nb=0; nb < nbands; nb++)
       {
         GenericPixel evalpix; //pixel puntual a ser evaluado
-        vector <GenericPixel> evaluate; //vector de pixeles a evaluar
+        vector <GenericPixel> &evaluate = //vector de pixeles a evaluar
+          workspace.getpixels(MideWorkspace::evalpix);
         for (long j=j1[nb]; j<=j2[nb]+1; j++)
         {
           /*
@@ -1674,10 +1920,13 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
           evalpix.setwave(wave);
           evaluate.push_back(evalpix);
         }
-        if(!boundaryfit(boundfit,fluxpix_all,lerr,boundfit_all,evaluate))
+        if(!boundaryfit(boundfit,bfitdeg,bfitasym,
+                        fluxpix_all,lerr,boundfit_all,evaluate,
+                        workspace,err))
         {
-          cout << "ERROR: while computing boundary fit in band" << endl;
-          exit(1);
+          err << "ERROR: while computing boundary fit in band" << endl;
+          errcode=INDEXF_FIT_FAILED;
+          return(false);
         }
 #ifdef HAVE_CPGPLOT_H
         //=====================================================================
@@ -1730,9 +1979,10 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     //Valores adicionales de boundfit estan pendientes
     else if (fabs(boundfit) != 0)
     {
-      cout << "ERROR: this value of boundfit is not implemented for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: this value of boundfit is not implemented for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     else if (contperc >= 0) //.................................usamos percentil
     //En este caso, imponemos que el flujo en cada banda sea igual al percentil
@@ -1743,14 +1993,16 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       {
         if (j2[nb]-j1[nb] < 2)
         {
-          cout << "ERROR: number of pixels in bandpass too low "
-               << "to use contperc"
-               << endl;
-          exit(1);
+          err << "ERROR: number of pixels in bandpass too low "
+              << "to use contperc"
+              << endl;
+          errcode=INDEXF_FIT_FAILED;
+          return(false);
         }
         double sdum=0.0;
         double esdum2=0.0;
-        vector <GenericPixel> fluxpix_band;
+        vector <GenericPixel> &fluxpix_band =
+          workspace.getpixels(MideWorkspace::fluxpix);
         for (long j=j1[nb]; j<=j2[nb]+1; j++)
         {
           double f;
@@ -1765,10 +2017,12 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
           GenericPixel temppix(wave,s[j-1],es[j-1],f);
           fluxpix_band.push_back(temppix);
         }
-        if(!fpercent(fluxpix_band,contperc,lerr,&sdum,&esdum2))
+        if(!fpercent(fluxpix_band,contperc,lerr,simtol,rstream,
+                     &sdum,&esdum2,workspace,err))
         {
-          cout << "ERROR: while computing percentile" << endl;
-          exit(1);
+          err << "ERROR: while computing percentile" << endl;
+          errcode=INDEXF_FIT_FAILED;
+          return(false);
         }
 #ifdef HAVE_CPGPLOT_H
         //=====================================================================
@@ -1799,6 +2053,32 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         if(lerr) efx[nb]=etc;
       }
     }
+    else if (lcumflux) //......................metodo clasico (flujo acumulado)
+    {
+      //los pesos de la D4000 son (lambda/rcvel1/4000)^2; en el resto de los
+      //casos los pesos son iguales a 1
+      double wlnorm2=1.0;
+      if (myindex.gettype() == 3)
+      {
+        wlnorm2=(rcvel1*4000.0)*(rcvel1*4000.0);
+      }
+      for (long nb=0; nb < nbands; nb++)
+      {
+        if (myindex.gettype() == 3)
+        {
+          fx[nb]=cumflux->getsumflux_l2(j1[nb],j2[nb],d1[nb],d2[nb])/
+                 (smean*wlnorm2);
+          if(lerr) efx[nb]=cumflux->getsumvar_l4(j1[nb],j2[nb],d1[nb],d2[nb])/
+                           (smean*smean*wlnorm2*wlnorm2);
+        }
+        else
+        {
+          fx[nb]=cumflux->getsumflux(j1[nb],j2[nb],d1[nb],d2[nb])/smean;
+          if(lerr) efx[nb]=cumflux->getsumvar(j1[nb],j2[nb],d1[nb],d2[nb])/
+                           (smean*smean);
+        }
+      }
+    }
     else //...............................................usamos metodo clasico
     {
       for (long nb=0; nb < nbands; nb++)
@@ -1814,8 +2094,8 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
             f=d2[nb];
           else
             f=1.0;
-          tc+=f*s[j-1]*wl[j-1];
-          if(lerr) etc+=f*f*es[j-1]*es[j-1]*wl2[j-1];
+          tc+=f*s[j-1]*wl[j-1]*dwpix[j-1];
+          if(lerr) etc+=f*f*es[j-1]*es[j-1]*wl2[j-1]*dwpix[j-1]*dwpix[j-1];
         }
         fx[nb]=tc;
         if(lerr) efx[nb]=etc;
@@ -1842,10 +2122,6 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       }
       findex=2.5*log10(findex);
     }
-    delete [] wl;
-    delete [] wl2;
-    delete [] fx;
-    delete [] efx;
     // generate output for pyindexf
     if(pyindexf)
     {
@@ -1861,8 +2137,15 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         sr +=s[j-1];
       }
       sr /= static_cast<double>(j2[1]-j1[1]+2);
-      cout << "python> {'f_mean_blue': " << sb*smean << ", "
-           <<          "'f_mean_red': "  << sr*smean << "}" << endl;
+      if (pybinary != NULL)
+      {
+        pybinary->add(PyBinary::fmean,0,0,sb*smean,sr*smean);
+      }
+      else
+      {
+        out << "python> {'f_mean_blue': " << sb*smean << ", "
+             <<          "'f_mean_red': "  << sr*smean << "}" << endl;
+      }
     }
 #ifdef HAVE_CPGPLOT_H
     //=========================================================================
@@ -1927,21 +2210,24 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     //protecciones
     if ( contperc >= 0 )
     {
-      cout << "ERROR: contperc has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: contperc has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     if ( boundfit != 0 )
     {
-      cout << "ERROR: boundfit has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: boundfit has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     if ( flattened )
     {
-      cout << "ERROR: flattened has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: flattened has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     //si no hay errores, hacemos todos iguales a uno para utilizar las mismas
     //formulas
@@ -1973,10 +2259,10 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
             f=1.0;
           sigma2=es[j-1]*es[j-1];
           sum0+=f/sigma2;
-          sumx+=f*static_cast<double>(j)/sigma2;
+          sumx+=f*xpix[j-1]/sigma2;
           sumy+=f*s[j-1]/sigma2;
-          sumxy+=f*static_cast<double>(j)*s[j-1]/sigma2;
-          sumxx+=f*static_cast<double>(j)*static_cast<double>(j)/sigma2;
+          sumxy+=f*xpix[j-1]*s[j-1]/sigma2;
+          sumxx+=f*xpix[j-1]*xpix[j-1]/sigma2;
         }
       }
     }
@@ -1984,18 +2270,26 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     double amc=(sum0*sumxy-sumx*sumy)/deter;
     double bmc=(sumxx*sumy-sumx*sumxy)/deter;
     //calculamos el pseudo-continuo
-    double *sc = new double [naxis1];
-    double *esc2 = new double [naxis1];
+    double *sc = workspace.sc;
+    double *esc2 = workspace.esc2;
     for (long j = j1min; j <= j2max+1; j++)
     {
-      sc[j-1] = amc*static_cast<double>(j)+bmc;
+      sc[j-1] = amc*xpix[j-1]+bmc;
     }
     // generate output for pyindexf
     if(pyindexf)
     {
-      cout << "python> {'f_cont_bluest': " << sc[j1min-1]*smean << ", "
-           <<          "'f_cont_reddest': "  << sc[j2max]*smean << "}"
-           << endl;
+      if (pybinary != NULL)
+      {
+        pybinary->add(PyBinary::fcontedges,0,0,
+                      sc[j1min-1]*smean,sc[j2max]*smean);
+      }
+      else
+      {
+        out << "python> {'f_cont_bluest': " << sc[j1min-1]*smean << ", "
+             <<          "'f_cont_reddest': "  << sc[j2max]*smean << "}"
+             << endl;
+      }
     }
 #ifdef HAVE_CPGPLOT_H
     //=======================================================================
@@ -2008,7 +2302,7 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       for (long j = j1min; j <= j2max+1; j++)
       {
         fdum = sc[j-1]*smean;
-        cpgdraw_d(static_cast<double>(j),fdum);
+        cpgdraw_d(xpix[j-1],fdum);
       }
       cpgsci(1);
     }
@@ -2027,10 +2321,10 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
             for (long jj=j1[nb]; jj<=j2[nb]+1; jj++)
             {
               sigma2=es[jj-1]*es[jj-1];
-              double fdum=(sum0*static_cast<double>(jj)/sigma2-sumx/sigma2)*
-                          static_cast<double>(j)/deter+
+              double fdum=(sum0*xpix[jj-1]/sigma2-sumx/sigma2)*
+                          xpix[j-1]/deter+
                           (sumxx/sigma2-
-                           sumx*static_cast<double>(jj)/sigma2)/deter;
+                           sumx*xpix[jj-1]/sigma2)/deter;
               esc2[j-1]+=fdum*fdum*sigma2;
             }
           }
@@ -2048,7 +2342,7 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         for (long j = j1min; j <= j2max+1; j++)
         {
           fdum = (sc[j-1]+sqrt(esc2[j-1]))*smean;
-          cpgdraw_d(static_cast<double>(j),fdum);
+          cpgdraw_d(xpix[j-1],fdum);
         }
         //error inferior
         fdum = (sc[j1min-1]-sqrt(esc2[j1min-1]))*smean;
@@ -2056,7 +2350,7 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         for (long j = j1min; j <= j2max+1; j++)
         {
           fdum = (sc[j-1]-sqrt(esc2[j-1]))*smean;
-          cpgdraw_d(static_cast<double>(j),fdum);
+          cpgdraw_d(xpix[j-1],fdum);
         }
         cpgsci(1);
       }
@@ -2080,8 +2374,8 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
             f=d2[nb];
           else
             f=1.0;
-          sumli+=f*static_cast<double>(j);
-          sumni+=f;
+          sumli+=f*xpix[j-1]*dwpix[j-1];
+          sumni+=f*dwpix[j-1];
         }
       }
     }
@@ -2102,11 +2396,11 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
             f=d2[nb];
           else
             f=1.0;
-          findex+=f*(s[j-1]-sc[j-1]);
+          findex+=f*(s[j-1]-sc[j-1])*dwpix[j-1];
           if(lerr)
           {
             //eindex+=f*f*(es[j-1]*es[j-1]+esc2[j-1]);
-            eindex+=f*f*es[j-1]*es[j-1];
+            eindex+=f*f*es[j-1]*es[j-1]*dwpix[j-1]*dwpix[j-1];
           }
         }
       }
@@ -2124,9 +2418,9 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
             else
               f=1.0;
             sigma2=es[jj-1]*es[jj-1];
-            double fduma=(sum0*static_cast<double>(jj)/sigma2-sumx/sigma2)
+            double fduma=(sum0*xpix[jj-1]/sigma2-sumx/sigma2)
                          /deter;
-            double fdumb=(sumxx/sigma2-sumx*static_cast<double>(jj)/sigma2)
+            double fdumb=(sumxx/sigma2-sumx*xpix[jj-1]/sigma2)
                          /deter;
             double fdum=sumli*fduma+sumni*fdumb;
             eindex+=f*f*fdum*fdum*sigma2;
@@ -2134,14 +2428,12 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
         }
       }
     }
-    findex=findex*cdelt1*smean;
-    eindex=sqrt(eindex)*cdelt1*smean;
+    findex=findex*dlambda*smean;
+    eindex=sqrt(eindex)*dlambda*smean;
     if(logindex)
     {
       //no tiene sentido
     }
-    delete [] sc;
-    delete [] esc2;
   }
   //***************************************************************************
   //Discontinuidades genericas
@@ -2151,21 +2443,24 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     //protecciones
     if ( contperc >= 0 )
     {
-      cout << "ERROR: contperc has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: contperc has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     if ( boundfit != 0 )
     {
-      cout << "ERROR: boundfit has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: boundfit has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     if ( flattened )
     {
-      cout << "ERROR: flattened has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: flattened has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     long nconti = myindex.getnconti();
     long nlines = myindex.getnlines();
@@ -2175,25 +2470,34 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     double rltot_conti=0.0;
     for (long nb=0; nb < nconti; nb++)
     {
-      for (long j=j1[nb]; j<=j2[nb]+1; j++)
+      if (lcumflux)
       {
-        double f;
-        if (j == j1[nb])
-          f=1.0-d1[nb];
-        else if (j == j2[nb]+1)
-          f=d2[nb];
-        else
-          f=1.0;
-        fconti+=f*s[j-1];
-        if(lerr) econti2+=f*f*es[j-1]*es[j-1];
+        fconti+=cumflux->getsumflux(j1[nb],j2[nb],d1[nb],d2[nb])/smean;
+        if(lerr) econti2+=cumflux->getsumvar(j1[nb],j2[nb],d1[nb],d2[nb])/
+                          (smean*smean);
+      }
+      else
+      {
+        for (long j=j1[nb]; j<=j2[nb]+1; j++)
+        {
+          double f;
+          if (j == j1[nb])
+            f=1.0-d1[nb];
+          else if (j == j2[nb]+1)
+            f=d2[nb];
+          else
+            f=1.0;
+          fconti+=f*s[j-1]*dwpix[j-1];
+          if(lerr) econti2+=f*f*es[j-1]*es[j-1]*dwpix[j-1]*dwpix[j-1];
+        }
       }
       rltot_conti+=rl[nb];
     }
-    fconti*=cdelt1;
+    fconti*=dlambda;
     fconti/=rltot_conti;
     if(lerr)
     {
-      econti2*=cdelt1*cdelt1;
+      econti2*=dlambda*dlambda;
       econti2/=(rltot_conti*rltot_conti);
     }
     //calculamos flujo promedio en las bandas de absorcion
@@ -2202,25 +2506,35 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     double rltot_lines=0.0;
     for (long nb=0; nb < nlines; nb++)
     {
-      for (long j=j1[nconti+nb]; j<=j2[nconti+nb]+1; j++)
+      const long nbb=nconti+nb;
+      if (lcumflux)
       {
-        double f;
-        if (j == j1[nconti+nb])
-          f=1.0-d1[nconti+nb];
-        else if (j == j2[nconti+nb]+1)
-          f=d2[nconti+nb];
-        else
-          f=1.0;
-        flines+=f*s[j-1];
-        if(lerr) elines2+=f*f*es[j-1]*es[j-1];
+        flines+=cumflux->getsumflux(j1[nbb],j2[nbb],d1[nbb],d2[nbb])/smean;
+        if(lerr) elines2+=cumflux->getsumvar(j1[nbb],j2[nbb],d1[nbb],d2[nbb])/
+                          (smean*smean);
       }
-      rltot_lines+=rl[nconti+nb];
+      else
+      {
+        for (long j=j1[nbb]; j<=j2[nbb]+1; j++)
+        {
+          double f;
+          if (j == j1[nbb])
+            f=1.0-d1[nbb];
+          else if (j == j2[nbb]+1)
+            f=d2[nbb];
+          else
+            f=1.0;
+          flines+=f*s[j-1]*dwpix[j-1];
+          if(lerr) elines2+=f*f*es[j-1]*es[j-1]*dwpix[j-1]*dwpix[j-1];
+        }
+      }
+      rltot_lines+=rl[nbb];
     }
-    flines*=cdelt1;
+    flines*=dlambda;
     flines/=rltot_lines;
     if(lerr)
     {
-      elines2*=cdelt1*cdelt1;
+      elines2*=dlambda*dlambda;
       elines2/=(rltot_lines*rltot_lines);
     }
     //calculamos el indice
@@ -2244,9 +2558,17 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     // generate output for pyindexf
     if(pyindexf)
     {
-      cout << "python> {'f_mean_denominator': " << fconti*smean << ", "
-           <<          "'f_mean_numerator': "  << flines*smean << "}"
-           << endl;
+      if (pybinary != NULL)
+      {
+        pybinary->add(PyBinary::fmeanratio,0,0,
+                      fconti*smean,flines*smean);
+      }
+      else
+      {
+        out << "python> {'f_mean_denominator': " << fconti*smean << ", "
+             <<          "'f_mean_numerator': "  << flines*smean << "}"
+             << endl;
+      }
     }
 #ifdef HAVE_CPGPLOT_H
     //=========================================================================
@@ -2300,21 +2622,24 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     //protecciones
     if ( contperc >= 0 )
     {
-      cout << "ERROR: contperc has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: contperc has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     if ( boundfit != 0 )
     {
-      cout << "ERROR: boundfit has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: boundfit has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     if ( flattened )
     {
-      cout << "ERROR: flattened has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: flattened has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     long nconti = myindex.getnconti();
     long nlines = myindex.getnlines();
@@ -2345,21 +2670,21 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
           f=1.0;
         sigma2=es[j-1]*es[j-1];
         sum0+=f/sigma2;
-        sumx+=f*static_cast<double>(j)/sigma2;
+        sumx+=f*xpix[j-1]/sigma2;
         sumy+=f*s[j-1]/sigma2;
-        sumxy+=f*static_cast<double>(j)*s[j-1]/sigma2;
-        sumxx+=f*static_cast<double>(j)*static_cast<double>(j)/sigma2;
+        sumxy+=f*xpix[j-1]*s[j-1]/sigma2;
+        sumxx+=f*xpix[j-1]*xpix[j-1]/sigma2;
       }
     }
     double deter=sum0*sumxx-sumx*sumx;
     double amc=(sum0*sumxy-sumx*sumy)/deter;
     double bmc=(sumxx*sumy-sumx*sumxy)/deter;
     //calculamos el pseudo-continuo
-    double *sc = new double [naxis1];
-    double *esc2 = new double [naxis1];
+    double *sc = workspace.sc;
+    double *esc2 = workspace.esc2;
     for (long j = j1min; j <= j2max+1; j++)
     {
-      sc[j-1] = amc*static_cast<double>(j)+bmc;
+      sc[j-1] = amc*xpix[j-1]+bmc;
     }
     if(lerr)
     {
@@ -2371,10 +2696,10 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
           for (long jj=j1[nb]; jj<=j2[nb]+1; jj++)
           {
             sigma2=es[jj-1]*es[jj-1];
-            double fdum=(sum0*static_cast<double>(jj)/sigma2-sumx/sigma2)*
-                        static_cast<double>(j)/deter+
+            double fdum=(sum0*xpix[jj-1]/sigma2-sumx/sigma2)*
+                        xpix[j-1]/deter+
                         (sumxx/sigma2-
-                         sumx*static_cast<double>(jj)/sigma2)/deter;
+                         sumx*xpix[jj-1]/sigma2)/deter;
             esc2[j-1]+=fdum*fdum*sigma2;
           }
         }
@@ -2396,12 +2721,12 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
           f=d2[nb+nconti];
         else
           f=1.0;
-        tc+=f*factor*s[j-1]/sc[j-1];
+        tc+=f*factor*s[j-1]/sc[j-1]*dwpix[j-1];
         if(lerr)
         {
           etc+=f*f*factor*factor*(s[j-1]*s[j-1]*esc2[j-1]+
                sc[j-1]*sc[j-1]*es[j-1]*es[j-1])/
-               (sc[j-1]*sc[j-1]*sc[j-1]*sc[j-1]);
+               (sc[j-1]*sc[j-1]*sc[j-1]*sc[j-1])*dwpix[j-1]*dwpix[j-1];
           for (long nbb=0; nbb < nlines; nbb++)
           {
             double factorr = myindex.getfactor(nbb);
@@ -2416,13 +2741,14 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
                   ff=d2[nbb+nconti];
                 else
                   ff=1.0;
-                double cov=static_cast<double>(j)*static_cast<double>(jj)*
+                double cov=xpix[j-1]*xpix[jj-1]*
                            (sum0*sum0*sumxx-sum0*sumx*sumx)/(deter*deter)+
-                           (static_cast<double>(j)+static_cast<double>(jj))*
+                           (xpix[j-1]+xpix[jj-1])*
                            (sumx*sumx*sumx-sum0*sumx*sumxx)/(deter*deter)+
                            (sumxx*sumxx*sum0-sumxx*sumx*sumx)/(deter*deter);
                 etc+=factor*factorr*ff*f*s[j-1]*s[jj-1]*cov/
-                     (sc[j-1]*sc[j-1]*sc[j-1]*sc[j-1]);
+                     (sc[j-1]*sc[j-1]*sc[j-1]*sc[j-1])*
+                     dwpix[j-1]*dwpix[jj-1];
               }
             }
           }
@@ -2432,35 +2758,47 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     }
     if(logindex) //indice generico medido en magnitudes
     {
-      if (tc*cdelt1/sumrl <= 0.0)
+      if (tc*dlambda/sumrl <= 0.0)
       {
         log_negative=true;
         findex=0.0;
         eindex=0.0;
         return(false);
       }
-      findex=-2.5*log10(tc*cdelt1/sumrl);
-      if(lerr) eindex=cte_log_exp/pow(10,-0.4*findex)*sqrt(etc)*cdelt1/sumrl;
+      findex=-2.5*log10(tc*dlambda/sumrl);
+      if(lerr) eindex=cte_log_exp/pow(10,-0.4*findex)*sqrt(etc)*dlambda/sumrl;
     }
     else //indice generico medido como indice atomico
     {
-      findex=(sumrl-tc*cdelt1)/rcvel1;
-      if(lerr) eindex=sqrt(etc)*cdelt1/rcvel1;
+      findex=(sumrl-tc*dlambda)/rcvel1;
+      if(lerr) eindex=sqrt(etc)*dlambda/rcvel1;
     }
-    delete [] sc;
-    delete [] esc2;
     if(pyindexf)
     {
       const double wla=wvmin*rcvel1;
       const double wlb=wvmax*rcvel1;
-      const double xca=(wla-crval1)/cdelt1+crpix1;
-      const double xcb=(wlb-crval1)/cdelt1+crpix1;
+      const double xca=(wla-wxref)/wxstep+wxpix;
+      const double xcb=(wlb-wxref)/wxstep+wxpix;
       const double yduma=amc*static_cast<double>(xca)+bmc;
       const double ydumb=amc*static_cast<double>(xcb)+bmc;
-      cout << "python> {'w_min_cont': " << wla << ", "
-                       "'w_max_cont': " << wlb << "}" << endl;
-      cout << "python> {'f_min_cont': " << yduma*smean << ", "
-                       "'f_max_cont': " << ydumb*smean << "}" << endl;
+      if (pybinary != NULL)
+      {
+        pybinary->add(PyBinary::wcont,0,0,wla,wlb);
+      }
+      else
+      {
+        out << "python> {'w_min_cont': " << wla << ", "
+                         "'w_max_cont': " << wlb << "}" << endl;
+      }
+      if (pybinary != NULL)
+      {
+        pybinary->add(PyBinary::fcont,0,0,yduma*smean,ydumb*smean);
+      }
+      else
+      {
+        out << "python> {'f_min_cont': " << yduma*smean << ", "
+                         "'f_max_cont': " << ydumb*smean << "}" << endl;
+      }
     }
 #ifdef HAVE_CPGPLOT_H
     //=========================================================================
@@ -2470,8 +2808,8 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       cpgsci(6);
       const double wla=wvmin*rcvel1;
       const double wlb=wvmax*rcvel1;
-      const double xca=(wla-crval1)/cdelt1+crpix1;
-      const double xcb=(wlb-crval1)/cdelt1+crpix1;
+      const double xca=(wla-wxref)/wxstep+wxpix;
+      const double xcb=(wlb-wxref)/wxstep+wxpix;
       const double yduma=amc*static_cast<double>(xca)+bmc;
       const double ydumb=amc*static_cast<double>(xcb)+bmc;
       cpgmove_d(xca,yduma*smean);
@@ -2488,21 +2826,24 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     //protecciones
     if ( contperc >= 0 )
     {
-      cout << "ERROR: contperc has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: contperc has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     if ( boundfit != 0 )
     {
-      cout << "ERROR: boundfit has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: boundfit has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     if ( flattened )
     {
-      cout << "ERROR: flattened has not been implemented yet for this index"
-           << endl;
-      exit(1);
+      err << "ERROR: flattened has not been implemented yet for this index"
+          << endl;
+      errcode=INDEXF_NOT_IMPLEMENTED;
+      return(false);
     }
     long nconti = myindex.getnconti();
     //si no hay errores, hacemos todos iguales a uno para utilizar las mismas
@@ -2532,10 +2873,10 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
           f=1.0;
         sigma2=es[j-1]*es[j-1];
         sum0+=f/sigma2;
-        sumx+=f*static_cast<double>(j)/sigma2;
+        sumx+=f*xpix[j-1]/sigma2;
         sumy+=f*s[j-1]/sigma2;
-        sumxy+=f*static_cast<double>(j)*s[j-1]/sigma2;
-        sumxx+=f*static_cast<double>(j)*static_cast<double>(j)/sigma2;
+        sumxy+=f*xpix[j-1]*s[j-1]/sigma2;
+        sumxx+=f*xpix[j-1]*xpix[j-1]/sigma2;
       }
     }
     double deter=sum0*sumxx-sumx*sumx;
@@ -2548,6 +2889,11 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       double cb = myindex.getldo2(nb)*rcvel1;
       double c3 = (ca-wlmin)/cdelt1+1.0;
       double c4 = (cb-wlmin)/cdelt1;
+      if (lognative) //solo se emplea el punto medio (c3+c4)/2
+      {
+        c3 = (ca-wxref)/wxstep+wxpix;
+        c4 = (cb-wxref)/wxstep+wxpix;
+      }
       if (nb==0)
       {
         xa=(c3+c4)/2.0;
@@ -2589,14 +2935,28 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
     {
       const double wla=wvmin*rcvel1;
       const double wlb=wvmax*rcvel1;
-      const double xca=(wla-crval1)/cdelt1+crpix1;
-      const double xcb=(wlb-crval1)/cdelt1+crpix1;
+      const double xca=(wla-wxref)/wxstep+wxpix;
+      const double xcb=(wlb-wxref)/wxstep+wxpix;
       const double yduma=amc*static_cast<double>(xca)+bmc;
       const double ydumb=amc*static_cast<double>(xcb)+bmc;
-      cout << "python> {'w_min_cont': " << wla << ", "
-                       "'w_max_cont': " << wlb << "}" << endl;
-      cout << "python> {'f_min_cont': " << yduma*smean << ", "
-                       "'f_max_cont': " << ydumb*smean << "}" << endl;
+      if (pybinary != NULL)
+      {
+        pybinary->add(PyBinary::wcont,0,0,wla,wlb);
+      }
+      else
+      {
+        out << "python> {'w_min_cont': " << wla << ", "
+                         "'w_max_cont': " << wlb << "}" << endl;
+      }
+      if (pybinary != NULL)
+      {
+        pybinary->add(PyBinary::fcont,0,0,yduma*smean,ydumb*smean);
+      }
+      else
+      {
+        out << "python> {'f_min_cont': " << yduma*smean << ", "
+                         "'f_max_cont': " << ydumb*smean << "}" << endl;
+      }
     }
 #ifdef HAVE_CPGPLOT_H
     //=========================================================================
@@ -2606,8 +2966,8 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
       cpgsci(6);
       const double wla=wvmin*rcvel1;
       const double wlb=wvmax*rcvel1;
-      const double xca=(wla-crval1)/cdelt1+crpix1;
-      const double xcb=(wlb-crval1)/cdelt1+crpix1;
+      const double xca=(wla-wxref)/wxstep+wxpix;
+      const double xcb=(wlb-wxref)/wxstep+wxpix;
       const double yduma=amc*static_cast<double>(xca)+bmc; 
       const double ydumb=amc*static_cast<double>(xcb)+bmc; 
       cpgmove_d(xca,yduma*smean);
@@ -2621,25 +2981,13 @@ bool mideindex(const bool &lerr, const double *sp_data, const double *sp_error,
   //***************************************************************************
   else
   {
-    cout << "FATAL ERROR: index type=" << myindex.gettype()
-         << " is not valid" << endl;
-    exit(1);
+    err << "FATAL ERROR: index type=" << myindex.gettype()
+        << " is not valid" << endl;
+    errcode=INDEXF_INVALID_INDEX;
+    return(false);
   }
 
   //---------------------------------------------------------------------------
-  //liberamos memoria y retornamos con exito
-  delete [] ca;
-  delete [] cb;
-  delete [] c3;
-  delete [] c4;
-  delete [] j1;
-  delete [] j2;
-  delete [] d1;
-  delete [] d2;
-  delete [] rl;
-  delete [] rg;
-  delete [] ifchan;
-  delete [] s;
-  delete [] es;
+  //retornamos con exito (la memoria de trabajo pertenece a workspace)
   return(true);
 }
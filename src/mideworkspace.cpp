@@ -0,0 +1,138 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+//Definicion de funciones miembro de la clase MideWorkspace, declarada en 
+//mideworkspace.h
+#include <cstddef>
+#include "mideworkspace.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//constructor: no se reserva memoria hasta la primera llamada a reserve()
+MideWorkspace::MideWorkspace()
+{
+  nbands_max=0;
+  naxis1_max=0;
+  ca=cb=c3=c4=NULL;
+  j1=j2=NULL;
+  d1=d2=rl=rg=NULL;
+  fx=efx=NULL;
+  ifchan=NULL;
+  s=es=sc=esc2=wl=wl2=NULL;
+  wpix=dwpix=xpix=NULL;
+}
+
+//-----------------------------------------------------------------------------
+//destructor
+MideWorkspace::~MideWorkspace()
+{
+  delete [] ca;
+  delete [] cb;
+  delete [] c3;
+  delete [] c4;
+  delete [] j1;
+  delete [] j2;
+  delete [] d1;
+  delete [] d2;
+  delete [] rl;
+  delete [] rg;
+  delete [] fx;
+  delete [] efx;
+  delete [] ifchan;
+  delete [] s;
+  delete [] es;
+  delete [] sc;
+  delete [] esc2;
+  delete [] wl;
+  delete [] wl2;
+  delete [] wpix;
+  delete [] dwpix;
+  delete [] xpix;
+}
+
+//-----------------------------------------------------------------------------
+//garantiza que los vectores tienen al menos nbands y naxis1 elementos; solo
+//se reserva memoria nueva cuando alguna de las dimensiones aumenta
+void MideWorkspace::reserve(const long nbands, const long naxis1)
+{
+  if (nbands > nbands_max)
+  {
+    delete [] ca;
+    delete [] cb;
+    delete [] c3;
+    delete [] c4;
+    delete [] j1;
+    delete [] j2;
+    delete [] d1;
+    delete [] d2;
+    delete [] rl;
+    delete [] rg;
+    delete [] fx;
+    delete [] efx;
+    ca = new double [nbands];
+    cb = new double [nbands];
+    c3 = new double [nbands];
+    c4 = new double [nbands];
+    j1 = new long [nbands];
+    j2 = new long [nbands];
+    d1 = new double [nbands];
+    d2 = new double [nbands];
+    rl = new double [nbands];
+    rg = new double [nbands];
+    fx = new double [nbands];
+    efx = new double [nbands];
+    nbands_max=nbands;
+  }
+  if (naxis1 > naxis1_max)
+  {
+    delete [] ifchan;
+    delete [] s;
+    delete [] es;
+    delete [] sc;
+    delete [] esc2;
+    delete [] wl;
+    delete [] wl2;
+    delete [] wpix;
+    delete [] dwpix;
+    delete [] xpix;
+    ifchan = new bool [naxis1];
+    s = new double [naxis1];
+    es = new double [naxis1];
+    sc = new double [naxis1];
+    esc2 = new double [naxis1];
+    wl = new double [naxis1];
+    wl2 = new double [naxis1];
+    wpix = new double [naxis1];
+    dwpix = new double [naxis1];
+    xpix = new double [naxis1];
+    naxis1_max=naxis1;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//devuelve el vector de pixeles n-esimo vacio; clear() no libera la memoria,
+//por lo que los push_back posteriores no reservan memoria salvo que el
+//vector necesite crecer
+vector <GenericPixel> &MideWorkspace::getpixels(const long n)
+{
+  pixels[n].clear();
+  return(pixels[n]);
+}
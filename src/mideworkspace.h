@@ -0,0 +1,75 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+//Declaracion de la clase MideWorkspace
+//Las funciones miembro se definen en mideworkspace.cpp
+
+#ifndef MIDEWORKSPACE_H
+#define MIDEWORKSPACE_H
+
+#include <vector>
+#include "genericpixel.h"
+
+//Vectores de trabajo de mideindex. Cada hilo de medida mantiene un unico
+//objeto de esta clase, de modo que la memoria se reserva una sola vez (al
+//medir el primer indice de cada numero de bandas y longitud de espectro) y
+//se reutiliza en todas las llamadas posteriores a mideindex, incluidas las
+//simulaciones numericas. Los vectores son publicos porque se trata 
+//unicamente de memoria de trabajo, cuyo contenido no se conserva entre 
+//llamadas.
+class MideWorkspace{
+  public:
+    MideWorkspace();
+    ~MideWorkspace();
+    //garantiza espacio para el numero de bandas y NAXIS1 indicados
+    void reserve(const long, const long);
+    //vector de pixeles vacio (manteniendo la memoria ya reservada)
+    std::vector <GenericPixel> &getpixels(const long);
+    //dimension nbands
+    double *ca, *cb, *c3, *c4;
+    long *j1, *j2;
+    double *d1, *d2, *rl, *rg;
+    double *fx, *efx;
+    //dimension NAXIS1
+    bool *ifchan;
+    double *s, *es;
+    double *sc, *esc2;
+    double *wl, *wl2;
+    double *wpix, *dwpix, *xpix;
+    //boundaryfit y fpercent (se redimensionan en cada llamada; la memoria
+    //solo se reserva cuando aumenta el numero de pixeles o de parametros)
+    std::vector <double> bfweight, bfphi, bfcoeff, bfamat, bfbvec, bfyfit;
+    std::vector <double> bfphi_eval;
+    std::vector <bool> bfabove;
+    std::vector <GenericPixel> fpsimulated;
+    std::vector <double> fpsorted, fpsn, fppn, fpsimul;
+    //identificadores de los vectores de pixeles
+    static const long fluxpix = 0;  //datos a ajustar
+    static const long fitpix = 1;   //ajuste a los datos
+    static const long evalpix = 2;  //pixeles a evaluar
+  private:
+    MideWorkspace(const MideWorkspace &);
+    MideWorkspace & operator = (const MideWorkspace &);
+    long nbands_max;
+    long naxis1_max;
+    std::vector <GenericPixel> pixels[3];
+};
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+//Definicion de funciones miembro de la clase PyBinary, declarada en 
+//pybinary.h
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include "pybinary.h"
+
+using namespace std;
+
+//formato de cada registro
+struct PyBinaryRecord
+{
+  int32_t type;
+  int32_t ns;
+  int32_t band;
+  int32_t flags;
+  double v1;
+  double v2;
+};
+
+//-----------------------------------------------------------------------------
+//constructor
+PyBinary::PyBinary()
+{
+  ns=0;
+}
+
+//-----------------------------------------------------------------------------
+void PyBinary::setspectrum(const long ns_)
+{
+  ns=ns_;
+}
+
+//-----------------------------------------------------------------------------
+void PyBinary::add(const long type, const long band, const long flags,
+                   const double v1, const double v2)
+{
+  PyBinaryRecord record;
+  record.type = static_cast<int32_t>(type);
+  record.ns = static_cast<int32_t>(ns);
+  record.band = static_cast<int32_t>(band);
+  record.flags = static_cast<int32_t>(flags);
+  record.v1 = v1;
+  record.v2 = v2;
+  buffer.append(reinterpret_cast<const char *>(&record),sizeof(record));
+}
+
+//-----------------------------------------------------------------------------
+string &PyBinary::getbuffer()
+{
+  return(buffer);
+}
+
+//-----------------------------------------------------------------------------
+bool PyBinary::flush(const int fd)
+{
+  const bool lok = write(fd,buffer);
+  buffer.clear();
+  return(lok);
+}
+
+//-----------------------------------------------------------------------------
+//write() puede escribir solo parte de los datos (p.ej. en una tuberia), por
+//lo que se repite hasta completar el buffer
+bool PyBinary::write(const int fd, const string &data)
+{
+  const char *dataPtr = data.data();
+  size_t nleft = data.size();
+  while (nleft > 0)
+  {
+    const ssize_t n = ::write(fd,dataPtr,nleft);
+    if (n < 0)
+    {
+      if (errno == EINTR) continue;
+      return(false);
+    }
+    dataPtr += n;
+    nleft -= static_cast<size_t>(n);
+  }
+  return(true);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+//Declaracion de la clase PyBinary
+//Las funciones miembro se definen en pybinary.cpp
+
+#ifndef PYBINARY_H
+#define PYBINARY_H
+
+#include <string>
+
+//Registros binarios para pyindexf (keyword pybinfd). Contienen la misma
+//informacion que las lineas "python> {...}" de la salida en modo texto,
+//pero sin necesidad de formatear ni interpretar cadenas de caracteres.
+//Cada registro ocupa 32 bytes (en el orden de bytes de la maquina):
+//  int32 tipo, int32 numero de espectro, int32 banda (1..nbands, o 0),
+//  int32 flags, double v1, double v2
+//de forma que, desde python, basta con
+//  numpy.dtype([('type','i4'),('ns','i4'),('band','i4'),('flags','i4'),
+//               ('v1','f8'),('v2','f8')])
+//Los registros se acumulan en memoria y se escriben con flush().
+class PyBinary{
+  public:
+    PyBinary();
+    //espectro al que se refieren los registros siguientes
+    void setspectrum(const long);
+    //anade un registro (tipo, banda, flags, v1, v2)
+    void add(const long, const long, const long,
+             const double, const double = 0.0);
+    //registros pendientes (permite trasladarlos a otro buffer)
+    std::string &getbuffer();
+    //escribe los registros pendientes en el descriptor indicado
+    bool flush(const int);
+    //escribe un buffer completo en el descriptor indicado
+    static bool write(const int, const std::string &);
+    //tipos de registro: entre parentesis, el contenido de v1 y v2
+    static const long index = 1;        //(indextype, nbands); flags=nconti
+    static const long wband = 2;        //(w_ini, w_end)
+    static const long factor = 3;       //(factor)
+    static const long meansn = 4;       //(meansn)
+    static const long biaserrfactor = 5;//(biaserrfactor)
+    static const long wcenter = 6;      //(w_blue_center, w_red_center)
+    static const long fcenter = 7;      //(f_blue_center, f_red_center)
+    static const long fmean = 8;        //(f_mean_blue, f_mean_red)
+    static const long fcontedges = 9;   //(f_cont_bluest, f_cont_reddest)
+    static const long fmeanratio = 10;  //(f_mean_denominator,
+                                        // f_mean_numerator)
+    static const long wcont = 11;       //(w_min_cont, w_max_cont)
+    static const long fcont = 12;       //(f_min_cont, f_max_cont)
+    static const long measurement = 13; //(findex, eindex); flags: ver abajo
+    static const long sn = 14;          //(sn)
+    //flags del registro measurement
+    static const long measured = 1;
+    static const long out_of_limits = 2;
+    static const long negative_error = 4;
+    static const long log_negative = 8;
+  private:
+    long ns;
+    std::string buffer;
+};
+
+#endif
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+//Definicion de funciones miembro de la clase RandomStream, declarada en 
+//randomstream.h
+#include <cmath>
+#include "randomstream.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//constructor: la semilla actua como clave y el resto de parametros fijan
+//la posicion inicial del contador
+RandomStream::RandomStream(const uint64_t seed, const long type,
+                           const long ns, const long nsimulsn,
+                           const long nsimul, const long mode_)
+{
+  mode=mode_;
+  sign=1.0;
+  nquasi=0;
+  //numero de simulacion que determina la secuencia
+  long nsimul_seq = nsimul;
+  if (mode == antithetic)
+  {
+    nsimul_seq = (nsimul+1)/2;
+    if ( (nsimul > 0) && (nsimul % 2 == 0) ) sign=-1.0;
+  }
+  else if (mode == quasi)
+  {
+    //todas las simulaciones comparten los parametros aleatorios
+    nsimul_seq = 0;
+    nquasi = (nsimul > 0) ? static_cast<uint32_t>(nsimul-1) : 0;
+  }
+  key[0]=static_cast<uint32_t>(seed & 0xFFFFFFFFUL);
+  key[1]=static_cast<uint32_t>((seed >> 32) & 0xFFFFFFFFUL);
+  ctr[0]=0;                                         //bloque dentro de la serie
+  ctr[1]=static_cast<uint32_t>(nsimul_seq);
+  ctr[2]=static_cast<uint32_t>(ns);
+  ctr[3]=(static_cast<uint32_t>(type) << 24) ^ 
+         static_cast<uint32_t>(nsimulsn);
+  nused=4;
+}
+
+//-----------------------------------------------------------------------------
+//genera un nuevo bloque de 4 numeros de 32 bits (10 rondas de Philox4x32)
+//e incrementa el contador
+void RandomStream::nextblock()
+{
+  const uint64_t M0=0xD2511F53UL;
+  const uint64_t M1=0xCD9E8D57UL;
+  const uint32_t W0=0x9E3779B9UL;
+  const uint32_t W1=0xBB67AE85UL;
+  uint32_t x0=ctr[0], x1=ctr[1], x2=ctr[2], x3=ctr[3];
+  uint32_t k0=key[0], k1=key[1];
+  for (int iround=0; iround < 10; iround++)
+  {
+    const uint64_t p0=M0*x0;
+    const uint64_t p1=M1*x2;
+    const uint32_t hi0=static_cast<uint32_t>(p0 >> 32);
+    const uint32_t lo0=static_cast<uint32_t>(p0);
+    const uint32_t hi1=static_cast<uint32_t>(p1 >> 32);
+    const uint32_t lo1=static_cast<uint32_t>(p1);
+    x0=hi1^x1^k0;
+    x1=lo1;
+    x2=hi0^x3^k1;
+    x3=lo0;
+    k0+=W0;
+    k1+=W1;
+  }
+  block[0]=x0;
+  block[1]=x1;
+  block[2]=x2;
+  block[3]=x3;
+  ctr[0]++;
+  nused=0;
+}
+
+//-----------------------------------------------------------------------------
+//numero aleatorio uniforme con 53 bits de precision; nunca se obtienen los
+//valores 0 ni 1 (lo que permite tomar logaritmos sin precauciones)
+double RandomStream::uniform()
+{
+  if (nused > 2) nextblock();
+  const double ran = touniform(block[nused],block[nused+1]);
+  nused+=2;
+  return(ran);
+}
+
+//-----------------------------------------------------------------------------
+//numero uniforme en (0,1) a partir de dos numeros de 32 bits
+double RandomStream::touniform(const uint32_t a32, const uint32_t b32)
+{
+  const uint32_t a=a32 >> 5;
+  const uint32_t b=b32 >> 6;
+  return((static_cast<double>(a)*67108864.0+static_cast<double>(b)+0.5)/
+         9007199254740992.0);
+}
+
+//-----------------------------------------------------------------------------
+//numero aleatorio con distribucion normal (metodo de Box-Muller); en modo
+//quasi se transforma el punto de la secuencia mediante la inversa de la
+//funcion de distribucion normal
+double RandomStream::gaussian()
+{
+  if (mode == quasi)
+  {
+    if (nused > 2) nextblock();
+    const uint32_t shift = block[nused++];
+    const uint32_t pkey = block[nused++];
+    //punto de la secuencia de van der Corput (bits en orden inverso)
+    uint32_t n = permute(nquasi,pkey);
+    uint32_t point = 0;
+    for (int ibit = 0; ibit < 32; ibit++)
+    {
+      point = (point << 1) | (n & 1);
+      n >>= 1;
+    }
+    const uint32_t ushifted = point ^ shift;
+    return(invnormal((static_cast<double>(ushifted)+0.5)/4294967296.0));
+  }
+  const double pi2 = 4.*acos(0.0);
+  const double ran1 = uniform();
+  const double ran2 = uniform();
+  return(sign*sqrt(-2.0*log(ran1))*cos(pi2*ran2));
+}
+
+//-----------------------------------------------------------------------------
+//genera de una vez los numeros aleatorios normales first...first+n-1 de la
+//secuencia (por ejemplo, los pixeles de un espectro que afectan a un
+//indice), situando el contador directamente en el bloque correspondiente:
+//con Box-Muller cada numero emplea un bloque completo, y en modo quasi
+//medio bloque
+void RandomStream::gaussian(double *z, const long first, const long n)
+{
+  if (mode == quasi)
+  {
+    ctr[0]=static_cast<uint32_t>(first/2);
+    nused=4;
+    if (first % 2 != 0)
+    {
+      nextblock();
+      nused=2;
+    }
+    for (long i = 0; i < n; i++)
+      z[i]=gaussian();
+    return;
+  }
+  const double pi2 = 4.*acos(0.0);
+  ctr[0]=static_cast<uint32_t>(first);
+  for (long i = 0; i < n; i++)
+  {
+    nextblock();
+    const double ran1 = touniform(block[0],block[1]);
+    const double ran2 = touniform(block[2],block[3]);
+    z[i]=sign*sqrt(-2.0*log(ran1))*cos(pi2*ran2);
+  }
+  nused=4;
+}
+
+//-----------------------------------------------------------------------------
+//orden aleatorio de los puntos: permuta n dentro del bloque [2^k,2^(k+1))
+//que lo contiene, mediante una red de Feistel de 8 rondas sobre los k bits
+//inferiores (con 2h >= k bits, repitiendo la permutacion hasta obtener un
+//valor dentro del bloque)
+uint32_t RandomStream::permute(const uint32_t n, const uint32_t pkey)
+{
+  int k = 0;
+  while ( (k < 31) && ((n >> (k+1)) != 0) ) k++;
+  if (k == 0) return(n);
+  const uint32_t mask = (static_cast<uint32_t>(1) << k)-1;
+  const int h = (k+1)/2;
+  const uint64_t hmask = (static_cast<uint64_t>(1) << h)-1;
+  uint64_t x = n & mask;
+  do
+  {
+    uint64_t left = x >> h;
+    uint64_t right = x & hmask;
+    for (uint64_t iround = 0; iround < 8; iround++)
+    {
+      //funcion de ronda: mezcla de splitmix64
+      uint64_t z = (static_cast<uint64_t>(pkey) ^ (iround << 40) ^ right)+
+                   0x9E3779B97F4A7C15ULL;
+      z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+      z ^= z >> 31;
+      const uint64_t newright = left ^ (z & hmask);
+      left = right;
+      right = newright;
+    }
+    x = (left << h) | right;
+  } while (x > mask);
+  return((n & ~mask) | static_cast<uint32_t>(x));
+}
+
+//-----------------------------------------------------------------------------
+//inversa de la funcion de distribucion normal (aproximacion racional de
+//Acklam, refinada con un paso del metodo de Halley); 0 < p < 1
+double RandomStream::invnormal(const double p)
+{
+  const double a[6] = {-3.969683028665376e+01,  2.209460984245205e+02,
+                       -2.759285104469687e+02,  1.383577518672690e+02,
+                       -3.066479806614716e+01,  2.506628277459239e+00};
+  const double b[5] = {-5.447609879822406e+01,  1.615858368580409e+02,
+                       -1.556989798598866e+02,  6.680131188771972e+01,
+                       -1.328068155288572e+01};
+  const double c[6] = {-7.784894002430293e-03, -3.223964580411365e-01,
+                       -2.400758277161838e+00, -2.549732539343734e+00,
+                        4.374664141464968e+00,  2.938163982698783e+00};
+  const double d[4] = { 7.784695709041462e-03,  3.224671290700398e-01,
+                        2.445134137142996e+00,  3.754408661907416e+00};
+  const double plow = 0.02425;
+  double x;
+  if (p < plow) //cola inferior
+  {
+    const double q = sqrt(-2.0*log(p));
+    x = (((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5])/
+        ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1.0);
+  }
+  else if (p > 1.0-plow) //cola superior
+  {
+    const double q = sqrt(-2.0*log(1.0-p));
+    x = -(((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5])/
+         ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1.0);
+  }
+  else //region central
+  {
+    const double q = p-0.5;
+    const double r = q*q;
+    x = (((((a[0]*r+a[1])*r+a[2])*r+a[3])*r+a[4])*r+a[5])*q/
+        (((((b[0]*r+b[1])*r+b[2])*r+b[3])*r+b[4])*r+1.0);
+  }
+  const double pi2 = 4.*acos(0.0);
+  const double e = 0.5*erfc(-x/sqrt(2.0))-p;
+  const double u = e*sqrt(pi2)*exp(x*x/2.0);
+  return(x-u/(1.0+x*u/2.0));
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+//Declaracion de la clase RandomStream
+//Las funciones miembro se definen en randomstream.cpp
+
+#ifndef RANDOMSTREAM_H
+#define RANDOMSTREAM_H
+
+#include <stdint.h>
+
+//Generador de numeros aleatorios basado en contador (Philox4x32-10). Cada
+//secuencia queda completamente determinada por la semilla, el tipo de
+//simulacion, el numero de espectro y los numeros de simulacion, de forma que
+//las simulaciones de cualquier espectro pueden reproducirse de forma aislada
+//y en cualquier hilo de ejecucion, con independencia del orden de medida.
+//El modo de simulacion (keyword simmode) solo afecta a gaussian(): con
+//antithetic, las simulaciones 2j-1 y 2j comparten la secuencia con signo
+//opuesto; con quasi, cada numero generado (dimension) toma los puntos de una
+//secuencia de van der Corput en base 2 (primera coordenada de Sobol) con un
+//desplazamiento digital aleatorio, y con un orden aleatorio de los puntos
+//dentro de cada bloque [2^k,2^(k+1)), de forma que las primeras 2^k
+//simulaciones estratifican cada dimension y las distintas dimensiones son
+//independientes entre si (como en un hipercubo latino). Los parametros
+//aleatorios de cada dimension son comunes a todas las simulaciones.
+class RandomStream{
+  public:
+    //tipos de simulacion (cada uno genera secuencias independientes)
+    enum {rvsimul=1, snlevel=2, snsimul=3, percentile=4};
+    //modos de simulacion
+    enum {pseudo=0, antithetic=1, quasi=2};
+    RandomStream(const uint64_t,      //semilla
+                 const long,          //tipo de simulacion
+                 const long,          //numero de espectro
+                 const long,          //numero de simulacion en S/N (0=ninguna)
+                 const long,          //numero de simulacion (0=ninguna)
+                 const long = pseudo); //modo de simulacion
+    double uniform();  //numero aleatorio uniforme en el intervalo (0,1)
+    double gaussian(); //numero aleatorio normal con media 0 y sigma 1
+    //numeros aleatorios normales first, first+1, ..., first+n-1 de la
+    //secuencia (los mismos que con llamadas sucesivas a gaussian())
+    void gaussian(double *, const long, const long);
+  private:
+    void nextblock();
+    static double touniform(const uint32_t, const uint32_t);
+    static uint32_t permute(const uint32_t, const uint32_t);
+    static double invnormal(const double);
+    long mode;          //modo de simulacion
+    double sign;        //antithetic: signo de la simulacion
+    uint32_t nquasi;    //quasi: indice del punto en la secuencia
+    uint32_t key[2];    //clave (semilla)
+    uint32_t ctr[4];    //contador
+    uint32_t block[4];  //ultimo bloque de numeros aleatorios generado
+    int nused;          //numero de elementos de block ya utilizados
+};
+
+#endif
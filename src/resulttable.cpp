@@ -0,0 +1,154 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+//Definicion de funciones miembro de la clase ResultTable, declarada en 
+//resulttable.h
+#include <cstdlib>
+#include <sstream>
+#include "resulttable.h"
+
+using namespace std;
+
+//columnas de la tabla
+static const int NCOLUMNS = 14;
+static const char *ttype[NCOLUMNS] = {"NS", "INDEX",
+                                      "FINDEX", "EINDEX", "SN",
+                                      "RVEL", "RVELERR",
+                                      "FINDEX_RV", "EINDEX_RV",
+                                      "FINDEX_RVA", "EINDEX_RVA",
+                                      "STATUS", "NSIMUL", "LABEL"};
+static const char *tunit[NCOLUMNS] = {"", "", "", "", "",
+                                      "km/s", "km/s",
+                                      "", "", "", "", "", "", ""};
+
+//-----------------------------------------------------------------------------
+//constructor: crea el fichero (sobrescribiendo uno previo) y la tabla
+ResultTable::ResultTable(const char *filename, const long lindexname,
+                         const long llabel)
+{
+  nrows=0;
+  int status=0;
+  const string sfilename = string("!")+filename; //sobrescribimos
+  if ( fits_create_file(&fptr, sfilename.c_str(), &status) )
+    printerror( status );
+  //formato de cada columna (las cadenas ocupan al menos 1 caracter)
+  ostringstream sindexname, slabel;
+  sindexname << (lindexname > 0 ? lindexname : 1) << "A";
+  slabel << (llabel > 0 ? llabel : 1) << "A";
+  const string tformD = "1D";
+  const string tformJ = "1J";
+  string tform[NCOLUMNS];
+  for (long i = 0; i < NCOLUMNS; i++)
+    tform[i]=tformD;
+  tform[0]=tformJ;
+  tform[1]=sindexname.str();
+  tform[11]=tformJ;
+  tform[12]=tformJ;
+  tform[13]=slabel.str();
+  char *ttypePtr[NCOLUMNS], *tformPtr[NCOLUMNS], *tunitPtr[NCOLUMNS];
+  for (long i = 0; i < NCOLUMNS; i++)
+  {
+    ttypePtr[i]=const_cast<char *>(ttype[i]);
+    tformPtr[i]=const_cast<char *>(tform[i].c_str());
+    tunitPtr[i]=const_cast<char *>(tunit[i]);
+  }
+  if ( fits_create_tbl(fptr, BINARY_TBL, 0, NCOLUMNS, 
+                       ttypePtr, tformPtr, tunitPtr, "INDEXF", &status) )
+    printerror( status );
+  //NSIMUL solo tiene sentido con simulaciones adaptativas (simtol > 0);
+  //en otro caso se almacena el valor nulo de la columna
+  long nullnsimul = -1;
+  if ( fits_write_key(fptr, TLONG, "TNULL13", &nullnsimul,
+                      "NSIMUL undefined (simtol=0)", &status) )
+    printerror( status );
+}
+
+//-----------------------------------------------------------------------------
+//destructor: escribe las filas pendientes y cierra el fichero
+ResultTable::~ResultTable()
+{
+  flush();
+  int status=0;
+  if ( fits_close_file(fptr, &status) )
+    printerror( status );
+}
+
+//-----------------------------------------------------------------------------
+void ResultTable::addrows(vector <ResultRow> &rows)
+{
+  pending.insert(pending.end(),rows.begin(),rows.end());
+  rows.clear();
+  if (static_cast<long>(pending.size()) >= blocksize) flush();
+}
+
+//-----------------------------------------------------------------------------
+//escribe las filas pendientes, columna a columna
+void ResultTable::flush()
+{
+  const long n = pending.size();
+  if (n == 0) return;
+  int status=0;
+  const LONGLONG firstrow = nrows+1;
+  vector <long> lcol(n);
+  vector <double> dcol(n);
+  vector <char *> scol(n);
+  //columnas enteras
+  for (long i = 0; i < n; i++) lcol[i]=pending[i].ns;
+  fits_write_col(fptr, TLONG, 1, firstrow, 1, n, &lcol[0], &status);
+  for (long i = 0; i < n; i++) lcol[i]=pending[i].status;
+  fits_write_col(fptr, TLONG, 12, firstrow, 1, n, &lcol[0], &status);
+  for (long i = 0; i < n; i++) lcol[i]=pending[i].nsimul;
+  fits_write_col(fptr, TLONG, 13, firstrow, 1, n, &lcol[0], &status);
+  //columnas de texto
+  for (long i = 0; i < n; i++)
+    scol[i]=const_cast<char *>(pending[i].indexname.c_str());
+  fits_write_col(fptr, TSTRING, 2, firstrow, 1, n, &scol[0], &status);
+  for (long i = 0; i < n; i++)
+    scol[i]=const_cast<char *>(pending[i].label.c_str());
+  fits_write_col(fptr, TSTRING, 14, firstrow, 1, n, &scol[0], &status);
+  //columnas en doble precision
+  double ResultRow::*dmember[9] = {&ResultRow::findex, &ResultRow::eindex,
+                                   &ResultRow::sn,
+                                   &ResultRow::rvel, &ResultRow::rvelerr,
+                                   &ResultRow::findex_rv,
+                                   &ResultRow::eindex_rv,
+                                   &ResultRow::findex_rva,
+                                   &ResultRow::eindex_rva};
+  for (long k = 0; k < 9; k++)
+  {
+    for (long i = 0; i < n; i++) dcol[i]=pending[i].*dmember[k];
+    fits_write_col(fptr, TDOUBLE, k+3, firstrow, 1, n, &dcol[0], &status);
+  }
+  if (status) printerror( status );
+  nrows+=n;
+  pending.clear();
+}
+
+//-----------------------------------------------------------------------------
+void ResultTable::printerror(const int status)
+{
+  /*****************************************************/
+  /* Print out cfitsio error messages and exit program */
+  /*****************************************************/
+  if (status)
+  {
+    fits_report_error(stderr, status); /* print error report */
+    exit( status );    /* terminate the program, returning error status */
+  }
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+//Declaracion de la clase ResultTable
+//Las funciones miembro se definen en resulttable.cpp
+
+#ifndef RESULTTABLE_H
+#define RESULTTABLE_H
+
+#include <string>
+#include <vector>
+#include "fitsio.h"
+
+//medida de un indice en un espectro (una fila de la tabla); los valores no
+//disponibles son NaN, y el motivo se indica en status
+struct ResultRow
+{
+  long ns;                       //numero de espectro (<0: simulacion S/N)
+  std::string indexname;
+  double findex, eindex, sn;
+  double rvel, rvelerr;
+  double findex_rv, eindex_rv;   //simulaciones de velocidad radial
+  double findex_rva, eindex_rva; //propagacion analitica (rverrmode=both)
+  std::string label;
+  long nsimul;                   //numero de simulaciones realizadas (solo
+                                 //con simtol > 0; -1 en otro caso)
+  long status;                   //bit n activado: codigo undefn
+};
+
+//Tabla FITS (BINTABLE) con las medidas (keyword of), alternativa a la 
+//salida en modo texto. Las filas se acumulan en memoria y se escriben en
+//bloques de blocksize filas; la tabla se completa en el destructor.
+class ResultTable{
+  public:
+    //fichero, longitud maxima del nombre del indice y de las etiquetas
+    ResultTable(const char *, const long, const long);
+    ~ResultTable();
+    //anade las filas indicadas (y vacia el vector)
+    void addrows(std::vector <ResultRow> &);
+    static const long blocksize = 1024;
+  private:
+    ResultTable(const ResultTable &);
+    ResultTable & operator = (const ResultTable &);
+    void flush();
+    void printerror(const int);
+    fitsfile *fptr;
+    long nrows;                    //filas ya escritas en el fichero
+    std::vector <ResultRow> pending; //filas pendientes de escribir
+};
+
+#endif
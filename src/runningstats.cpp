@@ -0,0 +1,74 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+//Definicion de funciones miembro de la clase RunningStats, declarada en 
+//runningstats.h
+#include <cmath>
+#include "runningstats.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//constructor
+RunningStats::RunningStats(const double tol_)
+{
+  tol=tol_;
+  n=0;
+  mean=0.0;
+  m2=0.0;
+  sigma_last=-1.0;
+  n_last=0;
+}
+
+//-----------------------------------------------------------------------------
+void RunningStats::add(const double x)
+{
+  n++;
+  const double delta = x-mean;
+  mean+=delta/static_cast<double>(n);
+  m2+=delta*(x-mean);
+}
+
+//-----------------------------------------------------------------------------
+//indica si la desviacion tipica ha convergido; solo se evalua cada ncheck
+//valores nuevos
+bool RunningStats::converged()
+{
+  if ( (tol <= 0.0) || (n < nmin) || (n % ncheck != 0) ) return(false);
+  if (n == n_last) return(false); //no hay valores nuevos
+  n_last = n;
+  const double sigma = getsigma();
+  const double sigma_previous = sigma_last;
+  sigma_last = sigma;
+  if (sigma_previous < 0.0) return(false); //primera comprobacion
+  return(fabs(sigma-sigma_previous) <= tol*sigma);
+}
+
+//-----------------------------------------------------------------------------
+long RunningStats::getn() const { return n; }
+
+//-----------------------------------------------------------------------------
+double RunningStats::getmean() const { return mean; }
+
+//-----------------------------------------------------------------------------
+double RunningStats::getsigma() const
+{
+  if (n <= 1) return(0.0);
+  return(sqrt(m2/static_cast<double>(n-1)));
+}
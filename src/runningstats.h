@@ -0,0 +1,51 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+//Declaracion de la clase RunningStats
+//Las funciones miembro se definen en runningstats.cpp
+
+#ifndef RUNNINGSTATS_H
+#define RUNNINGSTATS_H
+
+//Media y desviacion tipica de una serie de simulaciones, actualizadas con
+//cada nuevo valor (algoritmo de Welford), que permiten detener las 
+//simulaciones cuando la desviacion tipica ha convergido (keyword simtol):
+//cada ncheck valores (y a partir de nmin) se compara la desviacion tipica 
+//con la de la comprobacion anterior, y se considera que ha convergido si 
+//el cambio relativo es menor que la tolerancia.
+class RunningStats{
+  public:
+    RunningStats(const double); //tolerancia (0: sin convergencia)
+    void add(const double);
+    bool converged();
+    long getn() const;
+    double getmean() const;
+    double getsigma() const;
+    static const long nmin = 30;   //numero minimo de valores
+    static const long ncheck = 10; //valores entre comprobaciones
+  private:
+    double tol;
+    long n;
+    double mean;
+    double m2;          //suma de los cuadrados de las desviaciones
+    double sigma_last;  //desviacion tipica en la comprobacion anterior
+    long n_last;        //numero de valores en la comprobacion anterior
+};
+
+#endif
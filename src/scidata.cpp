@@ -27,6 +27,11 @@
 #include <string.h>
 #include <cmath>
 #include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "scidata.h"
 #include "fitsio.h"
 #include "longnam.h"
@@ -42,11 +47,56 @@ bool issdouble(const string &, double &);
 bool isslong(const string &, long &);
 void sustrae_p0(vector<XYData> &, double &, double &);
 void sustrae_p1(vector<XYData> &, double &, double &);
+bool indexspan(const IndexDef &, const long,
+               const double, const double, const double,
+               const bool, const double, long &, long &);
 
 //-----------------------------------------------------------------------------
-//constructor
+//constructor: los errores terminan el programa
 SciData::SciData(IndexParam &param)
 {
+  lexit = true;
+  outPtr = &cout;
+  init(param);
+}
+
+//-----------------------------------------------------------------------------
+//constructor: con lexit=false los errores no terminan el programa; los
+//avisos y errores se guardan (ver getmessages) y, si se produce un error, el
+//objeto queda marcado como no valido (ver isvalid) y solo puede destruirse
+SciData::SciData(IndexParam &param, const bool lexit_)
+{
+  lexit = lexit_;
+  outPtr = lexit ? &cout : &messages;
+  init(param);
+}
+
+//-----------------------------------------------------------------------------
+//inicializa el objeto (ver constructores); los recursos se asignan en
+//cuanto se obtienen, de forma que el destructor libera los ya reservados si
+//se produce un error
+void SciData::init(IndexParam &param)
+{
+  lvalid = true;
+  nberror = -1;
+  fptr_data = NULL;
+  fptr_error = NULL;
+  naxis[0] = naxis[1] = naxis[2] = 0;
+  nblocks = 0;
+  blocks = NULL; //ver allocblocks, al final del constructor
+  nuse = 0;
+  map_data.addr = NULL;
+  map_data.pixels = NULL;
+  map_error.addr = NULL;
+  map_error.pixels = NULL;
+  mfile_data.addr = NULL;
+  mfile_error.addr = NULL;
+  rvel = NULL;
+  rvelerr = NULL;
+  labelsp = NULL;
+  pthread_mutex_init(&mutex,NULL);
+  pthread_cond_init(&cond,NULL);
+  ostream &out = *outPtr;
   //-----------------------------
   //inicializamos imagen de datos
   //-----------------------------
@@ -54,9 +104,10 @@ SciData::SciData(IndexParam &param)
   long length = strlen(file_data);
   if ( length > 255 )
   {
-    cout << "FATAL ERROR: strlen(filename_data) > 255. "
-         << "(redim filename_data in scidata.cpp)" << endl;
-    exit(1);
+    out << "FATAL ERROR: strlen(filename_data) > 255. "
+        << "(redim filename_data in scidata.cpp)" << endl;
+    fatalerror();
+    return;
   }
   strncpy(filename_data,file_data,length);
   filename_data[length] = '\0';
@@ -66,10 +117,28 @@ SciData::SciData(IndexParam &param)
   int status=0;
   long naxes[2];
   if ( fits_open_file(&fptr, file_data, READONLY, &status) )
-       printerror( status );
-  // read the NAXIS1 and NAXIS2 keywords to get the image size
-  if ( fits_read_keys_lng(fptr, "NAXIS", 1, 2, naxes, &nfound, &status) )
-       printerror( status );
+  {
+    printerror( status );
+    return;
+  }
+  //la imagen de datos no se lee aqui: el fichero permanece abierto y los
+  //espectros se leen por bloques de chunksize espectros (ver getblock), de
+  //forma que la memoria necesaria no depende del numero de espectros
+  fptr_data = fptr;
+  //dimensiones de la imagen (en imagenes comprimidas por teselas, NAXISn
+  //son las de la tabla que contiene las teselas, por lo que se emplea
+  //fits_get_img_size, que retorna ZNAXISn)
+  if ( fits_get_img_dim(fptr, &nfound, &status) )
+  {
+    printerror( status );
+    return;
+  }
+  if (nfound > 2) nfound = 2; //como fits_read_keys_lng(...,"NAXIS",1,2,...)
+  if ( fits_get_img_size(fptr, 2, naxes, &status) )
+  {
+    printerror( status );
+    return;
+  }
   if (nfound == 1)
   {
     naxis[0]=1;
@@ -84,10 +153,9 @@ SciData::SciData(IndexParam &param)
   }
   else
   {
-    cout << "FATAL ERROR: this program cannot handle NAXIS > 2" << endl;
-    if ( fits_close_file(fptr, &status) )
-         printerror( status );
-    exit(1);
+    out << "FATAL ERROR: this program cannot handle NAXIS > 2" << endl;
+    fatalerror();
+    return;
   }
   //chequeamos los espectros a medir con los espectros disponibles
   const long ns1=param.get_ns1();
@@ -99,11 +167,10 @@ SciData::SciData(IndexParam &param)
   }
   else if ( ( ns1 < 1 ) || ( ns2 > naxis[2] ) )
   {
-    cout << "FATAL ERROR: spectra numbers " << ns1 << " and " 
-         << ns2 << " out of range." << endl;
-    if ( fits_close_file(fptr, &status) )
-         printerror( status );
-    exit (1);
+    out << "FATAL ERROR: spectra numbers " << ns1 << " and " 
+        << ns2 << " out of range." << endl;
+    fatalerror();
+    return;
   }
   //leemos object
   char object_[256];
@@ -121,8 +188,8 @@ SciData::SciData(IndexParam &param)
     ctype1_[4]='\0';
     if(param.get_verbose())
     {
-      cout << "#WARNING: keyword CTYPE1 not found. Assuming CTYPE1=" 
-           << ctype1_ << endl;
+      out << "#WARNING: keyword CTYPE1 not found. Assuming CTYPE1=" 
+          << ctype1_ << endl;
     } 
     status=0;
   }
@@ -132,12 +199,13 @@ SciData::SciData(IndexParam &param)
       (strcmp(ctype1,"WAVE-LOG") != 0) &&
       (strcmp(ctype1,"LINEAR") != 0))
   {
-    cout << "CTYPE1=" << ctype1 << endl;
-    cout << "ERROR: CTYPE1 != 'WAVE'." << endl;
-    cout << "ERROR: CTYPE1 != 'WAVE-LOG'." << endl;
-    cout << "ERROR: CTYPE1 != 'LINEAR'." << endl;
-    cout << "This CTYPE1 value cannot be handled." << endl;
-    exit(1);
+    out << "CTYPE1=" << ctype1 << endl;
+    out << "ERROR: CTYPE1 != 'WAVE'." << endl;
+    out << "ERROR: CTYPE1 != 'WAVE-LOG'." << endl;
+    out << "ERROR: CTYPE1 != 'LINEAR'." << endl;
+    out << "This CTYPE1 value cannot be handled." << endl;
+    fatalerror();
+    return;
   }
 
   //---------------------------------------------------------------------------
@@ -158,8 +226,8 @@ SciData::SciData(IndexParam &param)
       ctype1[8]='\0';
       if(param.get_verbose())
       {
-        cout << "#WARNING: keyword DC-FLAG found. Assuming CTYPE1=" 
-             << ctype1 << endl;
+        out << "#WARNING: keyword DC-FLAG found. Assuming CTYPE1=" 
+            << ctype1 << endl;
       }
     }
   }
@@ -173,8 +241,8 @@ SciData::SciData(IndexParam &param)
     cunit1_[8]='\0';
     if(param.get_verbose())
     {
-      cout << "#WARNING: keyword CUNIT1 not found. Assuming CUNIT1=" 
-           << cunit1_ << endl;
+      out << "#WARNING: keyword CUNIT1 not found. Assuming CUNIT1=" 
+          << cunit1_ << endl;
     }
     status=0;
   }
@@ -182,31 +250,34 @@ SciData::SciData(IndexParam &param)
   cunit1[strlen(cunit1_)]='\0';
   if (strcmp(cunit1,"Angstrom") != 0)
   {
-    cout << "CUNIT1=" << cunit1 << endl;
-    cout << "ERROR: CUNIT1 != 'Angstrom'. This CUNIT1 value cannot be handled." 
-         << endl;
-    exit(1);
+    out << "CUNIT1=" << cunit1 << endl;
+    out << "ERROR: CUNIT1 != 'Angstrom'. This CUNIT1 value cannot be handled." 
+        << endl;
+    fatalerror();
+    return;
   }
   //leemos crval1, cdelt1 (o cd1_1) y crpix1
   double crval1_,cdelt1_,crpix1_;
   if ( fits_read_key(fptr, TDOUBLE, "CRVAL1", &crval1_, NULL, &status) )
   {
-    cout << "Error with keyword: CRVAL1" << endl;
+    out << "Error with keyword: CRVAL1" << endl;
     printerror( status );
+    return;
   }
   crval1 = crval1_;
   if ( fits_read_key(fptr, TDOUBLE, "CDELT1", &cdelt1_, NULL, &status) )
   {
     if(param.get_verbose())
     {
-      cout << "#WARNING: keyword CDELT1 not found. Looking for CD1_1..." 
-           << endl;
+      out << "#WARNING: keyword CDELT1 not found. Looking for CD1_1..." 
+          << endl;
     }
     int status_bis=0;
     if ( fits_read_key(fptr, TDOUBLE, "CD1_1", &cdelt1_, NULL, &status_bis) )
     {
-      cout << "Error with keyword: CD1_1" << endl;
+      out << "Error with keyword: CD1_1" << endl;
       printerror( status_bis );
+      return;
     }
   }
   cdelt1 = cdelt1_;
@@ -215,44 +286,29 @@ SciData::SciData(IndexParam &param)
     crpix1_=1.0;
     if(param.get_verbose())
     {
-      cout << "#WARNING: keyword CRPIX1 not found. Assuming CRPIX1=" 
-           << crpix1_ << endl;
+      out << "#WARNING: keyword CRPIX1 not found. Assuming CRPIX1=" 
+          << crpix1_ << endl;
     }
     status=0;
   }
   crpix1 = crpix1_;
   if ( crpix1 != 1.0)
   {
-    cout << "CRPIX1=" << crpix1 << endl;
-    cout << "ERROR: CRPIX1 != 1.0. This CRPIX1 value cannot be handled." 
-         << endl;
-    exit(1);
-  }
-  //leemos imagen de datos
-  long fpixel[2] = {1,1};
-  long nelements = naxis[1] * naxis[2];
-  data = new double [nelements];
-  int anynull;
-  if ( fits_read_pix(fptr, TDOUBLE, fpixel, nelements, 0, 
-       data, &anynull, &status) )
-       printerror( status );
-  //cerramos fichero
-  if ( fits_close_file(fptr, &status) )
-       printerror( status );
-  if(anynull !=0)
-  {
-    cout << "FATAL ERROR: the data spectra contain NULL values." << endl;
-    exit(1);
-  }
-  //en caso necesario, aplicamos cambio de escala en la imagen
-  double fscale = param.get_fscale();
-  if (fscale != 1.0)
-  {
-    for (long i=1; i<=nelements; i++)
-    {
-      data[i-1]/=fscale;
-    }
+    out << "CRPIX1=" << crpix1 << endl;
+    out << "ERROR: CRPIX1 != 1.0. This CRPIX1 value cannot be handled." 
+        << endl;
+    fatalerror();
+    return;
   }
+  fscale = param.get_fscale();
+  ns1_chunk = param.get_ns1();
+  ns2_chunk = param.get_ns2();
+  chunksize = param.get_chunksize();
+  if (chunksize > ns2_chunk-ns1_chunk+1)
+    chunksize = ns2_chunk-ns1_chunk+1;
+  colj1 = 1;
+  colj2 = naxis[1];
+  if (param.get_usemmap()) mapimage(fptr,file_data,map_data);
 
   //-------------------------------
   //inicializamos imagen de errores
@@ -261,9 +317,10 @@ SciData::SciData(IndexParam &param)
   length = strlen(file_error);
   if ( length > 255 )
   {
-    cout << "FATAL ERROR: strlen(file_error) > 255. "
-         << "(redim filename_error in scidata.cpp)" << endl;
-    exit(1);
+    out << "FATAL ERROR: strlen(file_error) > 255. "
+        << "(redim filename_error in scidata.cpp)" << endl;
+    fatalerror();
+    return;
   }
   strncpy(filename_error,file_error,length);
   filename_error[length] = '\0';
@@ -271,30 +328,40 @@ SciData::SciData(IndexParam &param)
   if (strcmp(filename_error,"undef") != 0)
   {
     if ( fits_open_file(&fptr, file_error, READONLY, &status) )
-         printerror( status );
+    {
+      printerror( status );
+      return;
+    }
+    fptr_error = fptr;
     //comprobamos que NAXISn en imagen de errores coincide con los valores
     //en la imagen de datos
     int nfound_error;
-    if ( fits_read_keys_lng(fptr, "NAXIS", 1, 2, naxes, &nfound_error, 
-         &status) )
-         printerror( status );
+    if ( fits_get_img_dim(fptr, &nfound_error, &status) )
+    {
+      printerror( status );
+      return;
+    }
+    if (nfound_error > 2) nfound_error = 2;
+    if ( fits_get_img_size(fptr, 2, naxes, &status) )
+    {
+      printerror( status );
+      return;
+    }
     if (nfound != nfound_error)
     {
-      cout << "FATAL ERROR: NAXISn in data and error frames are different" 
-           << endl;
-      if ( fits_close_file(fptr, &status) )
-           printerror( status );
-      exit(1);
+      out << "FATAL ERROR: NAXISn in data and error frames are different" 
+          << endl;
+      fatalerror();
+      return;
     }
     for ( long i = 1; i <= nfound; i++ )
     {
       if ( naxes[i-1] != naxis[i] )
       {
-        cout << "FATAL ERROR: NAXISn in data and error frames are different" 
-             << endl;
-        if ( fits_close_file(fptr, &status) )
-             printerror( status );
-        exit(1);
+        out << "FATAL ERROR: NAXISn in data and error frames are different" 
+            << endl;
+        fatalerror();
+        return;
       }
     }
     //leemos object
@@ -311,8 +378,8 @@ SciData::SciData(IndexParam &param)
       ctype1_[4]='\0';
       if(param.get_verbose())
       {
-        cout << "#WARNING: keyword CTYPE1 not found. Assuming CTYPE1=" 
-             << ctype1_ << endl;
+        out << "#WARNING: keyword CTYPE1 not found. Assuming CTYPE1=" 
+            << ctype1_ << endl;
       }
       status=0;
     }
@@ -330,9 +397,10 @@ SciData::SciData(IndexParam &param)
     {
       if(dcflag_ != dcflag)
       {
-        cout << "FATAL ERROR: DC-FLAG in data and error frames are different"
-             << endl;
-        exit(1);
+        out << "FATAL ERROR: DC-FLAG in data and error frames are different"
+            << endl;
+        fatalerror();
+        return;
       }
       if(dcflag_ == 1)
       {
@@ -340,21 +408,20 @@ SciData::SciData(IndexParam &param)
         ctype1_[8]='\0';
         if(param.get_verbose())
         {
-          cout << "#WARNING: keyword DC-FLAG found. Assuming CTYPE1=" 
-               << ctype1_ << endl;
+          out << "#WARNING: keyword DC-FLAG found. Assuming CTYPE1=" 
+              << ctype1_ << endl;
         }
       }
     }
     //-------------------------------------------------------------------------
     if ( strcmp(ctype1,ctype1_) != 0)
     {
-      cout << "CTYPE1=" << ctype1 << " (in data frame)" << endl;
-      cout << "CTYPE1=" << ctype1_ << " (in error frame)" << endl;
-      cout << "FATAL ERROR: CTYPE1 in data and error frames are different" 
-           << endl;
-      if ( fits_close_file(fptr, &status) )
-           printerror( status );
-      exit(1);
+      out << "CTYPE1=" << ctype1 << " (in data frame)" << endl;
+      out << "CTYPE1=" << ctype1_ << " (in error frame)" << endl;
+      out << "FATAL ERROR: CTYPE1 in data and error frames are different" 
+          << endl;
+      fatalerror();
+      return;
     }
     //leemos cunit1
     if ( fits_read_key(fptr, TSTRING, "CUNIT1", cunit1_, NULL, &status) )
@@ -363,86 +430,66 @@ SciData::SciData(IndexParam &param)
       cunit1_[8]='\0';
       if(param.get_verbose())
       {
-        cout << "#WARNING: keyword CUNIT1 not found. Assuming CUNIT1=" 
-             << cunit1_ << endl;
+        out << "#WARNING: keyword CUNIT1 not found. Assuming CUNIT1=" 
+            << cunit1_ << endl;
       }
       status=0;
     }
     if ( strcmp(cunit1,cunit1_) != 0)
     {
-      cout << "CUNIT1=" << cunit1 << " (in data frame)" << endl;
-      cout << "CUNIT1=" << cunit1_ << " (in error frame)" << endl;
-      cout << "FATAL ERROR: CUNIT1 in data and error frames are different" 
-           << endl;
-      if ( fits_close_file(fptr, &status) )
-           printerror( status );
-      exit(1);
+      out << "CUNIT1=" << cunit1 << " (in data frame)" << endl;
+      out << "CUNIT1=" << cunit1_ << " (in error frame)" << endl;
+      out << "FATAL ERROR: CUNIT1 in data and error frames are different" 
+          << endl;
+      fatalerror();
+      return;
     }
     //leemos crval1, cdelt1 y crpix1
     if ( fits_read_key(fptr, TDOUBLE, "CRVAL1", &crval1_, NULL, &status) )
     {
-      cout << "Error with keyword: CRVAL1" << endl;
+      out << "Error with keyword: CRVAL1" << endl;
       printerror( status );
+      return;
     }
     if ( crval1_ != crval1 )
     {
-      cout << "FATAL ERROR: CRVAL1 in data and error frames are different" 
-           << endl;
-      if ( fits_close_file(fptr, &status) )
-           printerror( status );
-      exit(1);
+      out << "FATAL ERROR: CRVAL1 in data and error frames are different" 
+          << endl;
+      fatalerror();
+      return;
     }
     if ( fits_read_key(fptr, TDOUBLE, "CDELT1", &cdelt1_, NULL, &status) )
     {
-      cout << "Error with keyword: CDELT1" << endl;
+      out << "Error with keyword: CDELT1" << endl;
       printerror( status );
+      return;
     }
     if ( cdelt1_ != cdelt1 )
     {
-      cout << "FATAL ERROR: CDELT1 in data and error frames are different" 
-           << endl;
-      if ( fits_close_file(fptr, &status) )
-           printerror( status );
-      exit(1);
+      out << "FATAL ERROR: CDELT1 in data and error frames are different" 
+          << endl;
+      fatalerror();
+      return;
     }
     if ( fits_read_key(fptr, TDOUBLE, "CRPIX1", &crpix1_, NULL, &status) )
     {
       if ( crpix1_ != 1.0 )
       {
-        cout << "Error with keyword: CRPIX1" << endl;
+        out << "Error with keyword: CRPIX1" << endl;
         printerror( status );
+        return;
       }
       status = 0;
     }
     if ( crpix1_ != crpix1 )
     {
-      cout << "FATAL ERROR: CRPIX1 in data and error frames are different" 
-           << endl;
-      if ( fits_close_file(fptr, &status) )
-           printerror( status );
-      exit(1);
-    }
-    //leemos imagen de errores
-    error = new double [nelements];
-    if ( fits_read_pix(fptr, TDOUBLE, fpixel, nelements, 0, 
-         error, &anynull, &status) )
-         printerror( status );
-    //cerramos fichero
-    if ( fits_close_file(fptr, &status) )
-         printerror( status );
-    if(anynull !=0)
-    {
-      cout << "FATAL ERROR: the error spectra contain NULL values." << endl;
-      exit(1);
-    }
-    //en caso necesario, aplicamos cambio de escala en la imagen
-    if (fscale != 1.0) //ya hemos definido fscale mas arriba
-    {
-      for (long i=1; i<=nelements; i++)
-      {
-        error[i-1]/=fscale;
-      }
+      out << "FATAL ERROR: CRPIX1 in data and error frames are different" 
+          << endl;
+      fatalerror();
+      return;
     }
+    //la imagen de errores se lee por bloques junto con la de datos
+    if (param.get_usemmap()) mapimage(fptr,file_error,map_error);
   }
  
   //-------------------------------------------------------------------
@@ -466,9 +513,24 @@ SciData::SciData(IndexParam &param)
   //Angstrom (y no por pixel) lo anterior no es lo que uno quiere. En este
   //ultimo caso, uno deberia interpolar directamente (sin conservar flujo). En
   //cualquier caso, el efecto en los indices debe ser pequeño si uno no lo hace
-  //bien.
+  //bien. Con logscale=native los espectros no se reescalan y los indices se
+  //miden directamente en la escala logaritmica (ver mideindex), evitando
+  //esta aproximacion.
   //-------------------------------------------------------------------------
-  if ( strcmp(ctype1,"WAVE-LOG") == 0)
+  llogscale=false;
+  lognative=false;
+  if ( (strcmp(ctype1,"WAVE-LOG") == 0) && (param.get_lognative()) )
+  {
+    //los espectros se miden sin reescalar, en la escala logaritmica
+    //original (crval1, cdelt1 y crpix1 conservan sus valores)
+    lognative=true;
+    if(param.get_verbose())
+    {
+      out << "#WARNING: spectra measured in their logarithmic wavelength"
+          << "\n#         calibration (assuming base-10 logarithm)" << endl;
+    }
+  }
+  else if ( strcmp(ctype1,"WAVE-LOG") == 0)
   {
     //calculamos parametros de la transformacion lineal conservando el mismo
     //numero de pixels 
@@ -479,99 +541,69 @@ SciData::SciData(IndexParam &param)
     wlmax=pow(10.0,crval1+cdelt1*(fnaxis1+0.5-crpix1));
     disp2=(wlmax-wlmin)/fnaxis1;
     stwv2=wlmin+0.5*disp2;
-    //pasamos a escala lineal, introduciendo temporalmente cada espectro
-    //en la variable temporal tempsp (y errores en tempesp)
-    long k;
-    double *tempsp = new double [naxis[1]];
-    double *tempesp = new double [naxis[1]];
-    for (long ns = 1; ns <= naxis[2]; ns++)
-    {
-      for (long nc = 1; nc <= naxis[1]; nc++)
+    //la correspondencia entre pixels de ambas escalas es la misma para
+    //todos los espectros, por lo que calculamos una unica vez la tabla de
+    //pesos (dispersa y en banda) con la que cada pixel de la escala lineal
+    //suma las contribuciones de los pixels de la escala logaritmica; el paso
+    //a escala lineal se aplica a cada espectro al leerlo (ver loglinear)
+    llogscale=true;
+    const long naxis1=naxis[1];
+    rebin_first.resize(naxis1+1);
+    for (long nc = 1; nc <= naxis1; nc++)
+    {
+      rebin_first[nc-1]=rebin_j.size();
+      double w=stwv2+static_cast<double>(nc-1)*disp2;       //l.d.o. pixel nc
+      double w1=w-0.5*disp2;                     //borde izquierdo del pixel nc
+      double w2=w1+disp2;                          //borde derecho del pixel nc
+      double fj1=(log10(w1)-crval1)/cdelt1+crpix1;
+      double fj2=(log10(w2)-crval1)/cdelt1+crpix1;
+      long j1=static_cast<long>(fj1);
+      long j2=static_cast<long>(fj2);
+      //mantenemos el orden de las contribuciones (pixels extremos primero)
+      //para que la suma no dependa de la tabla
+      if(j1 == j2)
       {
-        double w=stwv2+static_cast<double>(nc-1)*disp2;       //l.d.o. pixel nc
-        double w1=w-0.5*disp2;                   //borde izquierdo del pixel nc
-        double w2=w1+disp2;                        //borde derecho del pixel nc
-        double fj1=(log10(w1)-crval1)/cdelt1+crpix1;
-        double fj2=(log10(w2)-crval1)/cdelt1+crpix1;
-        long j1=static_cast<long>(fj1);
-        long j2=static_cast<long>(fj2);
-        tempsp[nc-1]=0.0;
-        if (strcmp(filename_error,"undef") != 0)
-          tempesp[nc-1]=0.0;
-        if(j1 == j2)
+        if( (j1 >= 1) && (j1 <= naxis1) )
         {
-          if( (j1 >= 1) && (j1 <= naxis[1]) )
-          {
-            k=(ns-1)*naxis[1]+j1-1;
-            tempsp[nc-1]=tempsp[nc-1]+data[k]*(fj2-fj1);
-            if (strcmp(filename_error,"undef") != 0)
-              tempesp[nc-1]=tempesp[nc-1]+error[k]*(fj2-fj1);
-          }
-        }
-        else
-        {
-          if( (j1 >= 1) && (j1 <= naxis[1]) )
-          {
-            k=(ns-1)*naxis[1]+j1-1;
-            tempsp[nc-1]=tempsp[nc-1]
-                         +data[k]*(static_cast<double>(j1)+0.5-fj1);
-            if (strcmp(filename_error,"undef") != 0)
-              tempesp[nc-1]=tempesp[nc-1]
-                           +error[k]*(static_cast<double>(j1)+0.5-fj1);
-          }
-          if( (j2 >= 1) && (j2 <= naxis[1]) )
-          {
-            k=(ns-1)*naxis[1]+j2-1;
-            tempsp[nc-1]=tempsp[nc-1]
-                         +data[k]*(fj2-(static_cast<double>(j2)-0.5));
-            if (strcmp(filename_error,"undef") != 0)
-              tempesp[nc-1]=tempesp[nc-1]
-                           +error[k]*(fj2-(static_cast<double>(j2)-0.5));
-          }
-          if( (j2-j1) > 1 )
-          {
-            for (long j=j1+1; j<=j2-1; j++)
-            {
-              if( (j >= 1) && (j <= naxis[1]) )
-              {
-                k=(ns-1)*naxis[1]+j-1;
-                tempsp[nc-1]=tempsp[nc-1]+data[k];
-                if (strcmp(filename_error,"undef") != 0)
-                  tempesp[nc-1]=tempesp[nc-1]+error[k];
-              }
-            }
-          }
+          rebin_j.push_back(j1-1);
+          rebin_w.push_back(fj2-fj1);
         }
       }
-      //actualizamos el espectro con el nuevo muestreo lineal
-      for (long nc = 1; nc <= naxis[1]; nc++)
-      {
-        k=(ns-1)*naxis[1]+nc-1;
-        data[k]=tempsp[nc-1];
-      }
-      if (strcmp(filename_error,"undef") != 0)
+      else
       {
-        for (long nc = 1; nc <= naxis[1]; nc++)
+        if( (j1 >= 1) && (j1 <= naxis1) )
+        {
+          rebin_j.push_back(j1-1);
+          rebin_w.push_back(static_cast<double>(j1)+0.5-fj1);
+        }
+        if( (j2 >= 1) && (j2 <= naxis1) )
         {
-          k=(ns-1)*naxis[1]+nc-1;
-          error[k]=tempesp[nc-1];
+          rebin_j.push_back(j2-1);
+          rebin_w.push_back(fj2-(static_cast<double>(j2)-0.5));
+        }
+        for (long j=j1+1; j<=j2-1; j++)
+        {
+          if( (j >= 1) && (j <= naxis1) )
+          {
+            rebin_j.push_back(j-1);
+            rebin_w.push_back(1.0);
+          }
         }
       }
     }
-    delete [] tempsp;
-    delete [] tempesp;
+    rebin_first[naxis1]=rebin_j.size();
     //mostramos el efecto del nuevo cambio de escala
     if(param.get_verbose())
     {
-      cout << "#WARNING: spectra transformed to a linear wavelength"
-           << "\n#         calibration (assuming base-10 logarithm) with:" 
-           << "\n#         > CRVAL1 (log. scale)=" << crval1
-           << "\n#         > CD1_1  (log. scale)=" << cdelt1
-           << "\n#         > CRPIX1 (log. scale)=" << crpix1
-           << "\n#         > CRVAL1 (lin. scale)=" << stwv2
-           << "\n#         > CDELT1 (lin. scale)=" << disp2
-           << "\n#         > CRPIX1 (lin. scale)=" << 1.0
-           << "\n#         and preserving the flux/pixel!" << endl;
+      out << "#WARNING: spectra transformed to a linear wavelength"
+          << "\n#         calibration (assuming base-10 logarithm) with:" 
+          << "\n#         > CRVAL1 (log. scale)=" << crval1
+          << "\n#         > CD1_1  (log. scale)=" << cdelt1
+          << "\n#         > CRPIX1 (log. scale)=" << crpix1
+          << "\n#         > CRVAL1 (lin. scale)=" << stwv2
+          << "\n#         > CDELT1 (lin. scale)=" << disp2
+          << "\n#         > CRPIX1 (lin. scale)=" << 1.0
+          << "\n#         and preserving the flux/pixel!" << endl;
     }
     crval1=stwv2;
     cdelt1=disp2;
@@ -588,9 +620,10 @@ SciData::SciData(IndexParam &param)
   length = strlen(file_rvel);
   if ( length > 255 )
   {
-    cout << "FATAL ERROR: strlen(filename_rvel) > 255. "
-         << "(redim filename_rvel in scidata.h)" << endl;
-    exit(1);
+    out << "FATAL ERROR: strlen(filename_rvel) > 255. "
+        << "(redim filename_rvel in scidata.h)" << endl;
+    fatalerror();
+    return;
   }
   strncpy(filename_rvel,file_rvel,length);
   filename_rvel[length] = '\0';
@@ -600,8 +633,9 @@ SciData::SciData(IndexParam &param)
     ifstream infile (filename_rvel,ios::in);
     if ( !infile )
     {
-      cout << "FATAL ERROR: while opening the file " << filename_rvel << endl;
-      exit(1);
+      out << "FATAL ERROR: while opening the file " << filename_rvel << endl;
+      fatalerror();
+      return;
     }
     //leemos el fichero con velocidades radiales
     string s;
@@ -617,10 +651,11 @@ SciData::SciData(IndexParam &param)
         //comprobamos que el fichero no contiene demasiadas lineas
         if (nlines > naxis[2])
         {
-          cout << "FATAL ERROR: number of lines in file " << filename_rvel
-               << " = " << nlines << " is larger than the expected value "
-               "(naxis[2]=" << naxis[2] << ")" << endl;
-          exit(1);
+          out << "FATAL ERROR: number of lines in file " << filename_rvel
+              << " = " << nlines << " is larger than the expected value "
+              "(naxis[2]=" << naxis[2] << ")" << endl;
+          fatalerror();
+          return;
         }
         //si no usamos errores en velocidad radial, inicializamos a cero
         if (rvce == 0)
@@ -642,10 +677,12 @@ SciData::SciData(IndexParam &param)
             tokenPtr = strtok(NULL," ");
           if (tokenPtr == NULL)
           {
-            cout << "FATAL ERROR: missing number in file "
-                 << filename_rvel << ", while reading line number "
-                 << nlines << " and column number " << ncol << endl;
-            exit(1);
+            out << "FATAL ERROR: missing number in file "
+                << filename_rvel << ", while reading line number "
+                << nlines << " and column number " << ncol << endl;
+            delete [] linePtr;
+            fatalerror();
+            return;
           }
           if (ncol == rvc)
           {
@@ -667,10 +704,11 @@ SciData::SciData(IndexParam &param)
     //abortamos la ejecucion del programa
     if (nlines != naxis[2])
     {
-      cout << "FATAL ERROR: number of lines in file " << filename_rvel
-           << " = " << nlines << " is different to the expected value "
-           "(naxis[2]=" << naxis[2] << ")" << endl;
-      exit(1);
+      out << "FATAL ERROR: number of lines in file " << filename_rvel
+          << " = " << nlines << " is different to the expected value "
+          "(naxis[2]=" << naxis[2] << ")" << endl;
+      fatalerror();
+      return;
     }
   }
   else //no existe fichero de velocidad radial
@@ -688,14 +726,17 @@ SciData::SciData(IndexParam &param)
   //inicializamos etiquetas para los espectros
   //------------------------------------------
   labelsp = new char* [naxis[2]];
+  for ( long ns = 1; ns <= naxis[2]; ns++ )
+    labelsp[ns-1] = NULL;
   //si existe un fichero externo, lo abrimos
   const char *const file_label = param.get_ilabfile();
   length = strlen(file_label);
   if ( length > 255 )
   {
-    cout << "FATAL ERROR: strlen(filename_label) > 255. "
-         << "(redim filename_label in scidata.h)" << endl;
-    exit(1);
+    out << "FATAL ERROR: strlen(filename_label) > 255. "
+        << "(redim filename_label in scidata.h)" << endl;
+    fatalerror();
+    return;
   }
   strncpy(filename_label,file_label,length);
   filename_label[length] = '\0';
@@ -705,8 +746,9 @@ SciData::SciData(IndexParam &param)
     ifstream infile (filename_label,ios::in);
     if ( !infile )
     {
-      cout << "FATAL ERROR: while opening the file " << filename_label << endl;
-      exit(1);
+      out << "FATAL ERROR: while opening the file " << filename_label << endl;
+      fatalerror();
+      return;
     }
     //leemos el fichero con etiquetas
     long nlines=0;
@@ -721,6 +763,15 @@ SciData::SciData(IndexParam &param)
       {
         if(s[0] != '#')
         {
+          //comprobamos que el fichero no contiene demasiadas lineas
+          if (nlines+1 > naxis[2])
+          {
+            out << "FATAL ERROR: number of lines in file " << filename_label
+                << " = " << nlines+1 << " is larger than the expected value "
+                "(naxis[2]=" << naxis[2] << ")" << endl;
+            fatalerror();
+            return;
+          }
           if(lsize >= nchar2)
           {
             if(nchar2 == 0) //leemos toda la cadena
@@ -760,21 +811,13 @@ SciData::SciData(IndexParam &param)
             }
           }
           nlines++;
-          //comprobamos que el fichero no contiene demasiadas lineas
-          if (nlines > naxis[2])
-          {
-            cout << "FATAL ERROR: number of lines in file " << filename_label
-                 << " = " << nlines << " is larger than the expected value "
-                 "(naxis[2]=" << naxis[2] << ")" << endl;
-            exit(1);
-          }
         }
         else
         {
           //es un comentario y se ignora
         }
       }
-      else
+      else if (nlines < naxis[2]) //(ver comprobacion final)
       {
         labelsp[nlines] = new char[lsizelabel+1];
         for (long l=1; l<=lsizelabel;l++)
@@ -784,15 +827,20 @@ SciData::SciData(IndexParam &param)
         (labelsp[nlines])[lsizelabel] = '\0';
         nlines++;
       }
+      else
+      {
+        nlines++;
+      }
     }
     //si el fichero contiene un numero de lineas diferente al esperado,
     //abortamos la ejecucion del programa
     if (nlines != naxis[2])
     {
-      cout << "FATAL ERROR: number of lines in file " << filename_label
-           << " = " << nlines << " is different to the expected value "
-           "(naxis[2]=" << naxis[2] << ")" << endl;
-      exit(1);
+      out << "FATAL ERROR: number of lines in file " << filename_label
+          << " = " << nlines << " is different to the expected value "
+          "(naxis[2]=" << naxis[2] << ")" << endl;
+      fatalerror();
+      return;
     }
   }
   else //no existe fichero de etiquetas
@@ -813,9 +861,10 @@ SciData::SciData(IndexParam &param)
     length = strlen(file_snguess);
     if ( length > 255 )
     {
-      cout << "FATAL ERROR: strlen(file_snguess) > 255. "
-           << "(redim filename_error in scidata.cpp)" << endl;
-      exit(1);
+      out << "FATAL ERROR: strlen(file_snguess) > 255. "
+          << "(redim filename_error in scidata.cpp)" << endl;
+      fatalerror();
+      return;
     }
     strncpy(filename_error,file_snguess,length);
     filename_error[length] = '\0';
@@ -831,15 +880,20 @@ SciData::SciData(IndexParam &param)
       double fnaxis1=static_cast<double>(naxis[1]);
       wlmin=crval1+cdelt1*(0.5-crpix1);
       wlmax=crval1+cdelt1*(fnaxis1+0.5-crpix1);
+      if (lognative)
+      {
+        wlmin=pow(10.0,wlmin);
+        wlmax=pow(10.0,wlmax);
+      }
       //abrimos el archivo con las regiones mediante el constructor de ifstream
       ifstream inpfile(filename_error,ios::in);
       if(!inpfile)
       {
-        cout << "FATAL ERROR: while opening the file " 
-             << filename_error << endl;
-        exit(1);
+        out << "FATAL ERROR: while opening the file " 
+            << filename_error << endl;
+        fatalerror();
+        return;
       }
-      vector <SNRegion> snregion;
       //leemos el fichero
       string s;
       while(getline(inpfile,s)) //vamos leyendo cada linea
@@ -855,61 +909,68 @@ SciData::SciData(IndexParam &param)
           long lsize3=spoldeg.length();
           if (lsize1*lsize2*lsize3 == 0)
           {
-            cout << "FATAL ERROR: missing number(s) in file "
-                 << filename_error << endl;
-            cout << "-> Check that the file does not contain an empty end line"
-                 << endl;
-            exit(1);
+            out << "FATAL ERROR: missing number(s) in file "
+                << filename_error << endl;
+            out << "-> Check that the file does not contain an empty end line"
+                << endl;
+            fatalerror();
+            return;
           }
           //leemos el primer limite en l.d.o.
           double wave1;
           if(!issdouble(swave1,wave1))
           {
-            cout << "FATAL ERROR: reading 1st float number in file "
-                 << filename_error << endl;
-            exit(1);
+            out << "FATAL ERROR: reading 1st float number in file "
+                << filename_error << endl;
+            fatalerror();
+            return;
           }
           //leemos el segundo limite en l.d.o.
           double wave2;
           if(!issdouble(swave2,wave2))
           {
-            cout << "FATAL ERROR: reading 2nd float number in file "
-                 << filename_error << endl;
-            exit(1);
+            out << "FATAL ERROR: reading 2nd float number in file "
+                << filename_error << endl;
+            fatalerror();
+            return;
           }
           if(wave2 < wave1)
           {
-            cout << "FATAL ERROR: reading wavelengths in file "
-                 << filename_error << endl;
-            cout << "==> w1,w2: " << wave1 << "," << wave2 << endl;
-            cout << "==> These numbers must verify w1 <= w2" << endl;
-            exit(1);
+            out << "FATAL ERROR: reading wavelengths in file "
+                << filename_error << endl;
+            out << "==> w1,w2: " << wave1 << "," << wave2 << endl;
+            out << "==> These numbers must verify w1 <= w2" << endl;
+            fatalerror();
+            return;
           }
           if( (wave1 < wlmin) || (wave2 > wlmax) )
           {
-            cout << "FATAL ERROR: reading wavelengths in file "
-                 << filename_error << endl;
-            cout << "==> w1,w2: " << wave1 << "," << wave2 << endl;
-            cout << "==> These numbers are outside the expected range:"
-                 << endl;
-            cout << "==> wlmin,wlmax: " << wlmin << "," << wlmax << endl;
-            exit(1);
+            out << "FATAL ERROR: reading wavelengths in file "
+                << filename_error << endl;
+            out << "==> w1,w2: " << wave1 << "," << wave2 << endl;
+            out << "==> These numbers are outside the expected range:"
+                << endl;
+            out << "==> wlmin,wlmax: " << wlmin << "," << wlmax << endl;
+            fatalerror();
+            return;
           }
           //leemos el grado del polinomio a sustraer
           long poldeg;
           if(!isslong(spoldeg,poldeg))
           {
-            cout << "FATAL ERROR: reading long number in file "
-                 << filename_error << endl;
-            exit(1);
+            out << "FATAL ERROR: reading long number in file "
+                << filename_error << endl;
+            fatalerror();
+            return;
           }
           if( (poldeg != 0) && (poldeg != 1) )
           {
-            cout << "FATAL ERROR: reading polynomial degree in file "
-                 << filename_error << endl;
-            cout << "==> poldeg: " << poldeg << endl;
-            cout << "==> This number must be 0 or 1" << endl;
-            exit(1);
+            out << "FATAL ERROR: reading polynomial degree in file "
+                << filename_error << endl;
+            out << "==> poldeg: " << poldeg << endl;
+            out << "==> This number must be 0 or 1" << endl;
+            fatalerror();
+            return;
           }
           //almacenamos los nuevos valores
           SNRegion dumregion;
@@ -923,9 +984,10 @@ SciData::SciData(IndexParam &param)
       const long nSNregions=snregion.size();
       if (nSNregions <= 0)
       {
-        cout << "FATAL ERROR: number of regions to estimate S/N is < 1"
-             << endl;
-        exit(1);
+        out << "FATAL ERROR: number of regions to estimate S/N is < 1"
+            << endl;
+        fatalerror();
+        return;
       }
       //comprobamos que las regiones no solapan
       if (nSNregions > 1)
@@ -943,24 +1005,24 @@ SciData::SciData(IndexParam &param)
                  ((w1r2 >= w1r1) && (w1r2 <= w2r1)) || //w1r2 dentro de r1
                  ((w2r2 >= w1r1) && (w2r2 <= w2r1)) )  //w2r2 dentro de r1
             {
-              cout << "FATAL ERROR: reading the file " 
-                   << filename_error << endl;
-              cout << "==> there are intersections between different regions"
-                   << endl;
-              cout << "==> " << w1r1 << "," << w2r1 << " and "
-                   << w1r2 << "," << w2r2 << endl;
-              exit(1);
+              out << "FATAL ERROR: reading the file " 
+                  << filename_error << endl;
+              out << "==> there are intersections between different regions"
+                  << endl;
+              out << "==> " << w1r1 << "," << w2r1 << " and "
+                  << w1r2 << "," << w2r2 << endl;
+              fatalerror();
+              return;
             }
           }
         }
       }
-      //generamos una imagen simulada de errores a partir de la S/N promedio en
-      //las regiones indicadas
-      error = new double [nelements]; //imagen 2D simulada de errores
+      //comprobamos que todas las regiones caen dentro del espectro para
+      //las velocidades radiales de los espectros a medir (los errores
+      //simulados a partir de la S/N promedio en estas regiones se generan
+      //al leer cada espectro, ver getspectrum)
       for (long ns=param.get_ns1(); ns<=param.get_ns2(); ns++)
       {
-        //para cada espectro calculamos la S/N promedio en las distintas
-        //regiones
         long nSNregions_effective=0;
         for (long nreg=1; nreg<=nSNregions; nreg++)
         {
@@ -971,88 +1033,45 @@ SciData::SciData(IndexParam &param)
           double rcvel1=(1.0+rcvel)/sqrt(1.0-rcvel*rcvel); //corr.relativista
           w1*=rcvel1; //observed wavelength
           w2*=rcvel1; //observed wavelength
-          double fj1=(w1-crval1)/cdelt1+crpix1;
-          double fj2=(w2-crval1)/cdelt1+crpix1;
+          double fj1=(pixelwave(w1)-crval1)/cdelt1+crpix1;
+          double fj2=(pixelwave(w2)-crval1)/cdelt1+crpix1;
           double fnaxis1=static_cast<double>(naxis[1]);
           if( (fj1 < 1.0) || (fj2 > fnaxis1) )
           {
             double wvalid1, wvalid2;
             wvalid1=crval1+cdelt1*(1.0-crpix1); //centro del primer pixel
             wvalid2=crval1+cdelt1*(fnaxis1-crpix1); //centro del ultimo pixel
-            cout << "FATAL ERROR: walength region to estimate S/N "
-                 << "is outside valid range" << endl;
-            cout << "w1,w2......: " << w1 << "," << w2 << endl;
-            cout << "Valid range: " << wvalid1 << "," << wvalid2 << endl;
-            exit(1);
-          }
-          //generamos un vector que contenga la region a ajustar con el
-          //polinomio (para la escala en X utilizamos el numero de pixel)
-          long j1=static_cast<long>(fj1+0.5);
-          long j2=static_cast<long>(fj2+0.5);
-          vector<XYData> fit_region;
-          long k;
-          for (long j=j1; j<=j2; j++)
-          {
-            k=(ns-1)*naxis[1]+j-1;
-            XYData xydum;
-            xydum.setx(static_cast<double>(j));
-            xydum.sety(data[k]);
-            fit_region.push_back(xydum);
-          }
-          if(fit_region.size() >= 2) //para poder medir el r.m.s.
-          {
-            double pdeg=snregion[nreg-1].getpoldeg();
-            double mean_signal, mean_noise;
-            if(pdeg == 0) //polynomial degree=0
+            if (lognative)
             {
-              sustrae_p0(fit_region,mean_signal,mean_noise);
+              wvalid1=pow(10.0,wvalid1);
+              wvalid2=pow(10.0,wvalid2);
             }
-            else //polynomial degree=1
-            {
-              sustrae_p1(fit_region,mean_signal,mean_noise);
-            }
-            double temp_sn=mean_signal/mean_noise;
-            snregion[nreg-1].setsn(temp_sn);
-            snregion[nreg-1].setnpixels(fit_region.size());
-            nSNregions_effective++;
+            out << "FATAL ERROR: walength region to estimate S/N "
+                << "is outside valid range" << endl;
+            out << "w1,w2......: " << w1 << "," << w2 << endl;
+            out << "Valid range: " << wvalid1 << "," << wvalid2 << endl;
+            fatalerror();
+            return;
           }
+          long j1=static_cast<long>(fj1+0.5);
+          long j2=static_cast<long>(fj2+0.5);
+          if(j2-j1+1 >= 2) nSNregions_effective++; //para medir el r.m.s.
         }
         if(nSNregions_effective == 0)
         {
-          cout << "FATAL ERROR: useful number of SN regions = 0" << endl;
-          exit(1);
-        }
-        //calculamos el numero total de pixels en todas las bandas utiles
-        double ntotpixels=0;
-        for (long nreg=1; nreg<=nSNregions; nreg++)
-        {
-          if(snregion[nreg-1].getnpixels() >= 2)
-          {
-            ntotpixels+=static_cast<double>(snregion[nreg-1].getnpixels());
-          }
-        }
-        //calculamos la S/N promedio de todas las regiones utiles, pesando con
-        //el numero de pixels
-        double mean_SN=0.0;
-        for (long nreg=1; nreg<=nSNregions; nreg++)
-        {
-          if(snregion[nreg-1].getnpixels() >= 2)
-          {
-            double weight=snregion[nreg-1].getnpixels()/ntotpixels;
-            mean_SN+=snregion[nreg-1].getsn()*weight;
-          }
-        }
-        //generamos el espectro simulado de errores con la S/N promedio
-        long k;
-        for (long j=1; j<=naxis[1]; j++)
-        {
-          k=(ns-1)*naxis[1]+j-1;
-          error[k]=data[k]/mean_SN;
+          out << "FATAL ERROR: useful number of SN regions = 0" << endl;
+          fatalerror();
+          return;
         }
       }
+      //la imagen simulada de errores se genera espectro a espectro (en
+      //getspectrum), por lo que no necesita bloque de errores
     }
   }
 
+  //bloques de espectros
+  allocblocks(param);
+
   //final del constructor
 }
 
@@ -1060,11 +1079,50 @@ SciData::SciData(IndexParam &param)
 //destructor
 SciData::~SciData()
 {
-  delete [] data;
-  if (strcmp(filename_error,"undef") != 0) delete [] error;
+  int status=0;
+  for (long b = 0; b < nblocks; b++)
+  {
+    //el bloque 0 emplea los ficheros abiertos en el constructor
+    if ( (b > 0) && (blocks[b].fptr_data != NULL) )
+    {
+      if ( fits_close_file(blocks[b].fptr_data, &status) )
+           printerror( status );
+    }
+    if ( (b > 0) && (blocks[b].fptr_error != NULL) )
+    {
+      if ( fits_close_file(blocks[b].fptr_error, &status) )
+           printerror( status );
+    }
+    delete [] blocks[b].data;
+    delete [] blocks[b].error;
+    delete [] blocks[b].data32;
+    delete [] blocks[b].error32;
+  }
+  delete [] blocks;
+  if (fptr_data != NULL)
+  {
+    if ( fits_close_file(fptr_data, &status) )
+         printerror( status );
+  }
+  if (fptr_error != NULL)
+  {
+    if ( fits_close_file(fptr_error, &status) )
+         printerror( status );
+  }
+  pthread_mutex_destroy(&mutex);
+  pthread_cond_destroy(&cond);
+  if (map_data.addr != NULL) munmap(map_data.addr,map_data.length);
+  if (map_error.addr != NULL) munmap(map_error.addr,map_error.length);
+  if (mfile_data.addr != NULL) munmap(mfile_data.addr,mfile_data.length);
+  if (mfile_error.addr != NULL) munmap(mfile_error.addr,mfile_error.length);
   delete [] rvel;
   delete [] rvelerr;
-  delete [] *labelsp;
+  if (labelsp != NULL)
+  {
+    for ( long ns = 1; ns <= naxis[2]; ns++ )
+      delete [] labelsp[ns-1];
+  }
+  delete [] labelsp;
 }
 
 //-----------------------------------------------------------------------------
@@ -1101,10 +1159,182 @@ double SciData::getcdelt1() const { return cdelt1; }
 double SciData::getcrpix1() const { return crpix1; }
 
 //-----------------------------------------------------------------------------
-double *SciData::getdata() const { return data; }
+//copia el espectro numero ns (y su error, si existe) en sp_data y sp_error
+//(de dimension NAXIS1), leyendo del fichero FITS el bloque de espectros que
+//lo contiene si no esta ya en memoria; los espectros se devuelven con el
+//factor de escala en flujo aplicado y en escala lineal en l.d.o. (sp_temp
+//es un vector de trabajo de dimension NAXIS1, propio de quien llama, para
+//el paso a escala lineal); puede llamarse simultaneamente desde diferentes
+//hilos de ejecucion. Retorna false si no ha podido leerse el bloque que
+//contiene el espectro (solo si el objeto se ha construido con lexit=false;
+//ver getreaderror)
+bool SciData::getspectrum(const long ns, double *sp_data, double *sp_error,
+                          double *sp_temp)
+{
+  const long naxis1 = naxis[1];
+  //las imagenes proyectadas en memoria se decodifican directamente, sin
+  //bloques intermedios ni mutex (la proyeccion es de solo lectura)
+  if (map_data.pixels != NULL) maprow(map_data,ns,sp_data);
+  if (map_error.pixels != NULL) maprow(map_error,ns,sp_error);
+  const bool lchunk_data = (map_data.pixels == NULL);
+  const bool lchunk_error = ( (fptr_error != NULL) &&
+                              (map_error.pixels == NULL) );
+  if ( (lchunk_data) || (lchunk_error) )
+  {
+    const long nb = (ns-ns1_chunk)/chunksize;
+    pthread_mutex_lock(&mutex);
+    const SpectraBlock *block = getblock(nb);
+    if (block == NULL)
+    {
+      pthread_mutex_unlock(&mutex);
+      return(false);
+    }
+    //los bloques solo contienen las columnas colj1..colj2
+    const long k0 = (ns-ns1_chunk-nb*chunksize)*(colj2-colj1+1)-colj1;
+    //en float32 el cambio de escala en flujo se aplica aqui, en doble
+    //precision, de forma que el resultado coincide con storage=double
+    if (block->data32 != NULL)
+    {
+      for (long j=colj1; j<=colj2; j++)
+        sp_data[j-1]=static_cast<double>(block->data32[k0+j])/fscale;
+    }
+    else if (block->data != NULL)
+    {
+      for (long j=colj1; j<=colj2; j++)
+        sp_data[j-1]=block->data[k0+j];
+    }
+    if (block->error32 != NULL)
+    {
+      for (long j=colj1; j<=colj2; j++)
+        sp_error[j-1]=static_cast<double>(block->error32[k0+j])/fscale;
+    }
+    else if (block->error != NULL)
+    {
+      for (long j=colj1; j<=colj2; j++)
+        sp_error[j-1]=block->error[k0+j];
+    }
+    pthread_mutex_unlock(&mutex);
+  }
+  //en caso necesario, pasamos a escala lineal
+  if (llogscale)
+  {
+    loglinear(sp_data,sp_temp);
+    if (fptr_error != NULL) loglinear(sp_error,sp_temp);
+  }
+  //errores simulados a partir de la S/N promedio en las regiones indicadas
+  if (snregion.size() > 0)
+  {
+    vector <SNRegion> snregion_ = snregion;
+    const long nSNregions=snregion_.size();
+    //calculamos la S/N promedio en las distintas regiones
+    for (long nreg=1; nreg<=nSNregions; nreg++)
+    {
+      double w1=snregion_[nreg-1].getwave1(); //rest-frame
+      double w2=snregion_[nreg-1].getwave2(); //rest-frame
+      const double c=2.9979246E+5; //velocidad de la luz (km/s)
+      double rcvel=rvel[ns-1]/c; //aproximacion clasica, v/c
+      double rcvel1=(1.0+rcvel)/sqrt(1.0-rcvel*rcvel); //corr.relativista
+      w1*=rcvel1; //observed wavelength
+      w2*=rcvel1; //observed wavelength
+      double fj1=(pixelwave(w1)-crval1)/cdelt1+crpix1;
+      double fj2=(pixelwave(w2)-crval1)/cdelt1+crpix1;
+      //generamos un vector que contenga la region a ajustar con el
+      //polinomio (para la escala en X utilizamos el numero de pixel); el
+      //constructor ya ha comprobado que la region cae dentro del espectro
+      long j1=static_cast<long>(fj1+0.5);
+      long j2=static_cast<long>(fj2+0.5);
+      vector<XYData> fit_region;
+      for (long j=j1; j<=j2; j++)
+      {
+        XYData xydum;
+        xydum.setx(static_cast<double>(j));
+        xydum.sety(sp_data[j-1]);
+        fit_region.push_back(xydum);
+      }
+      if(fit_region.size() >= 2) //para poder medir el r.m.s.
+      {
+        double pdeg=snregion_[nreg-1].getpoldeg();
+        double mean_signal, mean_noise;
+        if(pdeg == 0) //polynomial degree=0
+        {
+          sustrae_p0(fit_region,mean_signal,mean_noise);
+        }
+        else //polynomial degree=1
+        {
+          sustrae_p1(fit_region,mean_signal,mean_noise);
+        }
+        double temp_sn=mean_signal/mean_noise;
+        snregion_[nreg-1].setsn(temp_sn);
+        snregion_[nreg-1].setnpixels(fit_region.size());
+      }
+    }
+    //calculamos el numero total de pixels en todas las bandas utiles
+    double ntotpixels=0;
+    for (long nreg=1; nreg<=nSNregions; nreg++)
+    {
+      if(snregion_[nreg-1].getnpixels() >= 2)
+      {
+        ntotpixels+=static_cast<double>(snregion_[nreg-1].getnpixels());
+      }
+    }
+    //calculamos la S/N promedio de todas las regiones utiles, pesando con
+    //el numero de pixels
+    double mean_SN=0.0;
+    for (long nreg=1; nreg<=nSNregions; nreg++)
+    {
+      if(snregion_[nreg-1].getnpixels() >= 2)
+      {
+        double weight=snregion_[nreg-1].getnpixels()/ntotpixels;
+        mean_SN+=snregion_[nreg-1].getsn()*weight;
+      }
+    }
+    //generamos el espectro simulado de errores con la S/N promedio
+    for (long j=colj1; j<=colj2; j++)
+    {
+      sp_error[j-1]=sp_data[j-1]/mean_SN;
+    }
+  }
+  return(true);
+}
+
+//-----------------------------------------------------------------------------
+bool SciData::getlognative() const { return lognative; }
 
 //-----------------------------------------------------------------------------
-double *SciData::geterror() const { return error; }
+//indica si el objeto se ha inicializado y sus espectros se han leido sin
+//errores (con lexit=true, los errores terminan el programa)
+bool SciData::isvalid()
+{
+  pthread_mutex_lock(&mutex);
+  const bool lok = ( (lvalid) && (nberror < 0) );
+  pthread_mutex_unlock(&mutex);
+  return(lok);
+}
+
+//-----------------------------------------------------------------------------
+//avisos y errores generados al inicializar el objeto con lexit=false (con
+//lexit=true se muestran directamente en cout)
+string SciData::getmessages() const { return messages.str(); }
+
+//-----------------------------------------------------------------------------
+//mensaje del error que se ha producido al leer los espectros (vacio si no
+//se ha producido ninguno)
+string SciData::getreaderror()
+{
+  pthread_mutex_lock(&mutex);
+  const string msg = readerror;
+  pthread_mutex_unlock(&mutex);
+  return(msg);
+}
+
+//-----------------------------------------------------------------------------
+bool SciData::getfloatstorage() const { return(blocks[0].data32 != NULL); }
+
+//-----------------------------------------------------------------------------
+bool SciData::getmmap() const { return(map_data.pixels != NULL); }
+
+//-----------------------------------------------------------------------------
+long SciData::getnblocks() const { return(nblocks); }
 
 //-----------------------------------------------------------------------------
 double *SciData::getrvel() const { return rvel; }
@@ -1116,6 +1346,611 @@ double *SciData::getrvelerr() const { return rvelerr; }
 char **SciData::getlabelsp() const { return labelsp; }
 
 //-----------------------------------------------------------------------------
+void SciData::setlabelsp(const char *label)
+{
+  const long length = strlen(label);
+  for ( long ns = 1; ns <= naxis[2]; ns++ )
+  {
+    delete [] labelsp[ns-1];
+    labelsp[ns-1] = new char[length+1];
+    strcpy(labelsp[ns-1],label);
+  }
+}
+
+//-----------------------------------------------------------------------------
+//retorna el bloque nb (espectros ns1_chunk+nb*chunksize en adelante), que se
+//lee si no esta en memoria; el mutex debe estar bloqueado por el hilo que
+//llama a esta funcion, y el bloque retornado es valido mientras no se
+//desbloquee. La lectura (y descompresion) se realiza con el mutex
+//desbloqueado, de forma que los demas hilos siguen midiendo los espectros
+//ya leidos; un hilo que espera un bloque que esta leyendo otro hilo lee
+//entretanto alguno de los bloques siguientes, si hay bloques disponibles.
+//Si un bloque no puede leerse (solo con lexit=false), se retorna NULL para
+//ese bloque y los siguientes, y los anteriores se siguen leyendo (de forma
+//que el primer espectro que falla no depende del numero de hilos).
+SpectraBlock *SciData::getblock(const long nb)
+{
+  const long nblast = (ns2_chunk-ns1_chunk)/chunksize;
+  for (;;)
+  {
+    //buscamos el bloque entre los ya leidos (o que se estan leyendo)
+    long nbread = nb;
+    bool lbusy = false;
+    for (long b = 0; b < nblocks; b++)
+    {
+      if (blocks[b].nb == nb)
+      {
+        if (!blocks[b].lbusy)
+        {
+          blocks[b].lastuse = ++nuse;
+          return(&blocks[b]);
+        }
+        lbusy = true;
+      }
+    }
+    if ( (nberror >= 0) && (nb >= nberror) )
+    {
+      if (!lbusy) return(NULL);
+      pthread_cond_wait(&cond,&mutex);
+      continue;
+    }
+    //si otro hilo esta leyendo el bloque, buscamos un bloque siguiente que
+    //no este en memoria
+    if (lbusy)
+    {
+      nbread = -1;
+      for (long nbnext = nb+1; (nbnext <= nblast) &&
+           (nbnext < nb+nblocks) && (nbread < 0) &&
+           ( (nberror < 0) || (nbnext < nberror) ); nbnext++)
+      {
+        bool lfound = false;
+        for (long b = 0; b < nblocks; b++)
+          if (blocks[b].nb == nbnext) lfound = true;
+        if (!lfound) nbread = nbnext;
+      }
+    }
+    //elegimos el bloque (libre) usado hace mas tiempo, sin reemplazar
+    //bloques siguientes al que se necesita cuando solo se adelanta lectura
+    SpectraBlock *block = NULL;
+    if (nbread >= 0)
+    {
+      for (long b = 0; b < nblocks; b++)
+      {
+        if ( (!blocks[b].lbusy) &&
+             ( (nbread == nb) || (blocks[b].nb < nb) ) &&
+             ( (block == NULL) || (blocks[b].lastuse < block->lastuse) ) )
+          block = &blocks[b];
+      }
+    }
+    if (block == NULL)
+    {
+      pthread_cond_wait(&cond,&mutex);
+      continue;
+    }
+    block->nb = nbread;
+    block->lbusy = true;
+    pthread_mutex_unlock(&mutex);
+    string msg;
+    const bool lread = readblock(*block,msg);
+    pthread_mutex_lock(&mutex);
+    //un bloque leido por adelantado que no ha podido leerse se lee de
+    //nuevo (y se produce el error) cuando se necesita
+    if ( (!lread) && (nbread == nb) && ( (nberror < 0) || (nb < nberror) ) )
+    {
+      nberror = nb;
+      readerror = msg;
+    }
+    if (!lread) block->nb = -1;
+    block->lbusy = false;
+    block->lastuse = ++nuse;
+    pthread_cond_broadcast(&cond);
+  }
+}
+
+//-----------------------------------------------------------------------------
+//lee del fichero FITS (y del de errores, si existe) los espectros del bloque
+//block.nb, aplicando el factor de escala en flujo; si no es posible, con
+//lexit=false retorna false y el mensaje de error en errmsg
+bool SciData::readblock(SpectraBlock &block, string &errmsg)
+{
+  const long ns = ns1_chunk+block.nb*chunksize;
+  long nrows = ns2_chunk-ns+1;
+  if (nrows > chunksize) nrows = chunksize;
+  const long nelements = nrows*(colj2-colj1+1);
+  int status=0;
+  bool anynull = false;
+  if (block.data32 != NULL)
+    status = readpixels(block.fptr_data, TFLOAT, ns, nrows, block.data32,
+                        anynull);
+  else if (block.data != NULL)
+    status = readpixels(block.fptr_data, TDOUBLE, ns, nrows, block.data,
+                        anynull);
+  if ( (status == 0) && (anynull) )
+    errmsg = "FATAL ERROR: the data spectra contain NULL values.";
+  if ( (status == 0) && (!anynull) )
+  {
+    if (block.error32 != NULL)
+      status = readpixels(block.fptr_error, TFLOAT, ns, nrows, block.error32,
+                          anynull);
+    else if (block.error != NULL)
+      status = readpixels(block.fptr_error, TDOUBLE, ns, nrows, block.error,
+                          anynull);
+    if ( (status == 0) && (anynull) )
+      errmsg = "FATAL ERROR: the error spectra contain NULL values.";
+  }
+  if (status != 0)
+  {
+    if (lexit) printerror( status );
+    errmsg = fitserror(status);
+  }
+  if ( (status != 0) || (anynull) )
+  {
+    if (lexit)
+    {
+      cout << errmsg << endl;
+      exit(1);
+    }
+    return(false);
+  }
+  //en caso necesario, aplicamos cambio de escala (en float32 se aplica al
+  //copiar cada espectro, ver getspectrum)
+  if (fscale != 1.0)
+  {
+    if (block.data != NULL)
+    {
+      for (long i=1; i<=nelements; i++)
+      {
+        block.data[i-1]/=fscale;
+      }
+    }
+    if (block.error != NULL)
+    {
+      for (long i=1; i<=nelements; i++)
+      {
+        block.error[i-1]/=fscale;
+      }
+    }
+  }
+  return(true);
+}
+
+//-----------------------------------------------------------------------------
+//lee en buffer las columnas colj1..colj2 de los espectros ns..ns+nrows-1
+//(con fits_read_subset si no se leen todas las columnas); retorna el
+//status de cfitsio, y lnull indica si la imagen contiene valores NULL
+int SciData::readpixels(fitsfile *fptr, const int datatype, const long ns,
+                        const long nrows, void *buffer, bool &lnull)
+{
+  int status=0;
+  int anynull=0;
+  if ( (colj1 == 1) && (colj2 == naxis[1]) )
+  {
+    long fpixel[2] = {1,ns};
+    fits_read_pix(fptr, datatype, fpixel, nrows*naxis[1], 0,
+                  buffer, &anynull, &status);
+  }
+  else
+  {
+    long fpixel[2] = {colj1,ns};
+    long lpixel[2] = {colj2,ns+nrows-1};
+    long inc[2] = {1,1};
+    fits_read_subset(fptr, datatype, fpixel, lpixel, inc, 0,
+                     buffer, &anynull, &status);
+  }
+  lnull = (anynull != 0);
+  return(status);
+}
+
+//-----------------------------------------------------------------------------
+//columnas [j1,j2] que pueden necesitarse para medir los indices myindex en
+//los espectros ns1..ns2: las bandas de cada indice (con los mismos limites
+//que mideindex, ver indexspan) desde la menor a la mayor velocidad radial,
+//y las regiones para estimar la S/N (snf). El intervalo de velocidades
+//incluye 10 veces el error de cada espectro (las desviaciones gaussianas de
+//RandomStream estan acotadas por ~8.6) o la malla rvgrid. Con plotmode, con
+//espectros pasados a escala lineal o con cumflux (las sumas acumuladas se
+//extienden desde el primer pixel) se emplean todas las columnas.
+void SciData::columnwindow(IndexParam &param, vector<IndexDef> &myindex,
+                           long &j1, long &j2)
+{
+  const long naxis1 = naxis[1];
+  j1 = 1;
+  j2 = naxis1;
+  if ( (param.get_plotmode() != 0) || (param.get_cumflux()) ||
+       ( (llogscale) && (!lognative) ) )
+    return;
+  //intervalo de velocidades radiales de los espectros
+  double rvmin = 0.0, rvmax = 0.0;
+  for (long ns = param.get_ns1(); ns <= param.get_ns2(); ns++)
+  {
+    const double v1 = rvel[ns-1]-10.0*rvelerr[ns-1];
+    const double v2 = rvel[ns-1]+10.0*rvelerr[ns-1];
+    if ( (ns == param.get_ns1()) || (v1 < rvmin) ) rvmin = v1;
+    if ( (ns == param.get_ns1()) || (v2 > rvmax) ) rvmax = v2;
+  }
+  //con rvgrid, los indices se miden en las velocidades de la malla
+  double rvmin_index = rvmin, rvmax_index = rvmax;
+  if (param.get_nrvgrid() > 0)
+  {
+    rvmin_index = param.get_rvgrid1();
+    rvmax_index = param.get_rvgrid1()+
+                  (param.get_nrvgrid()-1)*param.get_rvgridstep();
+  }
+  long jmin = naxis1, jmax = 1;
+  for (unsigned long k = 0; k < myindex.size(); k++)
+  {
+    //si el indice se sale del espectro, indexspan retorna todo el espectro
+    long ja, jb;
+    indexspan(myindex[k],naxis1,crval1,cdelt1,crpix1,lognative,
+              rvmin_index,ja,jb);
+    if (ja < jmin) jmin = ja;
+    indexspan(myindex[k],naxis1,crval1,cdelt1,crpix1,lognative,
+              rvmax_index,ja,jb);
+    if (jb > jmax) jmax = jb;
+  }
+  const double c = 2.9979246E+5; //velocidad de la luz (km/s)
+  for (unsigned long nreg = 0; nreg < snregion.size(); nreg++)
+  {
+    const double rcvel1 = (1.0+rvmin/c)/sqrt(1.0-(rvmin/c)*(rvmin/c));
+    const double rcvel2 = (1.0+rvmax/c)/sqrt(1.0-(rvmax/c)*(rvmax/c));
+    const double fj1=(pixelwave(snregion[nreg].getwave1()*rcvel1)-crval1)/
+                     cdelt1+crpix1;
+    const double fj2=(pixelwave(snregion[nreg].getwave2()*rcvel2)-crval1)/
+                     cdelt1+crpix1;
+    if (static_cast<long>(fj1+0.5) < jmin) jmin = static_cast<long>(fj1+0.5);
+    if (static_cast<long>(fj2+0.5) > jmax) jmax = static_cast<long>(fj2+0.5);
+  }
+  //margen de seguridad
+  j1 = (jmin-2 > 1) ? jmin-2 : 1;
+  j2 = (jmax+2 < naxis1) ? jmax+2 : naxis1;
+}
+
+//-----------------------------------------------------------------------------
+//selecciona las columnas [j1,j2] que se leen de las imagenes (el resto de
+//pixeles de los espectros que proporciona getspectrum no se modifica); no
+//debe llamarse mientras otros hilos extraen espectros
+void SciData::setcolumns(const long j1, const long j2)
+{
+  if ( (j1 == colj1) && (j2 == colj2) ) return;
+  colj1 = j1;
+  colj2 = j2;
+  const long nelements = chunksize*(colj2-colj1+1);
+  for (long b = 0; b < nblocks; b++)
+  {
+    SpectraBlock &block = blocks[b];
+    //los bloques ya leidos dejan de ser validos
+    block.nb = -1;
+    if (block.data != NULL)
+    {
+      delete [] block.data;
+      block.data = new double [nelements];
+    }
+    if (block.data32 != NULL)
+    {
+      delete [] block.data32;
+      block.data32 = new float [nelements];
+    }
+    if (block.error != NULL)
+    {
+      delete [] block.error;
+      block.error = new double [nelements];
+    }
+    if (block.error32 != NULL)
+    {
+      delete [] block.error32;
+      block.error32 = new float [nelements];
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//indica si los pixeles de la imagen se representan exactamente en float32:
+//BITPIX=-32 o enteros de 8 y 16 bits (con o sin BZERO); en otro caso los
+//bloques de espectros se guardan en doble precision
+bool SciData::float32exact(fitsfile *fptr)
+{
+  int status=0;
+  int imgtype=0;
+  if ( fits_get_img_equivtype(fptr, &imgtype, &status) )
+       printerror( status );
+  return( (imgtype == FLOAT_IMG) || (imgtype == SHORT_IMG) ||
+          (imgtype == USHORT_IMG) || (imgtype == BYTE_IMG) ||
+          (imgtype == SBYTE_IMG) );
+}
+
+//-----------------------------------------------------------------------------
+//reserva los bloques de espectros; por defecto se emplea un unico bloque,
+//que se lee con los ficheros abiertos en el constructor. Con imagenes
+//comprimidas por teselas y varios hilos, cada hilo de medida puede
+//descomprimir un bloque mientras los demas miden los espectros ya leidos:
+//se reservan nthreads+1 bloques, con chunksize reducido para repartir los
+//espectros entre ellos, y los bloques adicionales emplean sus propios
+//fitsfile (cfitsio no permite que varios hilos lean a la vez del mismo
+//fichero abierto, ni de dos aperturas del mismo fichero, que comparten el
+//buffer de lectura), abiertos en memoria sobre una unica proyeccion del
+//fichero con mmap.
+void SciData::allocblocks(IndexParam &param)
+{
+  int status=0;
+  const bool lchunk_data = (map_data.pixels == NULL);
+  const bool lchunk_error = ( (fptr_error != NULL) &&
+                              (map_error.pixels == NULL) );
+  nblocks = 1;
+  bool lcompressed = false;
+  if ( (lchunk_data) && (fits_is_compressed_image(fptr_data, &status)) )
+    lcompressed = true;
+  if ( (lchunk_error) && (fits_is_compressed_image(fptr_error, &status)) )
+    lcompressed = true;
+  if ( (lcompressed) && (param.get_nthreads() > 1) &&
+       (ns2_chunk > ns1_chunk) && (fits_is_reentrant()) )
+  {
+    bool lmapped = true;
+    if (lchunk_data)
+      lmapped = mapfile(filename_data,mfile_data);
+    if ( (lmapped) && (lchunk_error) )
+      lmapped = mapfile(filename_error,mfile_error);
+    if (lmapped)
+    {
+      nblocks = param.get_nthreads()+1;
+      const long nrows = (ns2_chunk-ns1_chunk+nblocks)/nblocks;
+      if (chunksize > nrows) chunksize = nrows;
+    }
+  }
+  //los bloques se leen en float32 si no se pierde precision
+  const bool ldata32 = ( (lchunk_data) && (param.get_floatstorage()) &&
+                         (float32exact(fptr_data)) );
+  const bool lerror32 = ( (lchunk_error) && (param.get_floatstorage()) &&
+                          (float32exact(fptr_error)) );
+  const long nelements = chunksize*naxis[1];
+  blocks = new SpectraBlock [nblocks];
+  for (long b = 0; b < nblocks; b++)
+  {
+    SpectraBlock &block = blocks[b];
+    block.nb = -1;
+    block.lbusy = false;
+    block.lastuse = 0;
+    block.fptr_data = NULL;
+    block.fptr_error = NULL;
+    block.data = NULL;
+    block.error = NULL;
+    block.data32 = NULL;
+    block.error32 = NULL;
+    if (lchunk_data)
+    {
+      if (b == 0)
+        block.fptr_data = fptr_data;
+      else
+        block.fptr_data = openmemfile(fptr_data,filename_data,mfile_data);
+      if (ldata32)
+        block.data32 = new float [nelements];
+      else
+        block.data = new double [nelements];
+    }
+    if (lchunk_error)
+    {
+      if (b == 0)
+        block.fptr_error = fptr_error;
+      else
+        block.fptr_error = openmemfile(fptr_error,filename_error,
+                                       mfile_error);
+      if (lerror32)
+        block.error32 = new float [nelements];
+      else
+        block.error = new double [nelements];
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//proyecta en memoria (solo lectura) el fichero FITS filename completo, para
+//abrirlo con fits_open_memfile; retorna false si no es posible (fichero con
+//especificacion de extension o filtros en el nombre, comprimido con gzip,
+//etc.), en cuyo caso se emplea un unico bloque de espectros
+bool SciData::mapfile(const char *filename, MappedFile &map)
+{
+  map.addr = NULL;
+  const int fd = open(filename, O_RDONLY);
+  if (fd < 0) return(false);
+  struct stat filestat;
+  if ( (fstat(fd, &filestat) != 0) || (filestat.st_size < 2880) )
+  {
+    close(fd);
+    return(false);
+  }
+  const size_t length = static_cast<size_t>(filestat.st_size);
+  void *addr = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); //la proyeccion se mantiene tras cerrar el descriptor
+  if (addr == MAP_FAILED) return(false);
+  if (strncmp(static_cast<const char *>(addr),"SIMPLE  =",9) != 0)
+  {
+    munmap(addr, length);
+    return(false);
+  }
+  map.addr = addr;
+  map.length = length;
+  return(true);
+}
+
+//-----------------------------------------------------------------------------
+//abre en memoria, sobre la proyeccion map del fichero filename, el mismo
+//HDU que fptr
+fitsfile *SciData::openmemfile(fitsfile *fptr, const char *filename,
+                               MappedFile &map)
+{
+  int status=0;
+  int hdunum;
+  fits_get_hdu_num(fptr, &hdunum);
+  fitsfile *fptr_mem;
+  if ( fits_open_memfile(&fptr_mem, filename, READONLY,
+       &map.addr, &map.length, 0, NULL, &status) )
+  {
+    printerror( status );
+    return(NULL);
+  }
+  if ( fits_movabs_hdu(fptr_mem, hdunum, NULL, &status) )
+       printerror( status );
+  return(fptr_mem);
+}
+
+//-----------------------------------------------------------------------------
+//proyecta en memoria (mmap) el fichero que contiene la imagen abierta en
+//fptr, si es una imagen sin comprimir almacenada tal cual en el fichero
+//(BITPIX=8,16,32,-32,-64); en otro caso (imagen comprimida, fichero .gz,
+//sintaxis extendida de cfitsio, ...) map.pixels queda a NULL y la imagen
+//se lee por bloques con cfitsio
+void SciData::mapimage(fitsfile *fptr, const char *filename,
+                       MappedImage &map)
+{
+  map.addr = NULL;
+  map.pixels = NULL;
+  int status=0;
+  if (fits_is_compressed_image(fptr, &status)) return;
+  int bitpix;
+  if ( fits_get_img_type(fptr, &bitpix, &status) )
+  {
+    printerror( status );
+    return;
+  }
+  if ( (bitpix != BYTE_IMG) && (bitpix != SHORT_IMG) &&
+       (bitpix != LONG_IMG) && (bitpix != FLOAT_IMG) &&
+       (bitpix != DOUBLE_IMG) ) return;
+  LONGLONG headstart, datastart, dataend;
+  if ( fits_get_hduaddrll(fptr, &headstart, &datastart, &dataend, &status) )
+  {
+    printerror( status );
+    return;
+  }
+  double bscale=1.0, bzero=0.0;
+  if (fits_read_key(fptr, TDOUBLE, "BSCALE", &bscale, NULL, &status))
+  {
+    status=0;
+    bscale=1.0;
+  }
+  if (fits_read_key(fptr, TDOUBLE, "BZERO", &bzero, NULL, &status))
+  {
+    status=0;
+    bzero=0.0;
+  }
+  //el fichero debe contener la cabecera y los datos en las posiciones que
+  //indica cfitsio
+  const int fd = open(filename, O_RDONLY);
+  if (fd < 0) return;
+  struct stat filestat;
+  const size_t length = static_cast<size_t>(dataend);
+  if ( (fstat(fd, &filestat) != 0) ||
+       (static_cast<LONGLONG>(filestat.st_size) < dataend) )
+  {
+    close(fd);
+    return;
+  }
+  void *addr = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); //la proyeccion se mantiene tras cerrar el descriptor
+  if (addr == MAP_FAILED) return;
+  const char *header = static_cast<const char *>(addr)+headstart;
+  if ( (strncmp(header,"SIMPLE  =",9) != 0) &&
+       (strncmp(header,"XTENSION=",9) != 0) )
+  {
+    munmap(addr, length);
+    return;
+  }
+  map.addr = static_cast<unsigned char *>(addr);
+  map.length = length;
+  map.pixels = map.addr+datastart;
+  map.bitpix = bitpix;
+  map.bscale = bscale;
+  map.bzero = bzero;
+}
+
+//-----------------------------------------------------------------------------
+//decodifica el espectro ns de una imagen proyectada en memoria (big-endian)
+//aplicando BSCALE, BZERO y el factor de escala en flujo, con las mismas
+//operaciones que cfitsio y readblock
+void SciData::maprow(const MappedImage &map, const long ns, double *sp) const
+{
+  const long naxis1 = naxis[1];
+  const long nbytes = (map.bitpix > 0 ? map.bitpix : -map.bitpix)/8;
+  const unsigned char *p = map.pixels+((ns-1)*naxis1+colj1-1)*nbytes;
+  const bool lscale = ( (map.bscale != 1.0) || (map.bzero != 0.0) );
+  for (long j=colj1; j<=colj2; j++, p+=nbytes)
+  {
+    double value;
+    if (map.bitpix == FLOAT_IMG)
+    {
+      const uint32_t u = (static_cast<uint32_t>(p[0]) << 24) |
+                         (static_cast<uint32_t>(p[1]) << 16) |
+                         (static_cast<uint32_t>(p[2]) << 8) |
+                          static_cast<uint32_t>(p[3]);
+      float f;
+      memcpy(&f,&u,4);
+      value = f;
+    }
+    else if (map.bitpix == DOUBLE_IMG)
+    {
+      uint64_t u = 0;
+      for (long k=0; k<8; k++) u = (u << 8) | p[k];
+      memcpy(&value,&u,8);
+    }
+    else if (map.bitpix == SHORT_IMG)
+    {
+      value = static_cast<int16_t>((p[0] << 8) | p[1]);
+    }
+    else if (map.bitpix == LONG_IMG)
+    {
+      const uint32_t u = (static_cast<uint32_t>(p[0]) << 24) |
+                         (static_cast<uint32_t>(p[1]) << 16) |
+                         (static_cast<uint32_t>(p[2]) << 8) |
+                          static_cast<uint32_t>(p[3]);
+      value = static_cast<int32_t>(u);
+    }
+    else //BYTE_IMG
+    {
+      value = p[0];
+    }
+    if (lscale) value = value*map.bscale+map.bzero;
+    if (fscale != 1.0) value/=fscale;
+    sp[j-1] = value;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//pasa el espectro sp de la escala logaritmica original a la escala lineal
+//(crval1, cdelt1, crpix1) preservando el numero de cuentas por pixel, usando
+//la tabla de pesos calculada en el constructor; tempsp es un vector de
+//trabajo de dimension NAXIS1
+void SciData::loglinear(double *sp, double *tempsp) const
+{
+  const long naxis1 = naxis[1];
+  const long *const first = &rebin_first[0];
+  const long *const jj = &rebin_j[0];
+  const double *const ww = &rebin_w[0];
+  for (long nc = 0; nc < naxis1; nc++)
+  {
+    double sum=0.0;
+    for (long l = first[nc]; l < first[nc+1]; l++)
+      sum+=sp[jj[l]]*ww[l];
+    tempsp[nc]=sum;
+  }
+  //actualizamos el espectro con el nuevo muestreo lineal
+  for (long nc = 0; nc < naxis1; nc++)
+  {
+    sp[nc]=tempsp[nc];
+  }
+}
+
+//-----------------------------------------------------------------------------
+//devuelve la coordenada (lineal o logaritmica) correspondiente a la longitud
+//de onda w en la escala de los espectros
+double SciData::pixelwave(const double w) const
+{
+  if (lognative)
+    return(log10(w));
+  else
+    return(w);
+}
+
+//-----------------------------------------------------------------------------
+//(con lexit=false el mensaje se guarda y el objeto queda marcado como no
+//valido, ver fatalerror)
 void SciData::printerror( long status)
 {
     /*****************************************************/
@@ -1124,9 +1959,36 @@ void SciData::printerror( long status)
 
     if (status)
     {
+       if (!lexit)
+       {
+         (*outPtr) << fitserror(status) << endl;
+         lvalid = false;
+         return;
+       }
+
        fits_report_error(stderr, status); /* print error report */
 
        exit( status );    /* terminate the program, returning error status */
     }
     return;
 }
+
+//-----------------------------------------------------------------------------
+//mensaje de error de cfitsio correspondiente a status
+string SciData::fitserror(const int status) const
+{
+  char errtext[FLEN_STATUS];
+  fits_get_errstatus(status, errtext);
+  ostringstream msg;
+  msg << "FATAL ERROR: cfitsio error status = " << status << ": " << errtext;
+  return(msg.str());
+}
+
+//-----------------------------------------------------------------------------
+//error al inicializar el objeto: termina el programa o, con lexit=false, lo
+//marca como no valido (el mensaje ya se ha mostrado o guardado)
+void SciData::fatalerror()
+{
+  if (lexit) exit(1);
+  lvalid = false;
+}
@@ -24,11 +24,57 @@
 #ifndef SCIDATA_H
 #define SCIDATA_H
 
+#include <vector>
+#include <string>
+#include <sstream>
+#include <pthread.h>
+#include "fitsio.h"
 #include "indexparam.h"
+#include "indexdef.h"
+#include "snregion.h"
+
+//imagen FITS sin comprimir proyectada en memoria con mmap (keyword mmap);
+//los pixeles se decodifican (orden de bytes, BITPIX, BSCALE y BZERO) al
+//extraer cada espectro
+struct MappedImage
+{
+  unsigned char *addr;          //inicio de la proyeccion (NULL: sin mmap)
+  size_t length;                //bytes proyectados
+  const unsigned char *pixels;  //primer pixel de la unidad de datos
+  int bitpix;
+  double bscale, bzero;
+};
+
+//fichero FITS completo proyectado en memoria con mmap, que se abre con
+//fits_open_memfile (cfitsio guarda las direcciones de addr y length)
+struct MappedFile
+{
+  void *addr;                   //inicio de la proyeccion (NULL: sin mmap)
+  size_t length;                //bytes proyectados
+};
+
+//bloque de espectros leidos de las imagenes de datos y errores (ver
+//getblock); con imagenes comprimidas por teselas y varios hilos se emplean
+//varios bloques, cada uno con sus propios fitsfile (abiertos en memoria con
+//fits_open_memfile sobre el fichero proyectado con mmap), de forma que los
+//hilos descomprimen bloques diferentes al mismo tiempo
+struct SpectraBlock
+{
+  long nb;                    //bloque almacenado (-1: ninguno)
+  bool lbusy;                 //un hilo esta leyendo el bloque
+  unsigned long lastuse;      //ultimo uso (se reutiliza el mas antiguo)
+  fitsfile *fptr_data;        //ficheros de los que se lee el bloque
+  fitsfile *fptr_error;
+  double *data;               //espectros leidos
+  double *error;              //errores leidos
+  float *data32;              //idem en float32 (storage=float; si no NULL,
+  float *error32;             //sustituyen a data y error)
+};
 
 class SciData{
   public:
-    SciData(IndexParam &); //constructor
+    SciData(IndexParam &); //constructor (los errores terminan el programa)
+    SciData(IndexParam &, const bool); //idem (false: no termina, ver isvalid)
     ~SciData(); //destructor (necesario para liberar memoria)
     char *getfilename_data();
     char *getfilename_error();
@@ -42,12 +88,29 @@ class SciData{
     double getcrval1() const;
     double getcdelt1() const;
     double getcrpix1() const;
-    double *getdata() const;
-    double *geterror() const;
+    bool getlognative() const;
+    bool getfloatstorage() const;
+    bool getmmap() const;
+    long getnblocks() const;
+    bool isvalid();
+    std::string getmessages() const;
+    std::string getreaderror();
+    bool getspectrum(const long, double *, double *, double *);
+    void columnwindow(IndexParam &, std::vector<IndexDef> &,
+                      long &, long &);
+    void setcolumns(const long, const long);
     double *getrvel() const;
     double *getrvelerr() const;
     char **getlabelsp() const;
+    void setlabelsp(const char *); //misma etiqueta para todos los espectros
   private:
+    bool lexit;                 //los errores terminan el programa
+    bool lvalid;                //objeto inicializado sin errores
+    long nberror;               //primer bloque que no ha podido leerse
+                                //(-1: ninguno; ver getblock)
+    std::string readerror;      //mensaje del error de lectura
+    std::ostringstream messages; //avisos y errores (si lexit es false)
+    std::ostream *outPtr;       //salida de avisos y errores
     char filename_data[256];
     char filename_error[256];
     char object_data[256];
@@ -60,12 +123,47 @@ class SciData{
     double crval1;
     double cdelt1;
     double crpix1;
-    double *data;
-    double *error;
+    fitsfile *fptr_data;        //fichero de datos (abierto)
+    fitsfile *fptr_error;       //fichero de errores (NULL si no existe)
+    double fscale;              //factor de escala en flujo
+    bool llogscale;             //escala original logaritmica en l.d.o.
+    bool lognative;             //se mide en la escala logaritmica original
+    std::vector<long> rebin_first;  //paso a escala lineal: primer peso de
+    std::vector<long> rebin_j;      //cada pixel, pixel original (0..NAXIS1-1)
+    std::vector<double> rebin_w;    //y peso de cada contribucion
+    std::vector<SNRegion> snregion; //regiones para estimar la S/N (snf)
+    long ns1_chunk;             //primer espectro que puede leerse
+    long ns2_chunk;             //ultimo espectro que puede leerse
+    long chunksize;             //numero de espectros leidos de una vez
+    long colj1, colj2;          //columnas que se leen (1,NAXIS1: todas)
+    long nblocks;               //numero de bloques de espectros
+    SpectraBlock *blocks;       //bloques de espectros leidos
+    unsigned long nuse;         //contador de usos de los bloques
+    pthread_mutex_t mutex;      //protege la lectura de bloques
+    pthread_cond_t cond;        //aviso de bloque leido
+    MappedImage map_data;       //imagenes proyectadas en memoria (en ese
+    MappedImage map_error;      //caso no se leen por bloques)
+    MappedFile mfile_data;      //ficheros proyectados para los bloques
+    MappedFile mfile_error;     //adicionales (ver allocblocks)
     double *rvel;
     double *rvelerr;
     char **labelsp;
+    void init(IndexParam &);
+    void fatalerror();
+    void allocblocks(IndexParam &);
+    bool mapfile(const char *, MappedFile &);
+    fitsfile *openmemfile(fitsfile *, const char *, MappedFile &);
+    SpectraBlock *getblock(const long);
+    bool readblock(SpectraBlock &, std::string &);
+    int readpixels(fitsfile *, const int, const long, const long, void *,
+                   bool &);
+    bool float32exact(fitsfile *);
+    void mapimage(fitsfile *, const char *, MappedImage &);
+    void maprow(const MappedImage &, const long, double *) const;
+    void loglinear(double *, double *) const;
+    double pixelwave(const double) const;
     void printerror(long); //funcin auxiliar
+    std::string fitserror(const int) const;
 };
 
 #endif
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2008-2013 Nicolas Cardiel
+ *
+ * This file is part of indexf.
+ *
+ * Indexf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Indexf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with indexf.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "commandtok.h"
+#include "indexparam.h"
+#include "indexdef.h"
+#include "scidata.h"
+#include "resulttable.h"
+
+using namespace std;
+
+bool checkpyind(const char *[], const int);
+int  pyexit(const int);
+bool loadipar(const char *[], const int, vector< CommandToken > &);
+bool checkipar(vector< CommandToken > &, IndexParam &, vector< IndexDef > &);
+void welcome(bool);
+void updatebands(IndexParam &, IndexDef &);
+void verbose(IndexParam &, vector< IndexDef > &, SciData *);
+bool measuresp(SciData *, IndexParam &, vector< IndexDef > &,
+               ResultTable *, const long);
+
+//numero maximo de imagenes que se mantienen abiertas
+const long MAX_OPEN_IMAGES = 16;
+
+//imagen abierta, junto con los parametros que determinan su contenido
+struct OpenImage
+{
+  string key;         //parametros con los que se abrio la imagen
+  long ns1, ns2;      //espectros a medir (una vez resuelto if=file,0,0)
+  SciData *imagePtr;
+};
+
+string imagekey(IndexParam &);
+int serverequest(const string &, vector< IndexDef > &,
+                 vector< CommandToken > &, vector< OpenImage > &);
+void serveworker(const int, vector< IndexDef > &, vector< CommandToken > &);
+
+//-----------------------------------------------------------------------------
+//Modo servidor (indexf --serve [socket]): las definiciones de los indices y
+//los valores por defecto de los parametros se leen una unica vez, y los
+//ficheros FITS permanecen abiertos entre peticiones. Cada linea recibida a
+//traves del socket es una peticion con los mismos keyword=value que en la
+//linea de comandos; la salida es la misma que la del programa, seguida de
+//la linea "#END status". Las peticiones se atienden en un proceso hijo: si
+//un error fatal lo termina, el cliente recibe el mensaje de error y el fin
+//de la conexion (sin "#END"), y el proceso padre lanza un nuevo proceso
+//hijo. La peticion "shutdown" termina el servidor.
+int serve(const char *socketPtr, vector< IndexDef > &id,
+          vector< CommandToken > &cl)
+{
+  struct sockaddr_un addr;
+  if (strlen(socketPtr) >= sizeof(addr.sun_path))
+  {
+    cout << "FATAL ERROR: socket name too long: " << socketPtr << endl;
+    return(1);
+  }
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path,socketPtr);
+  const int sockfd = socket(AF_UNIX,SOCK_STREAM,0);
+  if (sockfd < 0)
+  {
+    cout << "FATAL ERROR: unable to create socket" << endl;
+    return(1);
+  }
+  unlink(socketPtr); //eliminamos un socket previo con el mismo nombre
+  if ( (bind(sockfd,(struct sockaddr *) &addr,sizeof(addr)) != 0) ||
+       (listen(sockfd,16) != 0) )
+  {
+    cout << "FATAL ERROR: unable to listen on socket " << socketPtr << endl;
+    close(sockfd);
+    return(1);
+  }
+  cout << "#indexf server listening on " << socketPtr << endl;
+  for (;;)
+  {
+    cout << flush;
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+      cout << "FATAL ERROR: unable to create server process" << endl;
+      break;
+    }
+    if (pid == 0) serveworker(sockfd,id,cl); //no retorna
+    int status;
+    while (waitpid(pid,&status,0) < 0) {}
+    if ( (WIFEXITED(status)) && (WEXITSTATUS(status) == 0) ) break;
+    cout << "#WARNING: server process terminated; restarting" << endl;
+  }
+  close(sockfd);
+  unlink(socketPtr);
+  return(0);
+}
+
+//-----------------------------------------------------------------------------
+//proceso hijo: atiende las conexiones de forma secuencial, redirigiendo la
+//salida estandar al cliente durante cada peticion
+void serveworker(const int sockfd, vector< IndexDef > &id,
+                 vector< CommandToken > &cl)
+{
+  signal(SIGPIPE,SIG_IGN); //un cliente que se desconecta no nos termina
+  vector< OpenImage > images;
+  const int stdout_fd = dup(STDOUT_FILENO);
+  for (;;)
+  {
+    const int clientfd = accept(sockfd,NULL,NULL);
+    if (clientfd < 0) continue;
+    string buffer;
+    bool lshutdown = false;
+    bool lclose = false;
+    char cbuffer[4096];
+    while ( (!lclose) && (!lshutdown) )
+    {
+      const size_t eol = buffer.find('\n');
+      if (eol == string::npos)
+      {
+        const ssize_t n = read(clientfd,cbuffer,sizeof(cbuffer));
+        if (n <= 0) break;
+        buffer.append(cbuffer,n);
+        continue;
+      }
+      string request = buffer.substr(0,eol);
+      buffer.erase(0,eol+1);
+      //tabuladores y retornos de carro equivalen a espacios en blanco
+      for (size_t i = 0; i < request.length(); i++)
+        if ( (request[i] == '\t') || (request[i] == '\r') ) request[i]=' ';
+      const size_t i1 = request.find_first_not_of(' ');
+      if (i1 == string::npos) continue; //linea vacia
+      request = request.substr(i1,request.find_last_not_of(' ')-i1+1);
+      if (request == "quit")
+      {
+        lclose = true;
+      }
+      else if (request == "shutdown")
+      {
+        lshutdown = true;
+      }
+      else
+      {
+        cout << flush;
+        dup2(clientfd,STDOUT_FILENO);
+        const int status = serverequest(request,id,cl,images);
+        cout << "#END " << status << endl;
+        dup2(stdout_fd,STDOUT_FILENO);
+        //si el cliente cerro la conexion, cout queda en estado de error
+        cout.clear();
+      }
+    }
+    close(clientfd);
+    if (lshutdown)
+    {
+      for (unsigned long i = 0; i < images.size(); i++)
+        delete images[i].imagePtr;
+      exit(0);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//atiende una peticion del mismo modo que el programa principal, pero
+//reutilizando las definiciones de indices, los valores por defecto de los
+//parametros y las imagenes ya abiertas; retorna el estado de salida
+int serverequest(const string &request, vector< IndexDef > &id,
+                 vector< CommandToken > &cl_default,
+                 vector< OpenImage > &images)
+{
+  extern bool pyindexf_global;
+  const char *argv[2] = {"indexf", request.c_str()};
+  pyindexf_global=checkpyind(argv,2);
+  vector< CommandToken > cl = cl_default;
+  IndexParam param;
+  if(!loadipar(argv,2,cl)) return(pyexit(1));
+  if(!checkipar(cl, param, id)) return(pyexit(1));
+  if(param.get_checkkeys())
+  {
+    cout << "Successful check of keywords\n";
+    return(0);
+  }
+  if(param.get_plotmode() != 0)
+  {
+    cout << "FATAL ERROR: plotmode must be 0 in server mode" << endl;
+    return(pyexit(1));
+  }
+  if(param.get_pybinfd() >= 0)
+  {
+    cout << "FATAL ERROR: pybinfd cannot be used in server mode" << endl;
+    return(pyexit(1));
+  }
+  if(strcmp(param.get_filelist(),"undef") != 0)
+  {
+    cout << "FATAL ERROR: filelist cannot be used in server mode" << endl;
+    return(pyexit(1));
+  }
+  welcome(param.get_verbose());
+  //buscamos la imagen entre las ya abiertas
+  const string key = imagekey(param);
+  SciData *imagePtr = NULL;
+  for (unsigned long i = 0; i < images.size(); i++)
+  {
+    if (images[i].key == key)
+    {
+      imagePtr = images[i].imagePtr;
+      param.set_ns1(images[i].ns1);
+      param.set_ns2(images[i].ns2);
+    }
+  }
+  if (imagePtr == NULL)
+  {
+    if (static_cast<long>(images.size()) == MAX_OPEN_IMAGES)
+    {
+      delete images[0].imagePtr;
+      images.erase(images.begin());
+    }
+    OpenImage newimage;
+    newimage.key = key;
+    newimage.imagePtr = new SciData(param);
+    newimage.ns1 = param.get_ns1();
+    newimage.ns2 = param.get_ns2();
+    images.push_back(newimage);
+    imagePtr = newimage.imagePtr;
+  }
+  vector< IndexDef > myindex;
+  for (long i=1; i <= param.get_nindices(); i++)
+  {
+    myindex.push_back(id[param.get_nindex(i)-1]);
+    updatebands(param,myindex.back());
+  }
+  if(param.get_verbose()) verbose(param,myindex,imagePtr);
+  if(!measuresp(imagePtr,param,myindex,NULL,0)) return(pyexit(1));
+  return(0);
+}
+
+//-----------------------------------------------------------------------------
+//parametros que determinan el contenido de un objeto SciData (incluida la
+//forma de almacenar y leer los datos); incluye la fecha de modificacion de
+//los ficheros de datos y errores, de forma que un fichero reescrito se
+//vuelve a abrir
+string imagekey(IndexParam &param)
+{
+  ostringstream key;
+  key << setprecision(17);
+  const char *files[2] = {param.get_if(), param.get_ief()};
+  for (long i = 0; i < 2; i++)
+  {
+    struct stat filestat;
+    key << files[i] << "|";
+    if (stat(files[i],&filestat) == 0)
+      key << filestat.st_mtime << "|";
+  }
+  key << param.get_ns1() << "|" << param.get_ns2() << "|"
+      << param.get_snf() << "|"
+      << param.get_rvfile() << "|" << param.get_rvc() << "|"
+      << param.get_rvce() << "|"
+      << param.get_rv() << "|" << param.get_rve() << "|"
+      << param.get_ilabfile() << "|" << param.get_nchar1() << "|"
+      << param.get_nchar2() << "|"
+      << param.get_fscale() << "|" << param.get_chunksize() << "|"
+      << param.get_lognative() << "|"
+      << param.get_floatstorage() << "|" << param.get_usemmap() << "|"
+      << param.get_colsubset() << "|" << param.get_nthreads();
+  return(key.str());
+}
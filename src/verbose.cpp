@@ -22,6 +22,7 @@
 #include <string.h>
 #include <sstream>
 #include <iomanip>
+#include <vector>
 #include "indexparam.h"
 #include "indexdef.h"
 #include "scidata.h"
@@ -33,20 +34,14 @@ void c123(const double &, const double &,
           const double &, const double &,
           double &, double &, double &);
 
-void verbose(IndexParam &param, IndexDef &myindex, SciData *imagePtr)
+//-----------------------------------------------------------------------------
+//muestra la informacion relativa a un indice
+void verboseindex(IndexParam &param, IndexDef &myindex)
 {
   //tipo de indice a medir
   const long type = myindex.gettype();
-  //definimos un separador de 79 caracteres
-  char separador[80];
-  separador[0]='#';
-  for (int i=1; i<=78; i++)
-    separador[i]='-';
-  separador[79]='\0';
-
   //mostramos informacion sobre el indice a medir
-  cout << separador << endl;
-  cout << "#Index.........................: " << param.get_index() << endl;
+  cout << "#Index.........................: " << myindex.getlabel() << endl;
   if (type == 1) //indices moleculares
   {
     cout << "#                        <code>: " << type
@@ -293,6 +288,24 @@ void verbose(IndexParam &param, IndexDef &myindex, SciData *imagePtr)
       cout << sldo1.str() << " " << sldo2.str() << endl;
     }
   }
+}
+
+//-----------------------------------------------------------------------------
+void verbose(IndexParam &param, vector< IndexDef > &myindex, SciData *imagePtr)
+{
+  //numero de indices a medir
+  const long nindices = myindex.size();
+  //definimos un separador de 79 caracteres
+  char separador[80];
+  separador[0]='#';
+  for (int i=1; i<=78; i++)
+    separador[i]='-';
+  separador[79]='\0';
+
+  //mostramos informacion sobre los indices a medir
+  cout << separador << endl;
+  for (long k=1; k <= nindices; k++)
+    verboseindex(param,myindex[k-1]);
   //Indicamos si estamos utilizando longitudes de onda en vacio
   cout << "#Wavelength reference system...: ";
   const long vacuum = param.get_vacuum();
@@ -348,6 +361,22 @@ void verbose(IndexParam &param, IndexDef &myindex, SciData *imagePtr)
       lshow_nseed=true;
     }
   }
+  //malla de velocidades radiales (sustituye a la velocidad anterior)
+  if (param.get_nrvgrid() > 0)
+  {
+    cout << "#Radial velocity grid (km/s)...: " << param.get_rvgrid1() << ", "
+         << param.get_rvgrid2() << ", " << param.get_rvgridstep() << " ("
+         << param.get_nrvgrid() << " values)" << endl;
+  }
+  //metodo de estimacion del error debido a la velocidad radial
+  if (param.get_rverrmode() == 1)
+  {
+    cout << "#Radial velocity error method..: analytic" << endl;
+  }
+  else if (param.get_rverrmode() == 2)
+  {
+    cout << "#Radial velocity error method..: both (mc, analytic)" << endl;
+  }
   //Input file con etiquetas para cada espectro
   cout << "#Input label file..............: " << param.get_ilabfile() 
        << "," << param.get_nchar1() << "," << param.get_nchar2() << endl;
@@ -359,6 +388,19 @@ void verbose(IndexParam &param, IndexDef &myindex, SciData *imagePtr)
                                                << param.get_maxsn() << endl;
     lshow_nseed=true;
   }
+  //modo de simulacion
+  if ( (lshow_nseed) && (param.get_simmode() != 0) )
+  {
+    if (param.get_simmode() == 1)
+      cout << "#Simulation mode...............: antithetic" << endl;
+    else
+      cout << "#Simulation mode...............: sobol" << endl;
+  }
+  //simulaciones adaptativas
+  if (param.get_simtol() > 0)
+  {
+    cout << "#Simulation tolerance..........: " << param.get_simtol() << endl;
+  }
   if(lshow_nseed)
   {
     cout << "#Seed for random number........: " << param.get_nseed() << endl;
@@ -367,6 +409,17 @@ void verbose(IndexParam &param, IndexDef &myindex, SciData *imagePtr)
   cout << "#Percentile for continuum (%)..: " << param.get_contperc() << endl;
   //boundary fit for continuum estimation
   cout << "#Boundary fit for continuum....: " << param.get_boundfit() << endl;
+  if (param.get_boundfit() != 0)
+  {
+    if (param.get_boundfit() > 0)
+      cout << "#Boundary fit polynomial degree: " << param.get_bfitdeg() 
+           << endl;
+    else
+      cout << "#Boundary fit number of knots..: " << param.get_bfitdeg() 
+           << endl;
+    cout << "#Boundary fit asymmetry coeff..: " << param.get_bfitasym() 
+         << endl;
+  }
   //flattened (no/yes): assume continuum level equal to 1.0
   cout << "#Flattened spectrum (flux=1.0).: ";
   if (param.get_flattened())
@@ -383,37 +436,113 @@ void verbose(IndexParam &param, IndexDef &myindex, SciData *imagePtr)
   cout << "#Linearity error (power law)...: " << param.get_linearerr() << endl;
   //flux scale factor
   cout << "#Flux scale factor.............: " << param.get_fscale() << endl;
+  //tablas de flujo acumulado
+  if (param.get_cumflux())
+  {
+    cout << "#Cumulative flux tables........: yes" << endl;
+  }
+  //numero de hilos de ejecucion
+  if (param.get_nthreads() > 1)
+  {
+    cout << "#Number of threads.............: " << param.get_nthreads() 
+         << endl;
+  }
+  //numero de espectros leidos de una vez
+  cout << "#Spectra read at once..........: " << param.get_chunksize() 
+       << endl;
+  //almacenamiento de los espectros leidos en float32
+  if (param.get_floatstorage())
+  {
+    cout << "#Spectra stored as.............: "
+         << (imagePtr->getfloatstorage() ? "float" : "double (BITPIX)")
+         << endl;
+  }
+  //imagen de datos proyectada en memoria
+  if (param.get_usemmap())
+  {
+    cout << "#Spectra read through mmap.....: "
+         << (imagePtr->getmmap() ? "yes" : "no (not a plain FITS image)")
+         << endl;
+  }
+  //bloques de espectros descomprimidos en paralelo
+  if (imagePtr->getnblocks() > 1)
+  {
+    cout << "#Decompressed in parallel......: " << imagePtr->getnblocks()
+         << " blocks" << endl;
+  }
+  //columnas de las imagenes que se leen
+  if (param.get_colsubset())
+  {
+    long colj1, colj2;
+    imagePtr->columnwindow(param,myindex,colj1,colj2);
+    cout << "#Pixel columns read............: " << colj1 << "-" << colj2
+         << " (of " << imagePtr->getnaxis1() << ")" << endl;
+  }
   //separador
   cout << separador << "\n#" << endl;
-  //leyenda y unidades
+  //leyenda y unidades (con rverrmode=both se anaden dos columnas con la
+  //propagacion analitica del error en velocidad radial)
+  string rvboth1, rvboth2, rvboth3;
+  if (param.get_rverrmode() == 2)
+  {
+    rvboth1 = "    ind_rva    err_rva";
+    rvboth2 = "   analytic   analytic";
+    rvboth3 = "   ========   ========";
+  }
+  //con simtol > 0 se anade el numero de simulaciones realizadas
+  if (param.get_simtol() > 0)
+  {
+    rvboth1 += "  nsim";
+    rvboth2 += "  used";
+    rvboth3 += "  ====";
+  }
+  if (nindices > 1) //varios indices: se incluye una columna con su nombre
+  {
+    cout << "#spect index        index    err_phot    S/N    "
+            "   RVel.  RVel.err  ind_rvel  err_rvel" << rvboth1 << endl;
+    cout << "#  no. name         value      value   per ang  "
+            "  (km/s)   (km/s)     value     value"
+         << rvboth2 << endl;
+    cout << "#===== ========   =======   ========  =======  "
+            "========  ========  ========  ========"
+         << rvboth3 << endl;
+    return;
+  }
+  const long type = myindex[0].gettype();
   cout << "#spect.    index    err_phot    S/N    "
-          "   RVel.  RVel.err  ind_rvel  err_rvel"<< endl;
+          "   RVel.  RVel.err  ind_rvel  err_rvel" << rvboth1 << endl;
 
   if (type == 1) //indices moleculares
     cout << "#number    (mag)      (mag)   per ang  "
-            "  (km/s)   (km/s)     (mag)     (mag)" << endl;
+            "  (km/s)   (km/s)     (mag)     (mag)"
+         << rvboth2 << endl;
   else if (type == 2) //indices atomicos
     if (param.get_logindex())
     {
       cout << "#number    (mag)      (mag)   per ang  "
-              "  (km/s)   (km/s)     (mag)     (mag)" << endl;
+              "  (km/s)   (km/s)     (mag)     (mag)"
+           << rvboth2 << endl;
     }
     else
     {
       cout << "#number    (ang)      (ang)   per ang  "
-              "  (km/s)   (km/s)     (ang)     (ang)" << endl;
+              "  (km/s)   (km/s)     (ang)     (ang)"
+           << rvboth2 << endl;
     }
   else if ( (type == 3) || (type == 4) || (type == 5) ) //D4000, B4000, color
     cout << "#number    value      value   S/N_ang  "
-            "  (km/s)   (km/s)     value     value" << endl;
+            "  (km/s)   (km/s)     value     value"
+         << rvboth2 << endl;
   else if ( (type >= 101) && (type <= 9999) ) //indices genericos
     cout << "#number    (ang)      (ang)   per ang  "
-            "  (km/s)   (km/s)     (ang)     (ang)" << endl;
+            "  (km/s)   (km/s)     (ang)     (ang)"
+         << rvboth2 << endl;
   else if ( (type >= -99) && (type <= -2) ) //indices pendiente
     cout << "#number    value      value   S/N_ang  "
-            "  (km/s)   (km/s)     value     value" << endl;
+            "  (km/s)   (km/s)     value     value"
+         << rvboth2 << endl;
 
   cout << "#======   =======   ========  =======  "
           "========  ========  ========  ========"
-       << endl;
+       << rvboth3 << endl;
 }